@@ -59,6 +59,9 @@
 /* Define if you have the <fcntl.h> header file.  */
 #define HAVE_FCNTL_H 1
 
+/* Define if you have the <linux/io_uring.h> header file.  */
+/* #undef HAVE_LINUX_IO_URING_H */
+
 /* Define if you have the <linux/usbdevice_fs.h> header file.  */
 /* #undef HAVE_LINUX_USBDEVICE_FS_H */
 
@@ -104,6 +104,13 @@ struct usbdevice {
 struct usbdevice;
 #endif
 
+/* Device handle as passed to the low level routines */
+#ifndef WITH_USBDEVFS
+typedef int               rio_device;
+#else
+typedef struct usbdevice *rio_device;
+#endif
+
 
 typedef struct
 {
@@ -158,6 +165,220 @@ typedef struct
   WORD            folder_num; 
 } folder_location;
 
+/* Size of the above on the wire (see librio500_codec.c) */
+#define RIO_MEM_STATUS_SIZE         20
+#define RIO_FOLDER_LOCATION_SIZE    6
+
+/* Reusable transfer buffers (see librio500_pool.c) */
+
+#define RIO_XFER_SIZE               0x80000
+#define RIO_POOL_MAX_XFER           4
+#define RIO_POOL_MAX_BLOCKS         8
+
+typedef struct
+{
+  int             num_xfer;
+  int             num_blocks;
+  BYTE           *xfer[RIO_POOL_MAX_XFER];
+  BYTE           *blocks[RIO_POOL_MAX_BLOCKS];
+} rio_pool;
+
+/* Read-ahead upload source (see librio500_reader.c) */
+
+#define RIO_READER_SLOTS            4
+#define RIO_READER_SLOT_SIZE        (RIO_XFER_SIZE / RIO_READER_SLOTS)
+
+typedef struct _rio_reader rio_reader;
+
+/* Song download session (see librio500_download.c) */
+
+typedef void (*rio_progress_func) (unsigned long done, unsigned long total);
+
+typedef struct
+{
+  rio_device        rio_dev;
+  int               card;
+  int               folder_num;
+  struct _rio_table *folders;
+  int               own_folders;
+  folder_entry     *root;
+  WORD              old_offset;
+  int               repointed;
+  unsigned long     length;       /* of the selected song */
+  rio_progress_func progress;
+} rio_download;
+
+/* Threaded download writer (see librio500_sink.c) */
+
+#define RIO_SINK_SLOTS              4
+#define RIO_SINK_SLOT_SIZE          (RIO_XFER_SIZE / RIO_SINK_SLOTS)
+
+#define RIO_SYNC_NONE               0
+#define RIO_SYNC_CLOSE              1
+#define RIO_SYNC_ALWAYS             2
+
+typedef struct _rio_sink rio_sink;
+
+/* Folder and song lookup by name (see librio500_index.c) */
+
+#define RIO_MATCH_EXACT             0
+#define RIO_MATCH_GLOB              1
+#define RIO_MATCH_REGEX             2
+
+typedef struct _rio_name_ref
+{
+  int                    card;
+  int                    folder;
+  int                    song;          /* -1 for a folder */
+  char                  *name;
+  void                  *entry;         /* folder_entry or song_entry */
+  struct _rio_name_ref  *next;          /* next one with the same name */
+} rio_name_ref;
+
+typedef struct _rio_name_index rio_name_index;
+
+/* Folder and song tables in one piece (see librio500_table.c) */
+
+#define RIO_TABLE_FOLDERS           0
+#define RIO_TABLE_SONGS             1
+#define RIO_ENTRY_SIZE              0x800
+
+typedef struct _rio_table
+{
+  int              type;
+  int              count;         /* entries in use */
+  int              size;          /* entries allocated */
+  DWORD            dirty;         /* blocks changed since the table was
+                                     read or written; bit 31 stands for
+                                     block 31 and up */
+  BYTE            *entries;
+} rio_table;
+
+#define rio_table_entry(t, i)       ((void *) ((t)->entries + (i) * RIO_ENTRY_SIZE))
+#define rio_table_folder(t, i)      ((folder_entry *) rio_table_entry (t, i))
+#define rio_table_song(t, i)        ((song_entry *) rio_table_entry (t, i))
+#define rio_table_is_dirty(t)       ((t)->dirty != 0)
+
+/* Read-only tables left as the Rio sent them (see librio500_table.c).
+   Entries are in Rio (little endian) byte order; read the numbers
+   through the accessors below. */
+
+typedef struct
+{
+  int              type;
+  int              count;
+  BYTE            *blocks;        /* follows the struct, same allocation */
+} rio_view;
+
+#ifdef WORDS_BIGENDIAN
+#define RIO_LE16(x)                 GUINT16_SWAP_LE_BE (x)
+#define RIO_LE32(x)                 GUINT32_SWAP_LE_BE (x)
+#else
+#define RIO_LE16(x)                 (x)
+#define RIO_LE32(x)                 (x)
+#endif
+
+#define rio_view_folder(v, i)       ((const folder_entry *) ((v)->blocks + (i) * RIO_ENTRY_SIZE))
+#define rio_view_song(v, i)         ((const song_entry *) ((v)->blocks + (i) * RIO_ENTRY_SIZE))
+
+#define rio_folder_offset(f)        ((WORD) RIO_LE16 ((f)->offset))
+#define rio_folder_num_songs(f)     ((WORD) RIO_LE16 ((f)->fst_free_entry_off) / RIO_ENTRY_SIZE)
+#define rio_folder_time(f)          ((DWORD) RIO_LE32 ((f)->time))
+#define rio_song_offset(s)          ((WORD) RIO_LE16 ((s)->offset))
+#define rio_song_length(s)          ((DWORD) RIO_LE32 ((s)->length))
+#define rio_song_time(s)            ((DWORD) RIO_LE32 ((s)->time))
+
+/* Song lists that keep only what a listing prints (see
+   librio500_table.c). The title bitmap stays on the Rio until
+   rio_song_bitmap is asked for it. */
+
+typedef struct _rio_names rio_names;
+
+typedef struct
+{
+  WORD             table_offset;  /* the folder's song table when listed */
+  BYTE             card;
+  BYTE             folder;
+  WORD             song;
+} rio_bitmap_ref;
+
+typedef struct
+{
+  WORD             offset;
+  DWORD            length;
+  DWORD            time;
+  DWORD            mp3sig;
+  const char      *name;          /* interned, belongs to the rio_names */
+  rio_bitmap_ref   bitmap;
+} rio_song_info;
+
+typedef struct
+{
+  int              count;
+  rio_song_info   *songs;         /* follows the struct, same allocation */
+} rio_song_list;
+
+/* Folder and song tables kept between operations (see librio500_cache.c) */
+
+#define RIO_CACHE_MAX_CARDS         2
+#define RIO_CACHE_MAX_FOLDERS       256
+
+typedef struct _rio_cache rio_cache;
+
+/* Folder table changes waiting to be written (see librio500_intent.c) */
+
+typedef struct _rio_intent rio_intent;
+
+/* Free blocks of each card, counted on the host (see librio500_space.c) */
+
+typedef struct _rio_space rio_space;
+
+/* Block map of a card (see librio500_frag.c) */
+
+#define RIO_BLOCK_FREE              0
+#define RIO_BLOCK_SONG              1
+#define RIO_BLOCK_TABLE             2
+#define RIO_BLOCK_OTHER             3   /* used, by nothing in the tables */
+
+typedef struct
+{
+  int              card;
+  DWORD            block_size;
+  DWORD            num_blocks;
+  DWORD            first_free_block;    /* as the Rio reports them */
+  DWORD            num_unused_blocks;
+  DWORD            song_blocks;         /* as the tables say */
+  DWORD            table_blocks;
+  DWORD            other_blocks;
+  DWORD            free_runs;           /* runs of free blocks */
+  DWORD            largest_run;
+  long             first_hole;          /* first free block of the map, -1 if none */
+  int              movable;             /* songs starting past first_hole */
+  unsigned long    movable_bytes;
+  BYTE            *map;                 /* RIO_BLOCK_* of every block */
+} rio_frag;
+
+/* Table check results (see librio500_fsck.c) */
+
+typedef struct
+{
+  int              folders;
+  int              songs;
+  int              problems;
+  int              repaired;            /* folders written again */
+  DWORD            reached;             /* blocks the tables reach */
+  DWORD            unreachable;         /* in use, but reached by nothing */
+} rio_fsck_report;
+
+/* Fonts for title bitmaps, loaded once per process, and glyph packs
+   (see librio500_font.c) */
+
+typedef struct _rio_font rio_font;
+
+/* Asked before a song's audio is released (see librio500_delete.c) */
+
+typedef int (*rio_keep_func) (int folder_num, int song_num, void *data);
+
 
 /* functions order from high-level to low-level */
 #ifndef WITH_USBDEVFS
@@ -165,6 +386,7 @@ typedef struct
 mem_status    *get_mem_status (int fd, int card);
 unsigned long  query_mem_left (int fd, int card);
 unsigned long  query_firmware_rev (int fd);
+unsigned long  query_card_count (int fd);
 void           send_folder_location (int fd, int offset, int folder_num, int card);
 void           format_flash (int fd, int card); 
 void           init_communication (int fd);
@@ -193,6 +415,8 @@ struct usbdevice *usb_open(int vendorid, int productid, unsigned int timeout);
 
 mem_status    *get_mem_status (struct usbdevice *rio_dev, int card);
 unsigned long  query_mem_left (struct usbdevice *rio_dev, int card);
+unsigned long  query_card_count (struct usbdevice *rio_dev);
+unsigned long  query_firmware_rev (struct usbdevice *rio_dev);
 void           send_folder_location (struct usbdevice *rio_dev, int offset, int folder_num, int card);
 void           format_flash (struct usbdevice *rio_dev, int card);
 struct usbdevice *init_communication ();
@@ -205,6 +429,7 @@ GList *read_folder_entries (struct usbdevice *rio_dev, int card);
 GList *read_song_entries (struct usbdevice *rio_dev, GList *folder_entries, int folder_num, int card);
 void   write_folder_entries (struct usbdevice *rio_dev, GList *entries, int card);
 void   write_song_entries (struct usbdevice *rio_dev, int folder_num, GList *entries, int card);
+unsigned long get_num_folder_blocks (struct usbdevice *rio_dev, int address, int card);
 
 unsigned long  send_command (struct usbdevice *rio_dev, int req, int value, int index);
 unsigned long  send_read_command (struct usbdevice *rio_dev, int address, int num_blocks, int card);
@@ -224,6 +449,124 @@ rio_bitmap_data  * bitmap_data_new (char *name, char *font_name, int font_number
 BYTE             * new_empty_block ();
 void               clear_block (BYTE *block);
 
+rio_pool         * rio_pool_new ();
+rio_pool         * rio_pool_default ();
+void               rio_pool_delete (rio_pool *pool);
+BYTE             * rio_pool_get_xfer (rio_pool *pool);
+void               rio_pool_put_xfer (rio_pool *pool, BYTE *buf);
+BYTE             * rio_pool_get_block (rio_pool *pool);
+void               rio_pool_put_block (rio_pool *pool, BYTE *block);
+
+rio_reader       * rio_reader_new (int fd, unsigned long offset, unsigned long size, rio_pool *pool);
+BYTE             * rio_reader_next (rio_reader *reader, int len, int *count);
+int                rio_reader_uses_uring (rio_reader *reader);
+void               rio_reader_delete (rio_reader *reader);
+
+int                rio_upload_song (rio_device rio_dev, rio_reader *reader, unsigned long size, int card, rio_progress_func progress);
+
+rio_download     * rio_download_begin (rio_device rio_dev, GList *folders, int folder_num, int card);
+rio_download     * rio_download_begin_table (rio_device rio_dev, struct _rio_table *folders, int folder_num, int card);
+int                rio_download_select (rio_download *dl, song_entry *song);
+int                rio_download_read (rio_download *dl, unsigned long size, rio_sink *sink);
+int                rio_download_read_range (rio_download *dl, unsigned long offset, unsigned long len, rio_sink *sink);
+int                rio_download_end (rio_download *dl);
+int                rio_read_song_range (rio_device rio_dev, GList *folders, int folder_num, int song_num, unsigned long offset, unsigned long len, int card, rio_sink *sink);
+
+rio_sink         * rio_sink_open (char *filename, unsigned long size, int sync, rio_pool *pool);
+rio_sink         * rio_sink_open_fd (int fd, unsigned long offset, unsigned long size, int sync, rio_pool *pool);
+rio_sink         * rio_sink_open_stream (int fd, int sync, rio_pool *pool);
+BYTE             * rio_sink_buffer (rio_sink *sink);
+int                rio_sink_commit (rio_sink *sink, int len);
+int                rio_sink_close (rio_sink *sink);
+
+rio_name_index   * rio_name_index_new (void);
+void               rio_name_index_add_folders (rio_name_index *index, int card, GList *folders);
+void               rio_name_index_add_songs (rio_name_index *index, int card, int folder_num, GList *songs);
+rio_name_ref     * rio_name_index_folder (rio_name_index *index, char *name);
+rio_name_ref     * rio_name_index_song (rio_name_index *index, char *name);
+GList            * rio_name_index_match (rio_name_index *index, char *pattern, int how, int songs);
+void               rio_name_index_delete (rio_name_index *index);
+
+void               rio_codec_entries (int type, BYTE *entries, int count);
+void               rio_codec_get_mem_status (const BYTE *wire, mem_status *status);
+void               rio_codec_put_folder_location (const folder_location *location, BYTE *wire);
+rio_table        * rio_table_new (int type, int size);
+void               rio_table_delete (rio_table *table);
+int                rio_table_insert (rio_table *table, int i, void *entry);
+int                rio_table_append (rio_table *table, void *entry);
+int                rio_table_remove (rio_table *table, int i);
+void               rio_table_touch (rio_table *table, int i);
+rio_table        * rio_table_from_list (int type, GList *list);
+GList            * rio_table_to_list (rio_table *table);
+rio_table        * rio_read_folder_table (rio_device rio_dev, int card);
+rio_table        * rio_read_song_table (rio_device rio_dev, folder_entry *folder, int folder_num, int card);
+void               rio_write_folder_table (rio_device rio_dev, rio_table *table, int card);
+void               rio_write_song_table (rio_device rio_dev, int folder_num, rio_table *table, int card);
+int                rio_flush_folder_table (rio_device rio_dev, rio_table *table, int card);
+int                rio_flush_song_table (rio_device rio_dev, int folder_num, rio_table *table, int card);
+int                rio_last_write (rio_device rio_dev);
+rio_view         * rio_read_folder_view (rio_device rio_dev, int card);
+rio_view         * rio_read_song_view (rio_device rio_dev, rio_view *folders, int folder_num, int card);
+void               rio_view_delete (rio_view *view);
+rio_names        * rio_names_new (void);
+const char       * rio_names_intern (rio_names *names, const char *name, int max_len);
+void               rio_names_delete (rio_names *names);
+rio_song_list    * rio_read_song_list (rio_device rio_dev, rio_view *folders, int folder_num, int card, rio_names *names);
+void               rio_song_list_delete (rio_song_list *list);
+int                rio_song_bitmap (rio_device rio_dev, rio_view *folders, rio_bitmap_ref *ref, rio_bitmap_data *bitmap);
+
+rio_cache        * rio_cache_new (char *filename);
+void               rio_cache_delete (rio_cache *cache);
+rio_table        * rio_cache_folders (rio_cache *cache, rio_device rio_dev, int card);
+rio_table        * rio_cache_songs (rio_cache *cache, rio_device rio_dev, int card, int folder_num);
+int                rio_cache_wants_songs (rio_cache *cache, int card, int folder_num);
+void               rio_cache_commit (rio_cache *cache, rio_device rio_dev, int card);
+void               rio_cache_invalidate (rio_cache *cache, int card);
+int                rio_cache_mem_status (rio_cache *cache, int card, mem_status *mem);
+int                rio_cache_load (rio_cache *cache);
+int                rio_cache_save (rio_cache *cache);
+
+rio_intent       * rio_intent_new (char *filename);
+void               rio_intent_delete (rio_intent *intent);
+int                rio_intent_record (rio_intent *intent, int card, int folder_num, WORD base, folder_entry *folder);
+int                rio_intent_pending (rio_intent *intent, int card);
+int                rio_intent_apply (rio_intent *intent, rio_table *folders, int card);
+int                rio_intent_clear (rio_intent *intent, int card);
+
+rio_space        * rio_space_new (void);
+void               rio_space_delete (rio_space *space);
+int                rio_space_load (rio_space *space, rio_device rio_dev, int card);
+int                rio_space_seed (rio_space *space, int card, mem_status *mem);
+void               rio_space_forget (rio_space *space, int card);
+DWORD              rio_space_blocks (rio_space *space, int card, unsigned long bytes);
+DWORD              rio_space_free (rio_space *space, int card);
+unsigned long      rio_space_left (rio_space *space, int card);
+int                rio_space_fits (rio_space *space, int card, unsigned long bytes);
+void               rio_space_take (rio_space *space, int card, unsigned long bytes);
+void               rio_space_give (rio_space *space, int card, unsigned long bytes);
+
+rio_frag         * rio_frag_analyze (rio_device rio_dev, rio_table *folders, rio_table **songs, int card);
+void               rio_frag_delete (rio_frag *frag);
+int                rio_frag_compact (rio_device rio_dev, rio_table *folders, rio_table **songs, rio_frag *frag, int card, FILE *log);
+
+int                rio_fsck (rio_device rio_dev, int card, int repair, rio_fsck_report *report, FILE *log);
+
+rio_font         * rio_font_get (char *path, int font_number);
+void               rio_font_put (rio_font *font);
+int                rio_font_preload (char *path, int font_number);
+void               rio_font_flush (void);
+int                rio_font_write_string (rio_font *font, char *string, BYTE *dst);
+rio_font         * rio_font_builtin (void);
+int                rio_font_pack (rio_font *font, BYTE **pack);
+
+int                rio_delete_songs (rio_device rio_dev, rio_table *folders, rio_table *songs, int folder_num, int *song_nums, int count, int card);
+int                rio_delete_songs_keeping (rio_device rio_dev, rio_table *folders, rio_table *songs, int folder_num, int *song_nums, int count, rio_keep_func keep, void *data, int card);
+int                rio_delete_folders (rio_device rio_dev, rio_table *folders, int *folder_nums, int count, int card);
+
+int                rio_move_song_entries (rio_device rio_dev, rio_table *folders, rio_table *from, int from_folder, int *song_nums, int count, rio_table *to, int to_folder, int to_pos, int card);
+int                rio_copy_song_entries (rio_device rio_dev, rio_table *folders, rio_table *from, int from_folder, int *song_nums, int count, rio_table *to, int to_folder, int to_pos, int card);
+int                rio_reorder_song_entries (rio_device rio_dev, rio_table *folders, rio_table *songs, int folder_num, int *order, int card);
+
 
 /* safe_strcpy and safe_strcat from samba */
 char *safe_strcpy(char *dest,const char *src, size_t maxlength);
@@ -1,5 +1,6 @@
 #include <glib.h>
 #include <librio500.h> 
+#include <pthread.h>
 
 #include "config.h"
 
@@ -16,6 +17,7 @@
 #define RIO_INITCOMM -3 /* Error initiating comm with rio */
 #define RIO_ENDCOMM -4 /* Error ending comm with rio */
 #define RIO_FORMAT -5 /* Error formatting rio */
+#define RIO_SHARED -6 /* Folder has songs copied elsewhere */
 
 typedef void (*RioStatusFunc) (int operation, char *msg, int percent);
 
@@ -31,6 +33,18 @@ typedef struct
   RioStatusFunc  stat_func;
   char		 error_code;
   int		 card;
+  rio_pool      *pool;
+  rio_cache     *cache;
+  rio_intent    *intent;           /* NULL unless folder writes are deferred */
+  rio_space     *space;            /* free blocks, counted here */
+  int            prefetch;         /* read the next folder's songs ahead */
+  int            prefetching;
+  int            prefetch_folder;
+  int            prefetch_card;
+#ifndef WITH_USBDEVFS
+  int            prefetch_dev;     /* the fd the prefetch thread reads */
+#endif
+  pthread_t      prefetch_thread;
 } Rio500;
 
 typedef struct
@@ -38,6 +52,7 @@ typedef struct
   char *name;
   GList *songs;
   int    folder_num;
+  int    songs_read;      /* FALSE until rio_get_folder_songs */
 } RioFolderEntry;
 
 typedef struct
@@ -48,17 +63,33 @@ typedef struct
   int             song_num;
 } RioSongEntry;
 
+typedef struct
+{
+  int   folder;
+  int   song;             /* -1 renames the folder itself */
+  char *name;
+} RioRename;
+
 Rio500         *rio_new ();
 
 GList          *rio_get_content (Rio500 *);
+GList          *rio_get_folders (Rio500 *);
+GList          *rio_get_folder_songs (Rio500 *, RioFolderEntry *folder);
+int             rio_set_prefetch (Rio500 *, int prefetch);
 
 int             rio_add_folder (Rio500 *, char *folder_name);
 int             rio_rename_folder (Rio500 *, int folder_num, char *folder_name);
 int             rio_rename_song (Rio500 *, int fn, int sn, char *song_name);
+int             rio_rename (Rio500 *, RioRename *renames, int count);
 int             rio_add_song (Rio500 *, int folder_num, char *file);
 int		rio_add_directory(Rio500 *, char *dir_name, int folder_num);
 int             rio_del_song (Rio500 *, int folder_num, int song_num);
 int             rio_del_folder (Rio500 *, int folder_num);
+int             rio_del_songs (Rio500 *, int folder_num, int *song_nums, int count);
+int             rio_del_folders (Rio500 *, int *folder_nums, int count);
+int             rio_move_songs (Rio500 *, int from_folder, int *song_nums, int count, int to_folder, int to_pos);
+int             rio_copy_songs (Rio500 *, int from_folder, int *song_nums, int count, int to_folder, int to_pos);
+int             rio_reorder_songs (Rio500 *, int folder_num, int *order);
 int             rio_format (Rio500 *);
 unsigned long   rio_memory_left (Rio500 *);
 
@@ -68,5 +99,8 @@ void            rio_delete (Rio500 *);
 int		rio_set_font(Rio500 *, char *font_name, int font_number);
 int		rio_set_card(Rio500 *, int card);
 unsigned long   rio_get_mem_total (Rio500 *);
+int             rio_set_cache_file (Rio500 *, char *filename);
+int             rio_set_intent_log (Rio500 *, char *filename);
+int             rio_flush (Rio500 *);
 
 #endif /* RIO500_API_H */
@@ -0,0 +1,70 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Backup archive layout (all numbers little endian):
+
+     rio_backup_header
+     rio_backup_index     num_entries of them
+     data                 in index order
+
+   For every card there is a RIO_BACKUP_FOLDERS entry holding the folder
+   entries exactly as they sit in the Rio's folder block, one
+   RIO_BACKUP_SONGS entry per folder holding its song block, and one
+   RIO_BACKUP_AUDIO entry per song. All the table entries come first so
+   a restore can read them before it starts streaming the audio.
+*/
+
+#ifndef LIBRIO500_BACKUP_H
+#define LIBRIO500_BACKUP_H
+
+#include "librio500.h"
+
+#define RIO_BACKUP_MAGIC            "RIO500BK"
+#define RIO_BACKUP_VERSION          1
+
+#define RIO_BACKUP_FOLDERS          1
+#define RIO_BACKUP_SONGS            2
+#define RIO_BACKUP_AUDIO            3
+
+#define RIO_BACKUP_RECORD_SIZE      0x800
+#define RIO_BACKUP_MAX_FOLDERS      256
+
+typedef struct
+{
+  BYTE            magic[8];
+  DWORD           version;
+  DWORD           num_entries;
+} rio_backup_header;
+
+typedef struct
+{
+  DWORD           type;
+  DWORD           card;
+  DWORD           folder;
+  DWORD           song;
+  DWORD           offset;
+  DWORD           length;
+} rio_backup_index;
+
+int rio_backup_write (rio_device rio_dev, int fd, int *cards, int num_cards, FILE *log);
+int rio_backup_restore (rio_device rio_dev, int fd, FILE *log);
+
+#endif /* LIBRIO500_BACKUP_H */
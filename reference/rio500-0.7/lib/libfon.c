@@ -22,163 +22,163 @@
 
 #include "libfon.h"
 
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
 #ifdef WORDS_BIGENDIAN
 #include <byteswap.h>
 #endif
 
-struct fon_font *
-fon_load_font (char *filename)
+/* The file is mapped once and walked with a cursor; every read is
+   checked against the end of the map, so a damaged file fails right
+   away instead of seeking about past its end. */
+
+typedef struct {
+	const uint8_t *data;
+	size_t size;
+	size_t pos;
+} fon_map;
+
+static int
+fon_map_need (fon_map *m, size_t n)
 {
-	FILE *fp;
-	MZ_Header MZ_hdr;
-	NE_Header NE_hdr;
-	
-	int i;
+	return (m->pos <= m->size && n <= m->size - m->pos);
+}
 
-#ifdef DEBUG_MASSIVE
-	int x;
-#endif
+static int
+fon_map_seek (fon_map *m, long pos)
+{
+	if (pos < 0 || (size_t) pos > m->size)
+		return -1;
+	m->pos = pos;
+	return 0;
+}
 
-	unsigned int number_of_fonts=0;
-	long header_location=0, bitmap_start_location=0;
-	long charmap_start_location=0;
-	long end_location=0, bitmap_start_offset=0;
-	struct fon_font *font=NULL;
+static uint16_t
+fon_map_le16 (fon_map *m)
+{
+	uint16_t v = m->data[m->pos] | (m->data[m->pos + 1] << 8);
+	m->pos += 2;
+	return v;
+}
 
-#ifdef DEBUG_MASSIVE
-	printf("Debugging set\n");
+/* Leave the cursor on the next nonzero byte */
+static int
+fon_map_skip_zeros (fon_map *m)
+{
+	const uint8_t *p, *end = m->data + m->size;
+
+	for (p = m->data + m->pos; p < end && *p == 0x00; p++)
+		;
+	if (p == end)
+		return -1;
+	m->pos = p - m->data;
+	return 0;
+}
 
-	#ifdef WORDS_BIGENDIAN
-	printf ("WORDS_BIGENDIAN defined.\n");
-	#endif
+/* Leave the cursor on the next zero byte */
+static int
+fon_map_skip_nonzeros (fon_map *m)
+{
+	const uint8_t *p;
+
+	if (m->pos >= m->size)
+		return -1;
+	p = memchr (m->data + m->pos, 0x00, m->size - m->pos);
+	if (p == NULL)
+		return -1;
+	m->pos = p - m->data;
+	return 0;
+}
 
-#endif
-	fp = fopen (filename, "r");
-	if (fp == NULL )
-		return NULL;
+static struct fon_font *
+fon_parse (fon_map *m)
+{
+	MZ_Header MZ_hdr;
+	NE_Header NE_hdr;
+	int i;
+	unsigned int number_of_fonts;
+	long header_location, bitmap_start_location;
+	long charmap_start_location, end_location, bitmap_start_offset;
+	struct fon_font *font;
 
 	/* Read header and check if its a fon file */
-	fread (&MZ_hdr, sizeof (MZ_Header), 1, fp);
+	if (!fon_map_need (m, sizeof (MZ_Header)))
+		return NULL;
+	memcpy (&MZ_hdr, m->data, sizeof (MZ_Header));
 
 #ifdef WORDS_BIGENDIAN
 	MZ_hdr.magic = bswap_16(MZ_hdr.magic);
-        MZ_hdr.dummy[29] = bswap_16(MZ_hdr.dummy[29]);
-	//MZ_hdr.ne_location = bswap_16(MZ_hdr.ne_location); 
+	MZ_hdr.ne_location = bswap_16(MZ_hdr.ne_location);
 #endif
 
-/* ne_location is a 16bit quantity,l_e.  It appears fseek below wants 
-   the location in l_e so it isn't being swapped . -- Keith */
-        
 	if (MZ_hdr.magic != MZ_HEADER_MAGIC) {
 		printf("Invalid MZ Header Magic! %x\n", MZ_hdr.magic);
 		return NULL;
 	}
 
 	/* So far, so good.  It's a MZ exe, at least*/
-	/* Grab the ne_location and seek!*/
-	(void)fseek(fp, MZ_hdr.ne_location, SEEK_SET);
+	/* Grab the ne_location and read in the NE Header */
+	if (fon_map_seek (m, MZ_hdr.ne_location) == -1
+	    || !fon_map_need (m, sizeof (NE_Header)))
+		return NULL;
+	memcpy (&NE_hdr, m->data + m->pos, sizeof (NE_Header));
 
-	/* Read in the NE Header and check */
-	fread (&NE_hdr, sizeof (NE_Header), 1, fp);
-	
 	#ifdef WORDS_BIGENDIAN
 	NE_hdr.magic = bswap_16(NE_hdr.magic);
-	NE_hdr.dummy1[15] = bswap_16(NE_hdr.dummy1[15]);
-	
-	//NE_hdr.nonres_name_length = bswap_16(NE_hdr.nonres_name_length);
-	/* fseek seems to like l_e quantities */
-	
-	/* Ok . . I'm an idiot, nonres_name_start was 32bit, can use bswap */
-	
-	NE_hdr.nonres_name_start=bswap_32(NE_hdr.nonres_name_start);
-	#endif 
-	
+	NE_hdr.nonres_name_length = bswap_16(NE_hdr.nonres_name_length);
+	NE_hdr.nonres_name_start = bswap_32(NE_hdr.nonres_name_start);
+	#endif
+
 	if (NE_hdr.magic != NE_HEADER_MAGIC ) {
 		printf("Invalid NE Header Magic! %x\n", NE_hdr.magic);
 		return NULL;
 	}
-	
-	/* Good, it's a NE type executable. */
-  	/* Seek the Nonresident names table. */
-	(void)fseek(fp, NE_hdr.nonres_name_start, SEEK_SET); 
-
-	/* First byte of the nonres table is the length of the
-	text.  We are skipping the nonres_name*/
-	(void)fseek(fp, NE_hdr.nonres_name_length, SEEK_CUR);
-
-	/* It looks as if the header is now padded with zeros 
-	I initially thought that this was to make the font header 
-	start at a multiple of 0x10 boundry, but looking at some
-	font files, this isn't the case some of the time.  Just skip
-	all zeros.*/
-	(void)fon_skip_zeros(fp);
-
-	/* Now, the file pointer SHOULD point to the first
-	font header.  Preceeding it are a couple of bytes 
-	that tell us how many fonts are in the file */
-	fread(&number_of_fonts, 2, 1, fp);
-	
-	#ifdef WORDS_BIGENDIAN
-	number_of_fonts = bswap_32(number_of_fonts);
-	#endif 
-	/* font info stored in 32bit 32bit 32bit l_e format for win fonts */
-	/* need to swap to use on ppc */
-
-	/* Here are a couple of bytes that I have no clue about.
-	skipping them */
-	fseek(fp, 2, SEEK_CUR);
-
-	/* Finally, we're at the main font header location */
-	header_location = ftell(fp);
-	/* Allocate Memory */
-	/* Bruce, I took the allocations out of the ifs to make it easier to print out
-	   addresses when I was debugging . . hope you don't mind . . we could put them
-	   back as they were now that things are running . .  keith */
-	font = malloc(sizeof(struct fon_font));
-	if (font==NULL)
-	{
-                printf("Could not allocate memory for font headers!\n");
-                return NULL;
-        }
-	font->Header = calloc(number_of_fonts,sizeof(struct Font_header));
-	if (font->Header==NULL)
-        {
-		printf("Falling in font->header\n");
-		printf("Could not allocate memory for font headers!\n");
-		free(font);
+
+	/* Good, it's a NE type executable. Skip the nonresident name,
+	then the zeros the font header is padded with. Just before the
+	first font header are the number of fonts in the file and a
+	couple of bytes that I have no clue about. */
+	if (fon_map_seek (m, (long) NE_hdr.nonres_name_start + NE_hdr.nonres_name_length) == -1
+	    || fon_map_skip_zeros (m) == -1
+	    || !fon_map_need (m, 4))
+		return NULL;
+	number_of_fonts = fon_map_le16 (m);
+	m->pos += 2;
+	if (number_of_fonts == 0)
 		return NULL;
 
-        }
-	font->Charmap=calloc(number_of_fonts,sizeof(struct Win_charmap));
-	if (font->Charmap==NULL)
+	font = calloc(1, sizeof(struct fon_font));
+	if (font==NULL)
 	{
-		printf("Could not allocate memory for charmaps!\n");
-		free(font->Header);
-		free(font);
+		printf("Could not allocate memory for font headers!\n");
 		return NULL;
 	}
+	font->Header = calloc(number_of_fonts,sizeof(struct Font_header));
+	font->Charmap = calloc(number_of_fonts,sizeof(struct Win_charmap));
 	font->Bitmap = calloc(number_of_fonts,sizeof(struct Win_bitmap));
-	if (font->Bitmap==NULL)
+	if (font->Header==NULL || font->Charmap==NULL || font->Bitmap==NULL)
 	{
-		printf("Could not allocate memory for bitmaps!\n");
-		free(font->Charmap);
-		free(font->Header);
-		free(font);
+		printf("Could not allocate memory for font headers!\n");
+		fon_delete_font(font);
 		return NULL;
 	}
-
 	font->number_of_fonts = number_of_fonts;
-	/* Now, we should have plenty of space allocated to read in all of the Headers */
-	/* Read them into memory */
 
 	for (i=0; i<font->number_of_fonts; i++) {
-		(void)fread(&font->Header[i], sizeof( struct Font_header ), 1, fp);
+		if (!fon_map_need (m, sizeof (struct Font_header)))
+			goto bad;
+		memcpy (&font->Header[i], m->data + m->pos, sizeof (struct Font_header));
+		m->pos += sizeof (struct Font_header);
 	/* Skip the fontname (since it is a variable size, with no discernable
 	entry anywhere to describe that size... */
-		(void)fon_skip_nonzeros(fp);
-		(void)fseek(fp, 3, SEEK_CUR);
-	
-	/* Do any sort of byte swapping necessary for big endian after reading data */
+		if (fon_map_skip_nonzeros (m) == -1)
+			goto bad;
+		m->pos += 3;
 
 	#ifdef WORDS_BIGENDIAN
 	font->Header[i].Windows_version = bswap_16(font->Header[i].Windows_version);
@@ -189,7 +189,6 @@ fon_load_font (char *filename)
 	font->Header[i].Vertical_resolution = bswap_16(font->Header[i].Vertical_resolution);
 	font->Header[i].Horizontal_resolution = bswap_16(font->Header[i].Horizontal_resolution);
 	#endif
-
 	}
 #ifdef DEBUG_MASSIVE
 	for (i=0; i<font->number_of_fonts; i++) {
@@ -216,108 +215,104 @@ fon_load_font (char *filename)
 #endif
 
 	for (i=0; i<font->number_of_fonts; i++) {
-		(void)fon_skip_zeros(fp);
-
 	/* Back up 1...  Need that previous zero... */
-		(void)fseek(fp, -1, SEEK_CUR);
-		header_location = ftell(fp);
+		if (fon_map_skip_zeros (m) == -1 || m->pos == 0)
+			goto bad;
+		header_location = --m->pos;
 
 		/* Now, we are at a repeat of a header.  Since it is an exact duplicate,
-		skip it and begin reading the pertinant data into memory */
-		(void)fseek(fp, 0x71, SEEK_CUR);
-
-		/* At this point, the file pointer points to a word that provides us an offset
-		from the header_location to the actual bitmap data start location */
-		(void)fread(&bitmap_start_offset, 2, 1, fp);
-
-		#ifdef WORDS_BIGENDIAN
-		bitmap_start_offset = bswap_32(bitmap_start_offset);
-		#endif
-		
-		/* b_s_off comes out of .fon in l_e, need to convert */
+		skip it. Next comes the offset from header_location to the bitmap data */
+		if (fon_map_seek (m, header_location + 0x71) == -1
+		    || !fon_map_need (m, 2))
+			goto bad;
+		bitmap_start_offset = fon_map_le16 (m);
 
 		font->Charmap[i].First_bitmap_offset = bitmap_start_offset;
 
 		bitmap_start_location = header_location + bitmap_start_offset;
 		end_location = header_location + (font->Header[i].Offset_to_next_fontH*256+font->Header[i].Offset_to_next_fontL);
 
-		
-		if (font->Header[i].Windows_version == 0x200)
-			(void)fseek(fp, 0x3, SEEK_CUR);
-		else
-			(void)fseek(fp, 0x21, SEEK_CUR);
-
-		charmap_start_location = ftell(fp);
-
-#ifdef DEBUG_MASSIVE
-	printf("header_location %lx\n", header_location);
-	printf("charmap_start_loccation %lx\n", charmap_start_location);
-	printf("bitmap_start_offset %lx\n", bitmap_start_offset);
-	printf("bitmap_start_location %lx\n", bitmap_start_location);
-	printf("end_location %lx\n", end_location);
-#endif
-
-		/* OK, now we need to read the character maps into memory.  This requires some logic
-		on our part, since there are two types of character maps.  One type is Windows 2.0
-		format and the other is Windows 3.0 format. */
-		if (font->Header[i].Windows_version == 0x200) {
-		/* Windows 2.00 format */
-		/* Now, load in the character table and the bitmap data into structs */
-			font->Charmap[i].length = bitmap_start_location - charmap_start_location;
-			font->Charmap[i].data = malloc(font->Charmap[i].length);
-			(void)fread(font->Charmap[i].data, font->Charmap[i].length, 1, fp);
-#ifdef DEBUG_MASSIVE
-			for (x=0; x<font->Charmap[i].length; x++) {
-				printf("%.2x ", font->Charmap[i].data[x]);
-				if (x%16 == 15)
-					printf("\n");
-			}
-			printf("\n");
-#endif
-		/* OK. Charmap is in memory, now. Read in Bitmap */
-			font->Bitmap[i].length = end_location - bitmap_start_location;
-			font->Bitmap[i].data = malloc(font->Bitmap[i].length);
-			(void)fread(font->Bitmap[i].data, font->Bitmap[i].length, 1, fp);
-		/* OK.  Bitmap data is in memory (Finally!) */
-#ifdef DEBUG_MASSIVE
-			for (x=0; x<font->Bitmap[i].length; x++) {
-				printf("%.2x ", font->Bitmap[i].data[x]);
-				if (x%16 == 15)
-					printf("\n");
-			}
-			printf("\n");
-#endif
-		} else {
-		/* Must be Windows 3.00 format */
+		if (font->Header[i].Windows_version != 0x200) {
 			printf("Windows 3.0 Not currently supported\n");
-			free(font->Bitmap);
-			free(font->Charmap);
-			free(font->Header);
-			free(font);
+			fon_delete_font(font);
 			return NULL;
 		}
 
-		/* Lastly, let's read the bitmap data into memory */
+		/* Windows 2.00 format: the character table, then the bitmap data */
+		charmap_start_location = m->pos + 0x3;
+		if (charmap_start_location > bitmap_start_location
+		    || bitmap_start_location > end_location
+		    || (size_t) end_location > m->size)
+			goto bad;
+
+		font->Charmap[i].length = bitmap_start_location - charmap_start_location;
+		font->Charmap[i].data = malloc(font->Charmap[i].length + 1);
+		font->Bitmap[i].length = end_location - bitmap_start_location;
+		font->Bitmap[i].data = malloc(font->Bitmap[i].length + 1);
+		if (font->Charmap[i].data == NULL || font->Bitmap[i].data == NULL)
+			goto bad;
+		memcpy(font->Charmap[i].data, m->data + charmap_start_location, font->Charmap[i].length);
+		memcpy(font->Bitmap[i].data, m->data + bitmap_start_location, font->Bitmap[i].length);
+
+		/* Seek next font structure, past its name */
+		if (i + 1 < font->number_of_fonts)
+		{
+			if (fon_map_seek (m, end_location + 1) == -1
+			    || fon_map_skip_nonzeros (m) == -1)
+				goto bad;
+			m->pos += 3;
+		}
+	}
 
-		/* Seek next font structure */
-		(void)fseek(fp, end_location+1, SEEK_SET);
-	/* Skip the fontname (since it is a variable size, with no discernable
-	entry anywhere to describe that size... */
-		(void)fon_skip_nonzeros(fp);
-		(void)fseek(fp, 3, SEEK_CUR);
+	return font;
+
+bad:
+	printf("Font file is damaged\n");
+	fon_delete_font(font);
+	return NULL;
+}
+
+struct fon_font *
+fon_load_font (char *filename)
+{
+	struct fon_font *font;
+	struct stat st;
+	fon_map m;
+	void *data;
+	int fd;
+
+	fd = open (filename, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+	if (fstat (fd, &st) == -1 || st.st_size == 0) {
+		close (fd);
+		return NULL;
 	}
 
-	fclose(fp);
+	data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (data == MAP_FAILED)
+		return NULL;
+
+	m.data = (const uint8_t *) data;
+	m.size = st.st_size;
+	m.pos = 0;
+	font = fon_parse (&m);
+
+	munmap (data, st.st_size);
 	return font;
 }
 
+/* The parser above no longer uses these; they are kept for outside
+   callers that walk a .fon FILE themselves. */
 void
 fon_skip_zeros( FILE * fp )
 {
 	uint8_t data=0x00;	
 	long file_location = 0;
 	while ( data == 0x00 )
-		(void)fread(&data, 1, 1, fp);
+		if (fread(&data, 1, 1, fp) != 1)
+			return;
 	file_location = ftell(fp);
 	(void)fseek(fp, file_location-1, SEEK_SET);
 }
@@ -328,7 +323,8 @@ fon_skip_nonzeros( FILE *fp )
 	uint8_t data=0x01;
 	long file_location = 0;
         while ( data != 0x00 )
-                (void)fread(&data, 1, 1, fp);
+                if (fread(&data, 1, 1, fp) != 1)
+                        return;
 	file_location = ftell(fp);
 	(void)fseek(fp, file_location-1, SEEK_SET);
 }
@@ -423,6 +419,13 @@ fon_write_string (struct fon_font *f, char *string, unsigned char *dst)
 void
 fon_delete_font (struct fon_font *f)
 {
+  int i;
+
+  for (i = 0; f->Charmap && f->Bitmap && i < f->number_of_fonts; i++)
+  {
+    free (f->Charmap[i].data);
+    free (f->Bitmap[i].data);
+  }
   if (f->Header)
     free (f->Header);
   if (f->Charmap)
@@ -35,7 +35,10 @@ psf_load_font (char *filename)
 	/* Read header anc check its a psf file */
 	fread (&hdr, sizeof (psf_header), 1, fp);
 	if (hdr.magic != 0x3604 && hdr.magic != 0x0436)
+	{
+		fclose (fp);
 		return NULL;
+	}
 	
 	font = malloc (sizeof (psf_font));
 	if (font == NULL)
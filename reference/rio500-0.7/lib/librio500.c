@@ -44,24 +44,18 @@ void
 send_folder_location (int fd, int offset, int folder_num, int card)
 {
   folder_location location;
+  BYTE            wire[RIO_FOLDER_LOCATION_SIZE];
 
   memset (&location, 0, sizeof (folder_location));
   location.offset = (WORD) offset;
   location.bytes = (WORD) 0x4000;
   location.folder_num = (WORD) folder_num;
 
-
-/* this struct written from cpu to rio, for big_endian platforms, 
-   need to byteswap to get to le */
-
-#ifdef WORDS_BIGENDIAN
-  location.offset     = bswap_16(location.offset);
-  location.bytes      = bswap_16(location.bytes);
-  location.folder_num = bswap_16(location.folder_num);
-#endif
+  /* this struct written from cpu to rio, in rio (little endian) order */
+  rio_codec_put_folder_location (&location, wire);
 
   rio_ctl_msg (fd, RIO_DIR_OUT, 0x56, 0, 0, 
-               sizeof(folder_location), (BYTE*)&location);
+               RIO_FOLDER_LOCATION_SIZE, wire);
 }
 
 void
@@ -75,26 +69,17 @@ mem_status *
 get_mem_status (int fd, int card)
 {
   static mem_status status;
+  BYTE              wire[RIO_MEM_STATUS_SIZE];
 
-  memset (&status, 0, sizeof (mem_status));
+  memset (wire, 0, sizeof (wire));
 
   /* set card from which to get memory status */
   send_command (fd, 0x51, 1, card);
 
-  rio_ctl_msg (fd, RIO_DIR_IN, 0x57, 0, 0, sizeof(status), (BYTE*)&status);
+  rio_ctl_msg (fd, RIO_DIR_IN, 0x57, 0, 0, RIO_MEM_STATUS_SIZE, wire);
 
-/* this struct "filled" by the rio.  Need to switch to big_endian for ppc 
-   to read correctly */
-
-#ifdef WORDS_BIGENDIAN
-  status.dunno1 = bswap_16(status.dunno1);
-  status.block_size = bswap_16(status.block_size);
-  status.num_blocks = bswap_16(status.num_blocks);
-  status.first_free_block = bswap_16(status.first_free_block);
-  status.num_unused_blocks = bswap_16(status.num_unused_blocks);
-  status.dunno2 = bswap_32(status.dunno2);
-  status.dunno3 = bswap_32(status.dunno3);
-#endif
+  /* this struct "filled" by the rio, in rio (little endian) order */
+  rio_codec_get_mem_status (wire, &status);
 
   return &status;
 }
@@ -141,264 +126,6 @@ get_num_folder_blocks (int fd, int address, int card)
 }
 
 
-GList *
-read_folder_entries (int fd, int card)
-{
-  BYTE           *folder_block, *pb;
-  GList          *entry_list = NULL;
-  folder_entry   *entry, *copy;
-  int            total_read, folder_count=0;
-  unsigned long  com_status;
-  unsigned long  folder_block_count;
-  unsigned long  total_folder_block_size;
-
-  /* Determine number of folder blocks */
-  folder_block_count = get_num_folder_blocks (fd, 0xff00, card);
-  if (folder_block_count == -1)
-    return NULL;
-
-  total_folder_block_size = FOLDER_BLOCK_SIZE * folder_block_count;
-
-  /* Assign space for folder block */
-  folder_block = (BYTE *) malloc (total_folder_block_size);
-   if (folder_block == NULL)
-     return NULL;
-
-   /* Read folder list */
-  com_status = send_read_command (fd, 0xff00, folder_block_count, card);
-   if (com_status == -1) {
-	free(folder_block);
-        return NULL;
-   }
-
-  total_read = bulk_read ( fd, folder_block, total_folder_block_size);
-
-  if (total_read != total_folder_block_size) {
-     free(folder_block);
-     return NULL;
-  }
-
-  /* Make a list of entries: one for each folder. */
-   pb = folder_block;
-   entry = (folder_entry *)pb;
-  while (entry->offset != 0xffff && folder_count<8*folder_block_count)
-  {
-    copy = calloc (sizeof (folder_entry), 1);
-    memcpy (copy, entry, sizeof (folder_entry));
-    #ifdef WORDS_BIGENDIAN
-      bswap_folder_entry (copy);
-    #endif
-    entry_list = g_list_append (entry_list, copy);
-    folder_count++;
-    pb += sizeof (folder_entry);
-    entry = (folder_entry *)pb;
-  }
-
-  free (folder_block);
-  return g_list_first (entry_list);
-}
-
-
-GList *
-read_song_entries (int fd, GList *folder_entries, int folder_num, int card)
-{
-  folder_entry *folder;
-  song_entry *song, *song_copy;
-  BYTE *song_block, *ps;
-  GList *item, *song_list = NULL;
-  unsigned long  com_status;
-  int    total_read, address, num_blocks;
-  int    size, count;
-
-  item = g_list_nth (folder_entries, folder_num);
-  if (item == NULL)
-    return NULL;
-  folder = (folder_entry*) item->data;
-  if (folder == NULL)
-    return NULL;
-
-  /* Calculate how many blocks this folder uses up */
-  num_blocks = folder->fst_free_entry_off / 0x4000;
-  count = 8 * num_blocks;
-  if ( (folder->fst_free_entry_off % 0x4000) > 0 )
-    num_blocks++;
-  count += (folder->fst_free_entry_off % 0x4000) / 0x800;
-
-  if (num_blocks == 0)
-    return NULL;
-
-  /* Read numblocks */
-  address = folder_num;
-  address <<= 8;
-  address |= 0x00ff;
-  address &= 0x0fff;
-
-  size = num_blocks * FOLDER_BLOCK_SIZE;
-  song_block = (BYTE *) malloc ( size+1 );
-  if (song_block == NULL)
-    return NULL;
-
-  /* Read folder list */
-  com_status = send_read_command (fd, address, num_blocks, card);
-   if (com_status == -1) {
-	free(song_block);
-        return NULL;
-   }
-
-  total_read = bulk_read (fd, song_block, size );
-  if ( total_read != size ) {
-    free(song_block);
-    return (NULL);
-  }
-
-  /* Make list */
-  ps = song_block;
-  song = (song_entry *)ps;
-  while (count > 0 && song->offset != 0xffff)
-  {
-    song_copy = calloc (1, sizeof (song_entry));
-    memcpy (song_copy, song, sizeof (song_entry) );
-    #ifdef WORDS_BIGENDIAN
-      bswap_song_entry (song_copy);
-    #endif
-    song_list = g_list_append (song_list, song_copy);
-    ps += sizeof (song_entry);
-    song = (song_entry *)ps;
-    count--;
-  }
-  
-
-  free (song_block);
-
-  if (song_list)
-    return g_list_first(song_list);
-  else 
-    return NULL;
-}
-
-void
-write_folder_entries (int fd, GList *folder_list, int card)
-{
-  int          num_blocks, list_len;
-  int          count;
-  BYTE         *block, *p;
-  GList        *item;
-  folder_entry *entry;
-
-  block = new_empty_block();
-  /* If there are no entries just send a blank block */
-  if (folder_list == NULL)
-  {
-    send_write_command (fd, 0xff00, 1, card);
-    bulk_write (fd, block, 0x4000);
-    free (block);
-    return;
-  }
-
-  list_len = g_list_length (folder_list);
-
-  num_blocks = list_len >> 3; /* len / 8. There are 8 entries per block */
-  if (list_len & 0x7)
-    num_blocks++;
-
-  send_write_command (fd, 0xff00, num_blocks, card);
-  p = block;
-  count = 0;
-  for (item = g_list_first (folder_list); item; item = item->next)
-  {
-    /* copy up to 8 entries */
-    entry = (folder_entry*) p;
-    memcpy (p, item->data, sizeof (folder_entry));
-    #ifdef WORDS_BIGENDIAN
-      bswap_folder_entry ((folder_entry*)p);
-    #endif 
-    p += sizeof (folder_entry);
-    count++;
-    if (count == 8)
-    {
-      /* Write the block */
-      bulk_write (fd, block, 0x4000);
-      count = 0;
-      clear_block (block);
-      p = block;
-    }
-  }
-
-  /* Write the last block if it was not full */
-  if (count != 0)
-    bulk_write (fd, block, 0x4000);
-
-  free (block);
-  return;
-}
-
-void
-write_song_entries (int fd, int folder_num, GList *song_list, int card)
-{
-  int          num_blocks, list_len;
-  int          count, address;
-  BYTE         *block, *p;
-  GList        *item;
-  song_entry *entry;
-
-  /* Define address */
-  address = folder_num;
-  address <<= 8;
-  address |= 0x00ff;
-  address &= 0xffff;
-
-  block = new_empty_block ();
-
-  /* If there are no entries just send a black block */
-  if (song_list == NULL)
-  {
-    send_write_command (fd, address, 1, card);
-    bulk_write (fd, block, 0x4000);
-    free(block);
-    return;
-  }
-
-  list_len = g_list_length (song_list);
-
-  num_blocks = list_len >> 3; /* len / 8. There are 8 entries per block */
-  if (list_len & 0x7)
-    num_blocks++;
-
-  /* Set to what folder this items go */
-  send_write_command (fd, address, num_blocks, card);
-
-  /* Now write the items to the bulk pipe in 0x4000 byte chunks*/
-  p = block;
-  count = 0;
-  for (item = g_list_first (song_list); item; item = item->next)
-  {
-    /* copy up to 8 entries */
-    entry = (song_entry*) p;
-    memcpy (p, item->data, sizeof (song_entry));
-    #ifdef WORDS_BIGENDIAN
-      bswap_song_entry ((song_entry*)p);
-    #endif
-    p += sizeof (song_entry);
-    count++;
-    if (count == 8)
-    {
-      /* Write the block */
-      bulk_write (fd, block, 0x4000);
-      count = 0;
-      clear_block (block);
-      p = block;
-    }
-  }
-
-  /* Write the last block if it was not full */
-  if (count != 0)
-    bulk_write (fd, block, 0x4000);
-
-  free (block);
-  return; 
-}
-
-
 /* Folder and song operations */
 
 song_entry *
@@ -476,25 +203,13 @@ folder_entry_new (char *name, char *font_name, int font_number)
 void
 bswap_folder_entry (folder_entry *fe)
 {
-  fe->offset = bswap_16(fe->offset);
-  fe->dunno1 = bswap_16(fe->dunno1);
-  fe->fst_free_entry_off = bswap_16(fe->fst_free_entry_off);
-  fe->dunno2 = bswap_16(fe->dunno2);
-  fe->dunno3 = bswap_32(fe->dunno3);
-  fe->dunno4 = bswap_32(fe->dunno4);
-  fe->time = bswap_32(fe->time);
+  rio_codec_entries (RIO_TABLE_FOLDERS, (BYTE *) fe, 1);
 }
 
 void
 bswap_song_entry (song_entry *se)
 {
-  se->offset = bswap_16(se->offset);
-  se->dunno1 = bswap_16(se->dunno1);
-  se->length = bswap_32(se->length);
-  se->dunno2 = bswap_16(se->dunno2);
-  se->dunno3 = bswap_16(se->dunno3);
-  se->mp3sig = bswap_32(se->mp3sig);
-  se->time = bswap_32(se->time);
+  rio_codec_entries (RIO_TABLE_SONGS, (BYTE *) se, 1);
 }
 
 
@@ -764,8 +479,7 @@ bitmap_data_new (char *name, char *font_name, int font_number)
 		      0x20, 0x20, 0x20, 0xc0,
 		      0x00, 0x00, 0x00, 0x00};
   rio_bitmap_data *new_bitmap;
-  struct fon_font *f;
-  psf_font *g;
+  rio_font *f;
 
   if (name == NULL)
     return smiley_new ();
@@ -774,27 +488,21 @@ bitmap_data_new (char *name, char *font_name, int font_number)
   new_bitmap = malloc ( sizeof (rio_bitmap_data) );
   if (new_bitmap)
   {
-    f = fon_load_font (font_name);
+    /* Loaded once per process, see librio500_font.c */
+    f = rio_font_get (font_name, font_number);
+    if (f == NULL && (f = rio_font_get (DEFAULT_PSF_FONT, 0)) != NULL)
+      printf("%s load failed.  Trying default.psf font\n",font_name);
+    if (f == NULL)
+      f = rio_font_builtin ();
     if (f)
     {
-      f->font_number = font_number;
-      new_bitmap->num_blocks = fon_write_string (f, name, 
+      new_bitmap->num_blocks = rio_font_write_string (f, name, 
 		(BYTE*)&new_bitmap->bitmap);
-      fon_delete_font (f);
+      rio_font_put (f);
     } else {
-      g = psf_load_font(DEFAULT_PSF_FONT);
-      if (g)
-      {
-	printf("%s load failed.  Trying default.psf font\n",font_name);
-	new_bitmap->num_blocks = psf_write_string(g, name,
-		  (BYTE*)&new_bitmap->bitmap);
-        psf_delete_font (g);
-      }
-      else {
-        printf("All font loads failed.  Creating folder named mp3\n");
-	memcpy (&new_bitmap->bitmap, mp3_bits, 48);
-        new_bitmap->num_blocks = 3;
-      }
+      printf("All font loads failed.  Creating folder named mp3\n");
+      memcpy (&new_bitmap->bitmap, mp3_bits, 48);
+      new_bitmap->num_blocks = 3;
     }
   }
 
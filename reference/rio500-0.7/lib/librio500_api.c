@@ -13,30 +13,37 @@
 static void rio_api_open_l (Rio500 *rio);
 static void rio_api_clear_folders_l (GList *folders);
 static void rio_api_clear_songs_l (GList *songs);
-static GList *rio_api_read_songs_l (Rio500 *rio, GList *folders, int numf);
+static GList *rio_api_read_songs_l (Rio500 *rio, int numf);
+static void   rio_api_prefetch_l (Rio500 *rio, int folder_num);
+static void   rio_api_prefetch_wait_l (Rio500 *rio);
+static int    rio_api_flush_l (Rio500 *rio);
+static void   rio_api_space_l (Rio500 *rio, int card);
+
+static int    move_songs (Rio500 *rio, int from_folder, int *song_nums, int count, int to_folder, int to_pos, int copy);
+static int    rename_entries (Rio500 *rio, RioRename *renames, int count);
+static int    rename_replace (rio_table *table, int i, void *new_entry, DWORD *new_time);
+static int    rename_renders (RioRename *renames, int count, int folder_num);
+static int    read_all_songs (rio_cache *, rio_device rio_dev, rio_table *folders, int card);
+static int    song_shared (int folder_num, int song_num, void *data);
 
 static int    write_song (Rio500 *rio, char *filename);
 static int    file_size (char *filename);
 
 #ifndef WITH_USBDEVFS
 
-static int    remove_folder (int fd, int folder_num, int card);
-static int    remove_song (int fd, int song_num, int folder_num, int card);
+static int    remove_folders (rio_cache *, int fd, RioStatusFunc stat_func, int *folder_nums, int count, int card);
+static int    remove_songs (rio_cache *, int fd, int *song_nums, int count, int folder_num, int card);
 static int    is_first_folder (int fd, int card);
-static GList *add_song_to_list (GList *, char *fnm, int o, char *font, int fn);
-static void   add_folder (int fd, char *name, char *font_name, int font_number, int card);
-static void   rename_folder (int rio_dev, int folder_num, char *name, char *font_name, int font_number, int card);
-static void   rename_song (int rio_dev, int folder_num, int song_num, char *name, char *font_name, int font_number, int card);
+static int    add_song_to_table (rio_table *, char *fnm, int o, char *font, int fn);
+static void   add_folder (rio_cache *, int fd, char *name, char *font_name, int font_number, int card);
 
 #else /* With USBDEFVFS */
 
-static int    remove_folder (struct usbdevice *rio_dev, int folder_num, int card);
-static int    remove_song (struct usbdevice *rio_dev, int song_num, int folder_num, int card);
+static int    remove_folders (rio_cache *, struct usbdevice *rio_dev, RioStatusFunc stat_func, int *folder_nums, int count, int card);
+static int    remove_songs (rio_cache *, struct usbdevice *rio_dev, int *song_nums, int count, int folder_num, int card);
 static int    is_first_folder (struct usbdevice *rio_dev, int card);
-static GList *add_song_to_list (GList *, char *fnm, int o, char *font, int fn);
-static void   add_folder (struct usbdevice *rio_dev, char *name, char *font_name, int font_number, int card);
-static void rename_folder (struct usbdevice *rio_dev, int folder_num, char *name, char *font_name, int font_number, int card);
-static void rename_song (struct usbdevice *rio_dev, int folder_num, int song_num, char *name, char *font_name, int font_number, int card);
+static int    add_song_to_table (rio_table *, char *fnm, int o, char *font, int fn);
+static void   add_folder (rio_cache *, struct usbdevice *rio_dev, char *name, char *font_name, int font_number, int card);
 
 #endif /* WITH_USBDEVFS */
 
@@ -76,6 +83,9 @@ rio_new ()
   strcat(font_name, DEFAULT_FON_FONT);
   instance->font = font_name;
   instance->card = 0;
+  instance->pool = rio_pool_new ();
+  instance->cache = rio_cache_new (NULL);
+  instance->space = rio_space_new ();
   rio_api_open_l (instance);
 
   return instance;
@@ -90,6 +100,12 @@ void
 rio_delete (Rio500 *rio)
 {
   g_return_if_fail (rio != NULL);
+  rio_api_prefetch_wait_l (rio);
+  if (rio->intent != NULL)
+  {
+    rio_flush (rio);
+    rio_intent_delete (rio->intent);
+  }
 #ifndef WITH_USBDEVFS
   if (rio->rio_dev > 0)
     close (rio->rio_dev);
@@ -97,6 +113,9 @@ rio_delete (Rio500 *rio)
   if (rio->rio_dev != NULL)
     usb_close(rio->rio_dev);
 #endif
+  rio_pool_delete (rio->pool);
+  rio_cache_delete (rio->cache);
+  rio_space_delete (rio->space);
   free (rio);
   return;
 }
@@ -133,6 +152,8 @@ rio_format (Rio500 *rio)
   start_comm (rio);
 
   format_flash (rio->rio_dev,rio->card);
+  rio_intent_clear (rio->intent, rio->card);
+  rio_space_forget (rio->space, rio->card);
 
   end_comm (rio);
 
@@ -171,7 +192,8 @@ rio_format (Rio500 *rio)
 GList *
 rio_get_content (Rio500 *rio)
 {
-  GList *folders, *content, *item, *song_item;
+  GList *content, *song_item;
+  rio_table *folders;
   RioFolderEntry *folder;
   RioSongEntry *song;
   folder_entry *entry;
@@ -184,22 +206,19 @@ rio_get_content (Rio500 *rio)
   start_comm (rio);
 
   /* Read the stuff */
-  folders = read_folder_entries (rio->rio_dev, rio->card);
-  folder_num = 0;
+  folders = rio_cache_folders (rio->cache, rio->rio_dev, rio->card);
   content = NULL;
 
-  /* Check to see if read_folder_entries returned nada */
-  if (folders == NULL)
+  /* Check to see if the folder table read returned nada */
+  if (folders == NULL || folders->count == 0)
   {
      end_comm(rio);
      return NULL;
   }
 
-  for (item = g_list_first (folders); item; item = item->next)
+  for (folder_num = 0; folder_num < folders->count; folder_num++)
    {
-     entry = (folder_entry *)item->data;
-     if (entry == NULL)
-       continue;
+     entry = rio_table_folder (folders, folder_num);
      folder = calloc (sizeof (RioFolderEntry), 1);
      if (folder)
      {
@@ -207,25 +226,124 @@ rio_get_content (Rio500 *rio)
        sprintf (message, "Reading songs from folder %s", folder->name);
        if (rio->stat_func)
          (*rio->stat_func)(0, message, 0);
-       folder->songs = rio_api_read_songs_l (rio, folders,  folder_num);
+       folder->songs = rio_api_read_songs_l (rio, folder_num);
        folder->folder_num = folder_num;
+       folder->songs_read = TRUE;
        song_item = g_list_first (folder->songs);
        for ( ; song_item ; song_item = song_item->next)
 	 {
 	   song = (RioSongEntry *) song_item->data;
 	   song->parent = folder;
 	 }
-       content = g_list_append (content, folder);
-       folder_num++;
+       content = g_list_prepend (content, folder);
      }
    }
 
   /* Finish communication */
   end_comm (rio);
 
-  return g_list_first (content);
+  return g_list_reverse (content);
+}
+
+
+/* -------------------------------------------------------------------
+   NAME:        rio_get_folders
+   DESCRIPTION: Like rio_get_content but only reads the folder table.
+                The songs field of every folder stays NULL until
+                rio_get_folder_songs is called for it. Free with
+                rio_destroy_content.
+   ------------------------------------------------------------------- */
+
+GList *
+rio_get_folders (Rio500 *rio)
+{
+  GList *content;
+  rio_table *folders;
+  RioFolderEntry *folder;
+  int folder_num;
+
+  g_return_val_if_fail (rio != NULL, NULL);
+
+  start_comm (rio);
+
+  folders = rio_cache_folders (rio->cache, rio->rio_dev, rio->card);
+  content = NULL;
+  for (folder_num = 0; folders && folder_num < folders->count; folder_num++)
+  {
+    folder = calloc (sizeof (RioFolderEntry), 1);
+    if (folder)
+    {
+      folder->name = g_strdup ((char *) rio_table_folder (folders, folder_num)->name1);
+      folder->folder_num = folder_num;
+      content = g_list_prepend (content, folder);
+    }
+  }
+
+  end_comm (rio);
+
+  /* Most callers look at the first folder next */
+  if (content != NULL)
+    rio_api_prefetch_l (rio, 0);
+
+  return g_list_reverse (content);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_get_folder_songs
+   DESCRIPTION: The RioSongEntries of a folder returned by
+                rio_get_folders, read from the rio the first time. With
+                prefetching on, the next folder's songs are then read
+                in the background.
+   ------------------------------------------------------------------- */
+
+GList *
+rio_get_folder_songs (Rio500 *rio, RioFolderEntry *folder)
+{
+  GList *song_item;
+
+  g_return_val_if_fail (rio != NULL, NULL);
+  g_return_val_if_fail (folder != NULL, NULL);
+
+  if (folder->songs_read)
+    return folder->songs;
+
+  start_comm (rio);
+
+  /* Make sure the tables are still the ones the folder came from */
+  if (rio_cache_folders (rio->cache, rio->rio_dev, rio->card) != NULL)
+    folder->songs = rio_api_read_songs_l (rio, folder->folder_num);
+  for (song_item = folder->songs; song_item; song_item = song_item->next)
+    ((RioSongEntry *) song_item->data)->parent = folder;
+  folder->songs_read = TRUE;
+
+  end_comm (rio);
+
+  rio_api_prefetch_l (rio, folder->folder_num + 1);
+
+  return folder->songs;
 }
 
+/* -------------------------------------------------------------------
+   NAME:        rio_set_prefetch
+   DESCRIPTION: Turn background reading of the next folder's songs on
+                (the default is off) or off. The read shares the device
+                (the same fd with the fd driver), the cache and the
+                default buffer pool with the caller; the rio_ calls wait
+                for it, but code using librio500 directly must not touch
+                the device or the default pool between rio_ calls while
+                it is on.
+   ------------------------------------------------------------------- */
+
+int
+rio_set_prefetch (Rio500 *rio, int prefetch)
+{
+  g_return_val_if_fail (rio != NULL, -1);
+
+  if (!prefetch)
+    rio_api_prefetch_wait_l (rio);
+  rio->prefetch = prefetch;
+  return 0;
+}
 
 /* -------------------------------------------------------------------
    NAME:        rio_get_song_list
@@ -262,10 +380,11 @@ rio_get_song_list (Rio500 *rio, GList *folders, int folder_num)
 int
 rio_add_song (Rio500 *rio, int folder_num, char *filename)
 {
-  int               retries, song_location;
+  int               song_location;
   int               folder_block_offset, song_block_offset;
-  int               font_number, mem_left;
-  GList            *folders, *songs;
+  int               font_number, size;
+  WORD              base;
+  rio_table        *folders, *songs;
   folder_entry     *f_entry;
   char             *font_name = rio->font;
 
@@ -275,54 +394,75 @@ rio_add_song (Rio500 *rio, int folder_num, char *filename)
   /* Init communication with rio */
   start_comm (rio);
 
-  /* Make sure there's enough space left */
-  /* Sometimes quert_mem_left returns 0 but there really is space in
-     the device. So... try 3 times and make sure that it really is
-     returning 0. */
-  retries = 3;
-  while (retries-- > 0)
+  /* Folder & song block, from the cache if the Rio hasn't changed */
+  folders = rio_cache_folders (rio->cache, rio->rio_dev, rio->card);
+  if (folders == NULL || folders->count == 0)
   {
-    mem_left = query_mem_left (rio->rio_dev,rio->card);
-    send_command (rio->rio_dev, 0x42, 0, 0);
-    if (mem_left > 0)
-      break;
+    end_comm (rio);
+    return (-1);
   }
-  if (file_size (filename) > mem_left)
+
+  /* Make sure there's enough space left, in whole blocks. Checking
+     the cache took the Rio's memory status already. */
+  rio_api_space_l (rio, rio->card);
+  size = file_size (filename);
+  if (rio_space_load (rio->space, rio->rio_dev, rio->card) == -1
+      || !rio_space_fits (rio->space, rio->card, size))
   {
      end_comm (rio);
      return (-1);
   }
-
-  /* Read folder & song block */
-  folders = read_folder_entries (rio->rio_dev,rio->card);
-  if ( folder_num > g_list_length (folders)-1 )
+  rio_intent_apply (rio->intent, folders, rio->card);
+  if ( folder_num > folders->count-1 )
     folder_num = 0;
-  songs   = read_song_entries ( rio->rio_dev, folders, folder_num, rio->card);
+  f_entry = rio_table_folder (folders, folder_num);
+  songs   = rio_cache_songs (rio->cache, rio->rio_dev, rio->card, folder_num);
+  if (songs == NULL)
+  {
+    end_comm (rio);
+    return (-1);
+  }
 
   /* Write the song to the Rio */
   song_location = write_song (rio, filename);
+  if (song_location < 0)
+  {
+    end_comm (rio);
+    return (-1);
+  }
+  rio_space_take (rio->space, rio->card, size);
 
   /* Add an entry to the song block */
- songs = add_song_to_list ( songs, filename, song_location, font_name, font_number);
-  if (songs == NULL)
+  if (add_song_to_table ( songs, filename, song_location, font_name, font_number) == -1)
   {
     end_comm (rio);
     return (-1);
   }
 
   /* Write song block to the correct folder */
-  write_song_entries (rio->rio_dev, folder_num, songs ,rio->card);
+  rio_write_song_table (rio->rio_dev, folder_num, songs ,rio->card);
   send_command (rio->rio_dev, 0x42, 0, 0);
   send_command (rio->rio_dev, 0x42, 0, 0);
 
   song_block_offset = send_command (rio->rio_dev, 0x43, 0x0, 0x0);
 
   /* Now write the folder block again */
-  f_entry = (folder_entry *) ((GList *) g_list_nth (folders, folder_num))->data; 
+  base = f_entry->offset;
   f_entry->offset = song_block_offset;
   f_entry->fst_free_entry_off += 0x800;
+  rio_table_touch (folders, folder_num);
 
-  write_folder_entries ( rio->rio_dev, folders ,rio->card);
+  /* ... or leave that to rio_flush */
+  if (rio->intent != NULL
+      && rio_intent_record (rio->intent, rio->card, folder_num, base, f_entry) == 0)
+  {
+    rio_cache_commit (rio->cache, rio->rio_dev, rio->card);
+    rio_api_space_l (rio, rio->card);
+    end_comm (rio);
+    return (1);
+  }
+
+  rio_write_folder_table ( rio->rio_dev, folders ,rio->card);
   send_command (rio->rio_dev, 0x42, 0, 0);
   send_command (rio->rio_dev, 0x42, 0, 0);
   folder_block_offset = send_command (rio->rio_dev, 0x43, 0x0, 0x0);
@@ -332,6 +472,8 @@ rio_add_song (Rio500 *rio, int folder_num, char *filename)
 
   /* Not really sure what this does */
   send_command (rio->rio_dev, 0x58, 0x0, rio->card);
+  rio_cache_commit (rio->cache, rio->rio_dev, rio->card);
+  rio_api_space_l (rio, rio->card);
 
   /* Close device */
   end_comm (rio);
@@ -364,8 +506,15 @@ rio_del_song (Rio500 *rio, int folder_num, int song_num)
 	if (folder_num < 0 || song_num < 0)
 	  return status;
 
+	/* The Rio has to see the folders as they are now first */
+	if (rio_api_flush_l (rio) == -1)
+	{
+	  end_comm (rio);
+	  return status;
+	}
+
 	/* Call internal function to delete song. */
-	status = remove_song (rio->rio_dev, song_num, folder_num, rio->card);
+	status = (remove_songs (rio->cache, rio->rio_dev, &song_num, 1, folder_num, rio->card) > 0) ? 0 : -1;
  
   /* Finish communication */
   end_comm (rio);
@@ -375,7 +524,9 @@ rio_del_song (Rio500 *rio, int folder_num, int song_num)
 
 /* -------------------------------------------------------------------
    NAME:        rio_del_folder
-   DESCRIPTION: Removes the folder_num'th folder from the rio.
+   DESCRIPTION: Removes the folder_num'th folder from the rio. Returns
+                0, RIO_SHARED if some of its songs are copied into
+                another folder (nothing is deleted then), or -1.
    ------------------------------------------------------------------- */
 
 int
@@ -398,8 +549,17 @@ rio_del_folder (Rio500 *rio, int folder_num)
 	if (folder_num < 0)
 	  return status;
 
+	/* The Rio has to see the folders as they are now first */
+	if (rio_api_flush_l (rio) == -1)
+	{
+	  end_comm (rio);
+	  return status;
+	}
+
 	/* Call internal function to delete song. */
-	status = remove_folder (rio->rio_dev, folder_num, rio->card);
+	status = remove_folders (rio->cache, rio->rio_dev, rio->stat_func, &folder_num, 1, rio->card);
+	if (status != RIO_SHARED)
+	  status = (status > 0) ? 0 : -1;
  
   /* Finish communication */
   end_comm (rio);
@@ -407,6 +567,108 @@ rio_del_folder (Rio500 *rio, int folder_num)
   return status;
 }
 
+/* -------------------------------------------------------------------
+   NAME:        rio_del_songs, rio_del_folders
+   DESCRIPTION: Delete several songs of folder_num (or several folders)
+                at once, writing the tables only once. The numbers are
+                the current ones; the array is sorted in place. Returns
+                how many were deleted, or -1. rio_del_folders returns
+                RIO_SHARED, deleting nothing, if a folder has songs
+                copied elsewhere.
+   ------------------------------------------------------------------- */
+
+int
+rio_del_songs (Rio500 *rio, int folder_num, int *song_nums, int count)
+{
+  int status;
+
+  g_return_val_if_fail (rio != NULL, -1);
+  g_return_val_if_fail (song_nums != NULL, -1);
+
+  if (folder_num < 0)
+    return -1;
+
+  start_comm (rio);
+  status = -1;
+  if (rio_api_flush_l (rio) == 0)
+    status = remove_songs (rio->cache, rio->rio_dev, song_nums, count, folder_num, rio->card);
+  end_comm (rio);
+
+  return status;
+}
+
+int
+rio_del_folders (Rio500 *rio, int *folder_nums, int count)
+{
+  int status;
+
+  g_return_val_if_fail (rio != NULL, -1);
+  g_return_val_if_fail (folder_nums != NULL, -1);
+
+  start_comm (rio);
+  status = -1;
+  if (rio_api_flush_l (rio) == 0)
+    status = remove_folders (rio->cache, rio->rio_dev, rio->stat_func, folder_nums, count, rio->card);
+  end_comm (rio);
+
+  return status;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_move_songs, rio_copy_songs
+   DESCRIPTION: Move (or copy) count songs of from_folder to position
+                to_pos of to_folder (-1 for the end), without sending
+                the audio again. A copy shares the audio with the
+                original; deleting one leaves the other playing.
+                Returns the number of songs moved, or -1.
+   ------------------------------------------------------------------- */
+
+int
+rio_move_songs (Rio500 *rio, int from_folder, int *song_nums, int count,
+                int to_folder, int to_pos)
+{
+  return move_songs (rio, from_folder, song_nums, count, to_folder, to_pos, FALSE);
+}
+
+int
+rio_copy_songs (Rio500 *rio, int from_folder, int *song_nums, int count,
+                int to_folder, int to_pos)
+{
+  return move_songs (rio, from_folder, song_nums, count, to_folder, to_pos, TRUE);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_reorder_songs
+   DESCRIPTION: Put the songs of folder_num in a new order: song i
+                becomes the one that was order[i]. order holds every
+                song number of the folder once. Returns 0 or -1.
+   ------------------------------------------------------------------- */
+
+int
+rio_reorder_songs (Rio500 *rio, int folder_num, int *order)
+{
+  rio_table *folders, *songs;
+  int        status = -1;
+
+  g_return_val_if_fail (rio != NULL, -1);
+  g_return_val_if_fail (order != NULL, -1);
+
+  start_comm (rio);
+
+  folders = NULL;
+  if (rio_api_flush_l (rio) == 0)
+    folders = rio_cache_folders (rio->cache, rio->rio_dev, rio->card);
+  songs = (folders != NULL) ? rio_cache_songs (rio->cache, rio->rio_dev, rio->card, folder_num) : NULL;
+  if (songs != NULL)
+    status = rio_reorder_song_entries (rio->rio_dev, folders, songs, folder_num, order, rio->card);
+  if (status == 0)
+    rio_cache_commit (rio->cache, rio->rio_dev, rio->card);
+
+  end_comm (rio);
+
+  return status;
+}
+
 /* -------------------------------------------------------------------
    NAME:        rio_add_folder
    DESCRIPTION: Adds folder with name folder_name to the rio.
@@ -430,7 +692,8 @@ rio_add_folder (Rio500 *rio, char *folder_name)
   /* Init communication with rio */
   start_comm (rio);
 
-  add_folder (rio->rio_dev, folder_name, font_name, font_number, rio->card);
+  rio_api_flush_l (rio);
+  add_folder (rio->cache, rio->rio_dev, folder_name, font_name, font_number, rio->card);
 
   /* Close device */
   end_comm (rio);
@@ -448,8 +711,8 @@ rio_add_folder (Rio500 *rio, char *folder_name)
 int
 rio_add_directory(Rio500 *rio, char *dir_name, int folder_num)
 {
-  int count=0, font_number=rio->font_num, ret, mem_left, dirsize=0;
-  int retries=0;
+  int count=0, font_number=rio->font_num, ret;
+  DWORD blocks=0;
   char *font_name = rio->font;
   char *sp, *olddir;
   DIR *dp;
@@ -481,7 +744,6 @@ rio_add_directory(Rio500 *rio, char *dir_name, int folder_num)
   while((de=readdir(dp)) != NULL) {
     sp=(char *)(strstr(de->d_name,".mp3"));
     if(sp != NULL) {
-	dirsize=dirsize+file_size(de->d_name);
      	songs = g_list_append(songs,de->d_name);
     }  
   }  
@@ -493,20 +755,18 @@ rio_add_directory(Rio500 *rio, char *dir_name, int folder_num)
   /* Init communication with rio */
   start_comm (rio);
 
-  /* Make sure there's enough space left */
-  /* Sometimes quert_mem_left returns 0 but there really is space in
-     the device. So... try 3 times and make sure that it really is
-     returning 0. */
-
-  retries = 3;
-  while (retries-- > 0)
+  /* Make sure there's enough space left, counting each song in
+     whole blocks; the cache check brings the model up to date */
+  rio_cache_folders (rio->cache, rio->rio_dev, rio->card);
+  rio_api_space_l (rio, rio->card);
+  if (rio_space_load (rio->space, rio->rio_dev, rio->card) == -1)
   {
-    mem_left = query_mem_left (rio->rio_dev,0);
-    send_command (rio->rio_dev, 0x42, 0, 0);
-    if (mem_left > 0)
-      break;
+     end_comm (rio);
+     return (RIO_NOMEM);
   }
-  if (dirsize > mem_left)
+  for(next_song=g_list_first(songs);next_song;next_song=next_song->next)
+	blocks += rio_space_blocks (rio->space, rio->card, file_size (next_song->data));
+  if (blocks > rio_space_free (rio->space, rio->card))
   {
      end_comm (rio);
      return (RIO_NOMEM);
@@ -540,26 +800,13 @@ rio_add_directory(Rio500 *rio, char *dir_name, int folder_num)
 int
 rio_rename_folder (Rio500 *rio, int folder_num, char *folder_name)
 {
-  int status = -1;
-  char *font_name = rio->font;
-  int fnum = folder_num;
-  g_return_val_if_fail (rio != NULL, -1);
+  RioRename rename;
 
-#ifndef WITH_USBDEVFS
-  g_return_val_if_fail (rio->rio_dev > 0, -1);
-#else
-  g_return_val_if_fail (rio->rio_dev == NULL, -1);
-#endif
+  rename.folder = folder_num;
+  rename.song   = -1;
+  rename.name   = folder_name;
 
-  /* Open connection to rio */
-  start_comm (rio);
-
-  rename_folder (rio->rio_dev, fnum, folder_name, font_name, rio->font_num, rio->card);
-
-  /* Finish communication */
-  end_comm (rio);
-
-  return status;
+  return rio_rename (rio, &rename, 1);
 }
 
 /* -------------------------------------------------------------------
@@ -569,12 +816,32 @@ rio_rename_folder (Rio500 *rio, int folder_num, char *folder_name)
 
 int
 rio_rename_song (Rio500 *rio, int folder_num, int song_num, char *song_name)
+{
+  RioRename rename;
+
+  rename.folder = folder_num;
+  rename.song   = song_num;
+  rename.name   = song_name;
+
+  return rio_rename (rio, &rename, 1);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_rename
+   DESCRIPTION: Rename count folders and songs at once. Every name is
+                rendered before anything is written; then each song
+                table that changed is written once, and the folder
+                table once after them. Nothing is written if one of
+                the renames is out of range. Returns 0 or -1.
+   ------------------------------------------------------------------- */
+
+int
+rio_rename (Rio500 *rio, RioRename *renames, int count)
 {
   int status = -1;
-  char *font_name = rio->font;
-  int fnum = folder_num;
 
   g_return_val_if_fail (rio != NULL, -1);
+  g_return_val_if_fail (renames != NULL, -1);
 
 #ifndef WITH_USBDEVFS
   g_return_val_if_fail (rio->rio_dev > 0, -1);
@@ -585,13 +852,14 @@ rio_rename_song (Rio500 *rio, int folder_num, int song_num, char *song_name)
   /* Open connection to rio */
   start_comm (rio);
 
-  rename_song (rio->rio_dev, fnum, song_num, song_name, font_name, rio->font_num, rio->card);
+  status = rename_entries (rio, renames, count);
 
   /* Finish communication */
   end_comm (rio);
 
   return status;
 }
+
 /* -------------------------------------------------------------------
    NAME:        rio_memory_left
    DESCRIPTION: Return memory left in internal or external memory.
@@ -649,7 +917,8 @@ unsigned long rio_get_mem_total(Rio500* rio)
    DESCRIPTION: sets font name/number to be stored in rio500 struct.
 		By default this is filled with the compiled in font.
 		All fonts must be located in the default font path
-		and all must be either .fon fonts or .psf fonts
+		and all must be either .fon fonts or .psf fonts.
+		The font is loaded into the font cache right away.
    ------------------------------------------------------------------- */
 
 int
@@ -659,6 +928,7 @@ rio_set_font (Rio500 *rio, char *font_name, int font_number)
   char *font = malloc(strlen(temp)+strlen(font_name)+1);
  
   g_return_val_if_fail (rio != NULL, -1);
+  rio_api_prefetch_wait_l (rio);
 #ifndef WITH_USBDEVFS
   g_return_val_if_fail (rio->rio_dev > 0, -1);
 #else
@@ -670,6 +940,9 @@ rio_set_font (Rio500 *rio, char *font_name, int font_number)
 
   rio->font_num = font_number;
   rio->font = font;
+
+  /* Titles rendered from now on don't parse the file again */
+  rio_font_preload (font, font_number);
   return 0;
 
 }
@@ -683,8 +956,8 @@ rio_set_font (Rio500 *rio, char *font_name, int font_number)
 int
 rio_set_card (Rio500 *rio, int card)
 {
-
   g_return_val_if_fail (rio != NULL, -1);
+  rio_api_prefetch_wait_l (rio);
 #ifndef WITH_USBDEVFS
   g_return_val_if_fail (rio->rio_dev > 0, -1);
 #else
@@ -696,6 +969,91 @@ rio_set_card (Rio500 *rio, int card)
 
 }
 
+/* -------------------------------------------------------------------
+   NAME:        rio_set_cache_file
+   DESCRIPTION: Keep the folder and song tables in filename between
+                runs (NULL to only keep them in memory). The cache is
+                loaded from the file now and saved by rio_delete.
+   ------------------------------------------------------------------- */
+
+int
+rio_set_cache_file (Rio500 *rio, char *filename)
+{
+  rio_cache *cache;
+
+  g_return_val_if_fail (rio != NULL, -1);
+
+  rio_api_prefetch_wait_l (rio);
+  cache = rio_cache_new (filename);
+  if (cache == NULL)
+    return -1;
+
+  rio_cache_delete (rio->cache);
+  rio->cache = cache;
+  return 0;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_set_intent_log
+   DESCRIPTION: Don't write the folder table after every song added or
+                renamed; note the changes in filename instead and write
+                the table once, in rio_flush or rio_delete. Notes left
+                in filename by a session that never got that far are
+                replayed now. NULL writes what is pending and goes back
+                to writing the folder table every time.
+   ------------------------------------------------------------------- */
+
+int
+rio_set_intent_log (Rio500 *rio, char *filename)
+{
+  rio_intent *intent;
+
+  g_return_val_if_fail (rio != NULL, -1);
+  rio_api_prefetch_wait_l (rio);
+
+  if (rio->intent != NULL)
+  {
+    if (rio_flush (rio) == -1)
+      return -1;
+    rio_intent_delete (rio->intent);
+    rio->intent = NULL;
+  }
+
+  if (filename == NULL)
+    return 0;
+
+  intent = rio_intent_new (filename);
+  if (intent == NULL)
+    return -1;
+  rio->intent = intent;
+
+  return rio_flush (rio);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_flush
+   DESCRIPTION: Write the folder table changes noted since the last
+                flush. Returns 0, or -1 if some are still pending.
+   ------------------------------------------------------------------- */
+
+int
+rio_flush (Rio500 *rio)
+{
+  int status;
+
+  g_return_val_if_fail (rio != NULL, -1);
+
+  if (rio_intent_pending (rio->intent, 0) == 0
+      && rio_intent_pending (rio->intent, 1) == 0)
+    return 0;
+
+  start_comm (rio);
+  status = rio_api_flush_l (rio);
+  end_comm (rio);
+
+  return status;
+}
+
 /* -------------------------------------------------------------------
 
                             Internal functions
@@ -712,32 +1070,152 @@ rio_api_open_l (Rio500 *rio)
 }
 
 static GList *
-rio_api_read_songs_l (Rio500 *rio, GList *folders, int num_folder)
+rio_api_read_songs_l (Rio500 *rio, int num_folder)
 {
-  GList      *songs, *rio_song_list, *item;
+  rio_table  *songs;
+  GList      *rio_song_list;
   song_entry *entry;
-  int song_num;
+  int i, song_num;
   RioSongEntry *song;
 
-  songs = read_song_entries (rio->rio_dev, folders, num_folder,rio->card);
+  songs = rio_cache_songs (rio->cache, rio->rio_dev, rio->card, num_folder);
+  if (songs == NULL)
+    return NULL;
+
   rio_song_list = NULL;
   song_num = 0;
-  for (item = songs; item; item = item->next)
+  for (i = 0; i < songs->count; i++)
   {
-    entry = (song_entry *)item->data;
-    if (entry == NULL)
-      continue;
+    entry = rio_table_song (songs, i);
     song = malloc (sizeof (RioSongEntry));
     if (song)
     {
       song->name = g_strdup (entry->name1);
       song->size = (unsigned long)entry->length;
       song->song_num = song_num++;
-      rio_song_list = g_list_append (rio_song_list, song);
+      rio_song_list = g_list_prepend (rio_song_list, song);
+    }
+  }
+
+  return g_list_reverse (rio_song_list);
+}
+
+/* The prefetch thread reads one song table into the cache. On usbdevfs
+   it opens a connection of its own; with the fd driver it talks over
+   rio->prefetch_dev, which is the very descriptor in rio->rio_dev. It
+   also fills rio->cache and takes buffers from the default rio_pool,
+   and neither is thread safe. None of that is locked: it is safe only
+   because every public call joins the thread before it uses the
+   device, the cache or the default pool (most of them in start_comm).
+   Anything added to the API has to do the same. */
+static void *
+rio_api_prefetch_thread_l (void *data)
+{
+  Rio500     *rio = (Rio500 *) data;
+  rio_device  rio_dev;
+
+#ifndef WITH_USBDEVFS
+  rio_dev = rio->prefetch_dev;
+  init_communication (rio_dev);
+#else
+  rio_dev = init_communication ();
+  if (rio_dev == NULL)
+    return NULL;
+#endif
+
+  rio_cache_songs (rio->cache, rio_dev, rio->prefetch_card,
+                   rio->prefetch_folder);
+
+  finish_communication (rio_dev);
+
+  return NULL;
+}
+
+static void
+rio_api_prefetch_l (Rio500 *rio, int folder_num)
+{
+  if (!rio->prefetch || rio->prefetching)
+    return;
+#ifndef WITH_USBDEVFS
+  if (rio->rio_dev < 0)
+    return;
+#endif
+  if (!rio_cache_wants_songs (rio->cache, rio->card, folder_num))
+    return;
+
+  rio->prefetch_folder = folder_num;
+  rio->prefetch_card = rio->card;
+#ifndef WITH_USBDEVFS
+  rio->prefetch_dev = rio->rio_dev;
+#endif
+  rio->prefetching = (pthread_create (&rio->prefetch_thread, NULL,
+                                      rio_api_prefetch_thread_l, rio) == 0);
+}
+
+static void
+rio_api_prefetch_wait_l (Rio500 *rio)
+{
+  if (!rio->prefetching)
+    return;
+  pthread_join (rio->prefetch_thread, NULL);
+  rio->prefetching = FALSE;
+}
+
+/* Put the free space model of card right from the memory status the
+   cache took when it last checked or committed, or forget it if the
+   cache has nothing for card. Costs no control messages. */
+static void
+rio_api_space_l (Rio500 *rio, int card)
+{
+  mem_status mem;
+
+  if (rio_cache_mem_status (rio->cache, card, &mem) == 0)
+    rio_space_seed (rio->space, card, &mem);
+  else
+    rio_space_forget (rio->space, card);
+}
+
+/* Write the folder tables with the noted changes in them. The device
+   must be open. */
+static int
+rio_api_flush_l (Rio500 *rio)
+{
+  rio_table *folders;
+  int        card, folder_num, location, status = 0;
+
+  if (rio->intent == NULL)
+    return 0;
+
+  for (card = 0; card < RIO_CACHE_MAX_CARDS; card++)
+  {
+    if (rio_intent_pending (rio->intent, card) == 0)
+      continue;
+
+    folders = rio_cache_folders (rio->cache, rio->rio_dev, card);
+    if (folders == NULL)
+    {
+      status = -1;
+      continue;
+    }
+
+    folder_num = rio_intent_apply (rio->intent, folders, card);
+    if (rio_flush_folder_table (rio->rio_dev, folders, card))
+    {
+      send_command (rio->rio_dev, 0x42, 0, 0);
+      send_command (rio->rio_dev, 0x42, 0, 0);
+      location = send_command (rio->rio_dev, 0x43, 0x0, 0x0);
+
+      /* Tell Rio where the root folder block is. */
+      send_folder_location (rio->rio_dev, location, (folder_num < 0) ? 0 : folder_num, card);
+      send_command (rio->rio_dev, 0x58, 0x0, card);
+      rio_cache_commit (rio->cache, rio->rio_dev, card);
     }
+
+    if (rio_intent_clear (rio->intent, card) == -1)
+      status = -1;
   }
 
-  return g_list_first (rio_song_list);
+  return status;
 }
 
 static void
@@ -780,18 +1258,17 @@ rio_api_clear_songs_l (GList *songs)
   return;
 }
 
-GList *
-add_song_to_list (GList *songs, char *filename, int offset, char *font_name, int font_number)
+static int
+add_song_to_table (rio_table *songs, char *filename, int offset, char *font_name, int font_number)
 {
   FILE                *fp;
-  GList               *new_entry;
-  int                  size;
+  int                  size, i;
   char                *striped_name;
   song_entry          *entry;
 
   fp = fopen (filename, "r");
   if (fp == NULL)
-    return NULL;
+    return -1;
   fclose (fp);
 
   size = file_size (filename);
@@ -802,106 +1279,141 @@ add_song_to_list (GList *songs, char *filename, int offset, char *font_name, int
   entry->offset = (WORD)  offset;
   entry->length = (DWORD) size;
 
-  new_entry = g_list_append (songs, entry);
+  i = rio_table_append (songs, entry);
+  free (entry);
 
-  return g_list_first (new_entry);
+  return i;
 }
 
-int
-write_song (Rio500 *rio, char *filename)
+static int
+move_songs (Rio500 *rio, int from_folder, int *song_nums, int count,
+            int to_folder, int to_pos, int copy)
 {
-  int input_file;
-  int  i, j, size;
-  int  total, count, num_blocks, remainder, blocks_left;
-  BYTE *block, *p;
-  int num_chunks, song_location;
-  char message[255];
-
-  block = (char *)malloc (0x80000);
-
-  i = 0;
-  input_file = open (filename, O_RDONLY);
-  if (input_file == -1)
-    return -1;
-
-  size = file_size (filename);
+  rio_table *folders, *from, *to;
+  int        status = -1;
 
-  num_blocks = size / 0x10000;
-  remainder  = size % 0x10000;
-
-  sprintf (message, "Transfering %s ...", g_basename (filename));
+  g_return_val_if_fail (rio != NULL, -1);
+  g_return_val_if_fail (song_nums != NULL, -1);
 
-  /* First send num_chunks, blocks at a time */
-  num_chunks = 0x10;
-  total = 0;
-  blocks_left = num_blocks - num_chunks;
+  start_comm (rio);
 
-  send_command (rio->rio_dev, 0x4f, 0xffff, rio->card);
-  while (blocks_left > 0)
+  folders = NULL;
+  if (rio_api_flush_l (rio) == 0)
+    folders = rio_cache_folders (rio->cache, rio->rio_dev, rio->card);
+  if (folders != NULL)
   {
-    send_command (rio->rio_dev, 0x46, num_chunks, 0x0);
-    for (j=0;j<num_chunks / 2;j++)
+    from = rio_cache_songs (rio->cache, rio->rio_dev, rio->card, from_folder);
+    to   = rio_cache_songs (rio->cache, rio->rio_dev, rio->card, to_folder);
+    if (from != NULL && to != NULL)
     {
-      count = read (input_file, block, 0x20000);
-      total += count;
-      if (count != 0x20000)
-        printf ("[Short read!]");
-      bulk_write (rio->rio_dev, block, 0x20000);
-      if (rio->stat_func)
-        (*rio->stat_func)(0, message, (int)(100*total/size));
+      if (copy)
+        status = rio_copy_song_entries (rio->rio_dev, folders, from, from_folder,
+                                        song_nums, count, to, to_folder, to_pos, rio->card);
+      else
+        status = rio_move_song_entries (rio->rio_dev, folders, from, from_folder,
+                                        song_nums, count, to, to_folder, to_pos, rio->card);
     }
-    blocks_left -= num_chunks;
-    // Send a 0x42.
-    send_command (rio->rio_dev, 0x42, 0, 0);
-    send_command (rio->rio_dev, 0x42, 0, 0);
   }
 
-  /* Send remaining blocks */
-  blocks_left += num_chunks;
-  //send_command (rio_dev, 0x4f, 0xffff, 0);
-  send_command (rio->rio_dev, 0x46, blocks_left, 00);
-  while (blocks_left > 0)
+  /* Failing half way leaves the cached tables changed */
+  if (status > 0)
+    rio_cache_commit (rio->cache, rio->rio_dev, rio->card);
+  else
+    rio_cache_invalidate (rio->cache, rio->card);
+
+  end_comm (rio);
+
+  return status;
+}
+
+/* Get every song table of card into the cache, so song_shared can look
+   at them without talking to the Rio in the middle of a delete */
+static int
+read_all_songs (rio_cache *cache, rio_device rio_dev, rio_table *folders, int card)
+{
+  int f;
+
+  for (f = 0; f < folders->count; f++)
+    if (rio_cache_songs (cache, rio_dev, card, f) == NULL)
+      return -1;
+  return 0;
+}
+
+typedef struct
+{
+  rio_cache  *cache;
+  rio_device  rio_dev;
+  rio_table  *folders;
+  int         card;
+} shared_data;
+
+/* TRUE if another entry on the card plays the same audio (a copy made
+   by rio_copy_songs) */
+static int
+song_shared (int folder_num, int song_num, void *data)
+{
+  shared_data *shared = (shared_data *) data;
+  rio_table   *songs;
+  WORD         offset;
+  int          f, s;
+
+  songs = rio_cache_songs (shared->cache, shared->rio_dev, shared->card, folder_num);
+  if (songs == NULL || song_num >= songs->count)
+    return FALSE;
+  offset = rio_table_song (songs, song_num)->offset;
+
+  for (f = 0; f < shared->folders->count; f++)
   {
-    count = read (input_file, block, 0x10000);
-    total += count;
-    if (count != 0x10000)
-     printf ("[Short read!]");
-    bulk_write (rio->rio_dev, block, 0x10000);
-    if (rio->stat_func)
-      (*rio->stat_func)(0, message, (int)(100*total/size));
-    blocks_left--;
-    send_command (rio->rio_dev, 0x42, 0, 0);
-    send_command (rio->rio_dev, 0x42, 0, 0);
+    songs = rio_cache_songs (shared->cache, shared->rio_dev, shared->card, f);
+    for (s = 0; songs && s < songs->count; s++)
+      if (rio_table_song (songs, s)->offset == offset
+          && (f != folder_num || s != song_num))
+        return TRUE;
   }
 
-  /* Send last block */
-  count = read (input_file, block, remainder);
-  j = remainder;
-  total += count;
-  p = block;
-  while (j > 0)
+  return FALSE;
+}
+
+/* rio_upload_song's progress goes to the stat_func of the Rio that
+   write_song is uploading to */
+static Rio500 *write_song_rio;
+static char    write_song_message[255];
+
+static void
+write_song_progress (unsigned long done, unsigned long total)
+{
+  if (write_song_rio->stat_func && total > 0)
+    (*write_song_rio->stat_func) (0, write_song_message, (int) (100.0 * done / total));
+}
+
+int
+write_song (Rio500 *rio, char *filename)
+{
+  int input_file;
+  int size, song_location;
+  rio_reader *reader;
+
+  input_file = open (filename, O_RDONLY);
+  if (input_file == -1)
+    return -1;
+
+  size = file_size (filename);
+
+  reader = rio_reader_new (input_file, 0, size, rio->pool);
+  if (reader == NULL)
   {
-    if (j > 0x4000)
-    {
-      //send_command (rio_dev, 0x4f, 0xffff, 0);
-      send_command (rio->rio_dev, 0x46, 00, 0x4000);
-      bulk_write (rio->rio_dev, p, 0x4000);
-    } else {
-     //send_command (rio_dev, 0x4f, 0xffff, 0);
-      send_command (rio->rio_dev, 0x46, 00, j);
-      bulk_write (rio->rio_dev, p, j);
-    }
-    if (rio->stat_func)
-      (*rio->stat_func)(0, message, (int)(100*total/size));
-    j -= 0x4000;
-    p += 0x4000;
-    send_command (rio->rio_dev, 0x42, 0, 0);
-    send_command (rio->rio_dev, 0x42, 0, 0);
+    close (input_file);
+    return -1;
   }
 
-  send_command (rio->rio_dev, 0x42, 0, 0);
-  send_command (rio->rio_dev, 0x42, 0, 0);
-  song_location = send_command (rio->rio_dev, 0x43, 0, 0);
+  sprintf (write_song_message, "Transfering %s ...", g_basename (filename));
+  write_song_rio = rio;
+  song_location = rio_upload_song (rio->rio_dev, reader, size, rio->card,
+                                   write_song_progress);
+  write_song_rio = NULL;
+
+  rio_reader_delete (reader);
+  close (input_file);
 
   return song_location;
 }
@@ -926,103 +1438,88 @@ file_size (char *filename)
 
 static int
 #ifndef WITH_USBDEVFS
-remove_folder (int rio_dev, int folder_num, int card)
+remove_folders (rio_cache *cache, int rio_dev, RioStatusFunc stat_func, int *folder_nums, int count, int card)
 #else
-remove_folder (struct usbdevice *rio_dev, int folder_num, int card)
+remove_folders (rio_cache *cache, struct usbdevice *rio_dev, RioStatusFunc stat_func, int *folder_nums, int count, int card)
 #endif
 {
-  folder_entry     *folder;
-  int               song_num, folder_block_offset;
-  GList            *folders, *songs;
+  rio_table        *folders, *songs;
+  shared_data       shared;
+  char              msg[80];
+  int               i, s, n;
 
-  /* Read folder & song block */
-  folders = read_folder_entries (rio_dev,card);
-  if ( folder_num > g_list_length (folders)-1 )
+  folders = rio_cache_folders (cache, rio_dev, card);
+  if (folders == NULL)
     return -1;
-  else
-    songs   = read_song_entries (rio_dev, folders, folder_num,card); 
-
-
-  folder  = (folder_entry *)g_list_nth_data (g_list_first(folders), folder_num);
-
-  for (song_num = g_list_length (songs) - 1; song_num >= 0; song_num--)
-    remove_song (rio_dev, song_num, folder_num, card);
 
-  folders = g_list_remove (folders, (gpointer) folder);
-
-  send_command (rio_dev, 0x4c, ((folder_num << 8) | 0xff), card);
-  write_folder_entries (rio_dev, folders,card);
-  send_command (rio_dev, 0x42, 0, 0);
-  send_command (rio_dev, 0x42, 0, 0);
-  folder_block_offset = send_command (rio_dev, 0x43, 0x0, 0x0);
+  /* Deleting a folder releases all of its songs' audio; refuse with
+     RIO_SHARED if any of it is still played from somewhere else */
+  if (read_all_songs (cache, rio_dev, folders, card) == -1)
+    return -1;
+  shared.cache   = cache;
+  shared.rio_dev = rio_dev;
+  shared.folders = folders;
+  shared.card    = card;
+  for (i = 0; i < count; i++)
+  {
+    if (folder_nums[i] < 0 || folder_nums[i] >= folders->count)
+      continue;
+    songs = rio_cache_songs (cache, rio_dev, card, folder_nums[i]);
+    for (s = 0; songs && s < songs->count; s++)
+      if (song_shared (folder_nums[i], s, &shared))
+      {
+        if (stat_func)
+        {
+          sprintf (msg, "Folder %d has songs copied elsewhere; delete the copies first.",
+                   folder_nums[i]);
+          (*stat_func) (0, msg, 0);
+        }
+        return RIO_SHARED;
+      }
+  }
 
-  /* Tell Rio where the root folder block is. */
-  send_folder_location (rio_dev, folder_block_offset, 0,card);
+  n = rio_delete_folders (rio_dev, folders, folder_nums, count, card);
 
-  /* Not really sure what this does */
-  send_command (rio_dev, 0x58, 0x0, card);
+  /* The song tables after a deleted folder have moved down a number */
+  if (n > 0)
+    rio_cache_invalidate (cache, card);
 
-  return 0;
+  return n;
 }
 
 static int
 #ifndef WITH_USBDEVFS
-remove_song (int rio_dev, int song_num, int folder_num, int card)
+remove_songs (rio_cache *cache, int rio_dev, int *song_nums, int count, int folder_num, int card)
 #else
-remove_song (struct usbdevice *rio_dev, int song_num, int folder_num, int card)
+remove_songs (rio_cache *cache, struct usbdevice *rio_dev, int *song_nums, int count, int folder_num, int card)
 #endif
 {
-  song_entry       *song;
-  folder_entry     *f_entry;
-  int               folder_block_offset, song_block_offset;
-  GList            *folders, *songs;
+  rio_table        *folders, *songs;
+  shared_data       shared;
+  int               n;
 
    /* Read folder & song block */
-   folders = read_folder_entries (rio_dev,card);
-   if (folders == NULL)
+   folders = rio_cache_folders (cache, rio_dev, card);
+   if (folders == NULL || folders->count == 0)
      return -1;
-   if ( folder_num > g_list_length (folders)-1 )
-   {
-     songs   = read_song_entries (rio_dev, folders, 0,card); /* use folder 0 by default */
-     folder_num = 0;
-   } else
-     songs   = read_song_entries (rio_dev, folders, folder_num,card); 
+   if ( folder_num > folders->count-1 )
+     folder_num = 0; /* use folder 0 by default */
+   songs   = rio_cache_songs (cache, rio_dev, card, folder_num);
 
-   /* Remove the song entry from the list */
-   if ( songs == NULL || song_num > g_list_length (songs) -1)
+   /* Copies keep their audio until the last one goes */
+   if (read_all_songs (cache, rio_dev, folders, card) == -1)
      return -1;
+   shared.cache   = cache;
+   shared.rio_dev = rio_dev;
+   shared.folders = folders;
+   shared.card    = card;
 
-   song = (song_entry *) g_list_nth_data (songs, song_num);
-
-   songs = g_list_remove (songs, (gpointer)song);
-
-   /* Send remove command to the rio */
-   send_command (rio_dev, 0x4c, ((folder_num << 8) | song_num), card);
-
-   /* Write song block to the correct folder */
-   write_song_entries (rio_dev, folder_num, songs, card);
-   send_command (rio_dev, 0x42, 0, 0);
-   send_command (rio_dev, 0x42, 0, 0);
-
-   song_block_offset = send_command (rio_dev, 0x43, 0x0, 0x0);
+   n = rio_delete_songs_keeping (rio_dev, folders, songs, folder_num, song_nums, count,
+                                 song_shared, &shared, card);
+   if (n > 0)
+     rio_cache_commit (cache, rio_dev, card);
 
-   /* Now write the folder block again */
-   f_entry = (folder_entry *) ((GList *) g_list_nth (folders, folder_num))->data; 
-   f_entry->offset = song_block_offset;
-   f_entry->fst_free_entry_off -= 0x800;
-
-   write_folder_entries ( rio_dev, folders, card);
-   send_command (rio_dev, 0x42, 0, 0);
-   send_command (rio_dev, 0x42, 0, 0);
-   folder_block_offset = send_command (rio_dev, 0x43, 0x0, 0x0);
-
-   /* Tell Rio where the root folder block is. */
-   send_folder_location (rio_dev, folder_block_offset, folder_num,card);
-
-   /* Not really sure what this does */
-   send_command (rio_dev, 0x58, 0x0, card);
-
-   return 0;
+   return n;
 }
 
 
@@ -1053,38 +1550,45 @@ is_first_folder (struct usbdevice *rio_dev, int card)
 
 static void
 #ifndef WITH_USBDEVFS
-add_folder (int rio_dev, char *name, char *font_name, int font_number, int card)
+add_folder (rio_cache *cache, int rio_dev, char *name, char *font_name, int font_number, int card)
 #else
-add_folder (struct usbdevice *rio_dev, char *name, char *font_name, int font_number, int card)
+add_folder (rio_cache *cache, struct usbdevice *rio_dev, char *name, char *font_name, int font_number, int card)
 #endif
 {   
-  GList *folders;
+  rio_table *folders, *new_folders;
   int   song_block_loc, last_folder;
   int   folder_block_loc;
   folder_entry *entry;
 
-  folders = NULL;
+  folders = new_folders = NULL;
 
   /* Check if this is the first folder */ 
-  if ( is_first_folder (rio_dev, card) )
+  if ( !is_first_folder (rio_dev, card) )
+    folders = rio_cache_folders (cache, rio_dev, card);
+  if (folders == NULL)
   {
-    folders = NULL; 
-  } else {
-    folders = read_folder_entries (rio_dev,card);
+    /* Nothing to cache yet; start from an empty table */
+    rio_cache_invalidate (cache, card);
+    folders = new_folders = rio_table_new (RIO_TABLE_FOLDERS, 0);
+    if (folders == NULL)
+      return;
   }
 
   /* We can only have up to 256 folder entries: 0 - 255 */
-  last_folder = g_list_length (folders);
+  last_folder = folders->count;
   
   if ( last_folder > 255)
+  {
+    rio_table_delete (new_folders);
     return;
+  }
 
   /* Now create an new entry for the folder */
   entry = folder_entry_new (name, font_name, font_number);
 
 
   /* Write song and folder blocks back to rio */
-  write_song_entries (rio_dev, last_folder, NULL,card);
+  rio_write_song_table (rio_dev, last_folder, NULL,card);
 
   /* Afer a write it is a good idea to wait a bit */
   send_command (rio_dev, 0x42, 0, 0);
@@ -1094,10 +1598,12 @@ add_folder (struct usbdevice *rio_dev, char *name, char *font_name, int font_num
   song_block_loc = send_command (rio_dev, 0x43, 0, 0);
   entry->offset = song_block_loc; 
 
-  folders = g_list_append (folders, entry);
+  rio_table_append (folders, entry);
+  free (entry);
 
   /* Write folder list */
-  write_folder_entries (rio_dev, folders,card);
+  rio_write_folder_table (rio_dev, folders,card);
+  rio_table_delete (new_folders);
 
   /* Wait a bit after the read */
   send_command (rio_dev, 0x42, 0, 0);
@@ -1108,142 +1614,185 @@ add_folder (struct usbdevice *rio_dev, char *name, char *font_name, int font_num
   send_folder_location (rio_dev, folder_block_loc, last_folder,card);
 
   send_command (rio_dev, 0x58, 0x0, card);
+  rio_cache_commit (cache, rio_dev, card);
 
   /* done */
   return;
 }
 
-static void
-#ifndef WITH_USBDEVFS
-rename_folder (int rio_dev, int folder_num, char *name, char *font_name, int font_number, int card)
-#else
-rename_folder (struct usbdevice *rio_dev, int folder_num, char *name, char *font_name, int font_number, int card)
-#endif
-{   
-  GList *folders, *item;
-  int   last_folder;
-  int   folder_block_loc;
-  folder_entry *entry, *new_entry;
-
-  send_command(rio_dev,0x42,0,0);
-  folders = read_folder_entries (rio_dev,card);
-
-  /* Check folder_num rang */
-  last_folder = g_list_length (folders);
-  if (folder_num < 0 || folder_num > last_folder)
-    return;
-  
-  /* Now create an new entry for the folder */
-  new_entry = folder_entry_new (name, font_name, font_number);
-  entry     = (folder_entry*) g_list_nth_data (folders, folder_num);
-
-  new_entry->offset = entry->offset;
-  new_entry->fst_free_entry_off = entry->fst_free_entry_off;
+/* Put new_entry in place of entry i of table, unless it is the same
+   name and bitmap again. new_time points at the time field of new_entry.
+   Returns TRUE if the entry changed. */
+static int
+rename_replace (rio_table *table, int i, void *new_entry, DWORD *new_time)
+{
+  void  *entry = rio_table_entry (table, i);
+  DWORD  stamp, old;
+  int    size;
 
-  /* Replace data */
-  item = g_list_nth (folders, folder_num);
-  if (item)
+  if (table->type == RIO_TABLE_FOLDERS)
   {
-    free (item->data);
-    item->data = new_entry;
+    size = sizeof (folder_entry);
+    old  = ((folder_entry *) entry)->time;
+  }
+  else
+  {
+    size = sizeof (song_entry);
+    old  = ((song_entry *) entry)->time;
   }
 
-  /* Write folder list */
-  write_folder_entries (rio_dev, folders,card);
-
-  /* Wait a bit after the read */
-  send_command (rio_dev, 0x42, 0, 0);
-  send_command (rio_dev, 0x42, 0, 0);
+  /* Compare without the time, which is always new */
+  stamp     = *new_time;
+  *new_time = old;
+  if (memcmp (entry, new_entry, size) == 0)
+    return FALSE;
 
-  /* Tell rio where the root folder block is */
-  folder_block_loc = send_command (rio_dev, 0x43, 0, 0);
-  send_folder_location (rio_dev, folder_block_loc, last_folder,card);
+  *new_time = stamp;
+  memcpy (entry, new_entry, size);
+  rio_table_touch (table, i);
+  return TRUE;
+}
 
-  send_command (rio_dev, 0x58, 0x0, card);
+/* Does any of the renames change a song of folder_num? */
+static int
+rename_renders (RioRename *renames, int count, int folder_num)
+{
+  int i;
 
-  /* done */
-  return;
+  for (i = 0; i < count; i++)
+    if (renames[i].folder == folder_num && renames[i].song >= 0)
+      return TRUE;
+  return FALSE;
 }
 
-static void
-#ifndef WITH_USBDEVFS
-rename_song (int rio_dev, int folder_num, int song_num, char *name, char *font_name, int font_number, int card)
-#else
-rename_song (struct usbdevice *rio_dev, int folder_num, int song_num, char *name, char *font_name, int font_number, int card)
-#endif
-{   
-  GList *folders, *item, *songs;
-  int   last_folder;
-  int   folder_block_offset, song_block_offset;
-  song_entry *entry, *new_entry;
-  folder_entry *f_entry;
-
-  send_command(rio_dev,0x42,0,0);
-  folders = read_folder_entries (rio_dev,card);
-
-  /* Check folder_num range */
-  last_folder = g_list_length (folders);
-  if (folder_num < 0 || folder_num > last_folder)
-     folder_num = 0;
-  
-  songs   = read_song_entries ( rio_dev, folders, folder_num,card);
+static int
+rename_entries (Rio500 *rio, RioRename *renames, int count)
+{
+  rio_table    *folders, *songs;
+  folder_entry *folder, *new_folder;
+  song_entry   *song, *new_song;
+  void        **entries;
+  int           i, f, location, last, applied, renamed, deferred, status = -1;
+  WORD          base;
 
-  /* Now create an new entry for the folder */
-  new_entry = song_entry_new (name, font_name, font_number);
-  entry     = (song_entry*) g_list_nth_data (songs, song_num);
-
-  new_entry->offset = entry->offset;
-  new_entry->dunno1 = entry->dunno1;
-  new_entry->dunno2 = entry->dunno2;
-  new_entry->dunno3 = entry->dunno3;
-  new_entry->mp3sig = entry->mp3sig;
-  new_entry->length = entry->length;
-
-  /* Replace data */
-  item = g_list_nth (songs, song_num);
-  if (item)
+  send_command (rio->rio_dev, 0x42, 0, 0);
+  folders = rio_cache_folders (rio->cache, rio->rio_dev, rio->card);
+  if (folders == NULL || count <= 0)
+    return (folders == NULL) ? -1 : 0;
+
+  /* Notes still pending from earlier calls go into the cached folder
+     table rather than being written out first */
+  applied = rio_intent_apply (rio->intent, folders, rio->card);
+
+  entries = calloc (count, sizeof (void *));
+  if (entries == NULL)
+    return -1;
+
+  /* Check them all and render every bitmap before writing anything */
+  for (i = 0; i < count; i++)
   {
-    free (item->data);
-    item->data = new_entry;
+    f = renames[i].folder;
+    if (renames[i].name == NULL || f < 0 || f >= folders->count)
+      goto done;
+
+    if (renames[i].song < 0)
+      entries[i] = folder_entry_new (renames[i].name, rio->font, rio->font_num);
+    else
+    {
+      songs = rio_cache_songs (rio->cache, rio->rio_dev, rio->card, f);
+      if (songs == NULL || renames[i].song >= songs->count)
+        goto done;
+      entries[i] = song_entry_new (renames[i].name, rio->font, rio->font_num);
+    }
+    if (entries[i] == NULL)
+      goto done;
   }
 
-  /* Write song block to the correct folder */
-  write_song_entries (rio_dev, folder_num, songs,card );
-  send_command (rio_dev, 0x42, 0, 0);
-  send_command (rio_dev, 0x42, 0, 0);
+  /* Put the new names in the cached tables; a name given twice ends up
+     with the last one */
+  renamed = FALSE;
+  for (i = 0; i < count; i++)
+  {
+    f = renames[i].folder;
+    if (renames[i].song < 0)
+    {
+      folder     = rio_table_folder (folders, f);
+      new_folder = (folder_entry *) entries[i];
+      new_folder->offset             = folder->offset;
+      new_folder->fst_free_entry_off = folder->fst_free_entry_off;
+      if (rename_replace (folders, f, new_folder, &new_folder->time))
+        renamed = TRUE;
+    }
+    else
+    {
+      songs    = rio_cache_songs (rio->cache, rio->rio_dev, rio->card, f);
+      song     = rio_table_song (songs, renames[i].song);
+      new_song = (song_entry *) entries[i];
+      new_song->offset = song->offset;
+      new_song->dunno1 = song->dunno1;
+      new_song->dunno2 = song->dunno2;
+      new_song->dunno3 = song->dunno3;
+      new_song->mp3sig = song->mp3sig;
+      new_song->length = song->length;
+      rename_replace (songs, renames[i].song, new_song, &new_song->time);
+    }
+  }
 
-  song_block_offset = send_command (rio_dev, 0x43, 0x0, 0x0);
+  /* Song names can wait in the intent log; folder names cannot */
+  deferred = (rio->intent != NULL && !renamed);
 
-  /* Now write the folder block again */
-  f_entry = (folder_entry *) g_list_nth_data (folders, folder_num);
-  f_entry->offset = song_block_offset;
+  /* Each song table that changed, once */
+  last = -1;
+  for (f = 0; f < folders->count; f++)
+  {
+    if (!rename_renders (renames, count, f))
+      continue;
+    songs = rio_cache_songs (rio->cache, rio->rio_dev, rio->card, f);
+    if (!rio_flush_song_table (rio->rio_dev, f, songs, rio->card))
+      continue;
+    send_command (rio->rio_dev, 0x42, 0, 0);
+    send_command (rio->rio_dev, 0x42, 0, 0);
 
-  write_folder_entries ( rio_dev, folders,card);
-  send_command (rio_dev, 0x42, 0, 0);
-  send_command (rio_dev, 0x42, 0, 0);
-  folder_block_offset = send_command (rio_dev, 0x43, 0x0, 0x0);
+    folder = rio_table_folder (folders, f);
+    base   = folder->offset;
+    folder->offset = send_command (rio->rio_dev, 0x43, 0x0, 0x0);
+    rio_table_touch (folders, f);
+    last = f;
 
-  /* Tell Rio where the root folder block is. */
-  send_folder_location (rio_dev, folder_block_offset, folder_num,card);
+    if (deferred
+        && rio_intent_record (rio->intent, rio->card, f, base, folder) != 0)
+      deferred = FALSE;
+  }
 
-   /* Not really sure what this does */
-  send_command (rio_dev, 0x58, 0x0, card);
+  /* ... and the folder table, or leave that to rio_flush */
+  if (last < 0)
+    last = applied;
+  if (deferred)
+    rio_cache_commit (rio->cache, rio->rio_dev, rio->card);
+  else if (rio_flush_folder_table (rio->rio_dev, folders, rio->card))
+  {
+    send_command (rio->rio_dev, 0x42, 0, 0);
+    send_command (rio->rio_dev, 0x42, 0, 0);
 
-  /* Write folder list */
-  write_folder_entries (rio_dev, folders,card);
+    /* Tell rio where the root folder block is */
+    location = send_command (rio->rio_dev, 0x43, 0, 0);
+    send_folder_location (rio->rio_dev, location,
+                          (last >= 0) ? last : folders->count, rio->card);
 
-  /* Wait a bit after the read */
-  send_command (rio_dev, 0x42, 0, 0);
-  send_command (rio_dev, 0x42, 0, 0);
+    send_command (rio->rio_dev, 0x58, 0x0, rio->card);
+    rio_cache_commit (rio->cache, rio->rio_dev, rio->card);
 
-  /* Tell rio where the root folder block is */
-  folder_block_offset = send_command (rio_dev, 0x43, 0, 0);
-  send_folder_location (rio_dev, folder_block_offset, last_folder,card);
+    /* That took the pending notes along */
+    rio_intent_clear (rio->intent, rio->card);
+  }
+  status = 0;
 
-  send_command (rio_dev, 0x58, 0x0, card);
+done:
+  for (i = 0; i < count; i++)
+    free (entries[i]);
+  free (entries);
 
-  /* done */
-  return;
+  return status;
 }
 
 
@@ -1253,6 +1802,8 @@ start_comm (Rio500 *rio)
 {
   g_return_if_fail (rio != NULL);
 
+  rio_api_prefetch_wait_l (rio);
+
 #ifndef WITH_USBDEVFS
   if (rio->rio_dev < 0)
     rio_api_open_l (rio);
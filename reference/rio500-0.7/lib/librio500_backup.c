@@ -0,0 +1,556 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Whole device backup and restore (archive layout in librio500_backup.h).
+
+   Backup reads every table first, writes them out together with the
+   index and then downloads all the songs of a card in one download
+   session, each straight to its place in the archive.
+
+   Restore formats the card, uploads every song of a folder, writes that
+   folder's song block once with the new song locations and, when all
+   folders are done, writes the folder block once.
+*/
+
+#include "librio500_backup.h"
+
+#include <string.h>
+#include <errno.h>
+#include <byteswap.h>
+
+typedef struct
+{
+  int        card;
+  rio_table *folders;
+  rio_table *songs[RIO_BACKUP_MAX_FOLDERS];
+} backup_card;
+
+
+static void
+backup_swap_index (rio_backup_index *entry)
+{
+#ifdef WORDS_BIGENDIAN
+  entry->type   = bswap_32 (entry->type);
+  entry->card   = bswap_32 (entry->card);
+  entry->folder = bswap_32 (entry->folder);
+  entry->song   = bswap_32 (entry->song);
+  entry->offset = bswap_32 (entry->offset);
+  entry->length = bswap_32 (entry->length);
+#endif
+}
+
+static int
+backup_pwrite (int fd, void *data, int len, unsigned long offset)
+{
+  BYTE *p = (BYTE *) data;
+  int   count;
+
+  while (len > 0)
+  {
+    count = pwrite (fd, p, len, offset);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return -1;
+    p += count;
+    offset += count;
+    len -= count;
+  }
+  return 0;
+}
+
+static int
+backup_pread (int fd, void *data, int len, unsigned long offset)
+{
+  BYTE *p = (BYTE *) data;
+  int   count;
+
+  while (len > 0)
+  {
+    count = pread (fd, p, len, offset);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return -1;
+    p += count;
+    offset += count;
+    len -= count;
+  }
+  return 0;
+}
+
+/* Write a table to the archive the way the Rio stores it */
+static int
+backup_write_table (int fd, rio_table *table, unsigned long offset)
+{
+  int status;
+#ifdef WORDS_BIGENDIAN
+  BYTE *records;
+#endif
+
+  if (table == NULL || table->count == 0)
+    return 0;
+
+#ifndef WORDS_BIGENDIAN
+  status = backup_pwrite (fd, table->entries, table->count * RIO_ENTRY_SIZE, offset);
+#else
+  records = malloc (table->count * RIO_ENTRY_SIZE);
+  if (records == NULL)
+    return -1;
+  memcpy (records, table->entries, table->count * RIO_ENTRY_SIZE);
+  rio_codec_entries (table->type, records, table->count);
+  status = backup_pwrite (fd, records, table->count * RIO_ENTRY_SIZE, offset);
+  free (records);
+#endif
+
+  return status;
+}
+
+/* And read one back */
+static rio_table *
+backup_read_table (int fd, rio_backup_index *entry, int type)
+{
+  rio_table *table;
+  int        count;
+
+  count = entry->length / RIO_BACKUP_RECORD_SIZE;
+  table = rio_table_new (type, count);
+  if (table == NULL)
+    return NULL;
+
+  if (backup_pread (fd, table->entries, count * RIO_ENTRY_SIZE, entry->offset) == -1)
+  {
+    rio_table_delete (table);
+    return NULL;
+  }
+  table->count = count;
+  rio_codec_entries (type, table->entries, count);
+
+  return table;
+}
+
+/* Read the tables of one card. The Rio sometimes comes back empty
+   handed, so try a few times like the command line tools do. */
+static void
+backup_read_card (rio_device rio_dev, backup_card *bc)
+{
+  int retries, f;
+
+  for (retries = 0; bc->folders == NULL && retries < 3; retries++)
+  {
+    send_command (rio_dev, 0x42, 0, 0);
+    bc->folders = rio_read_folder_table (rio_dev, bc->card);
+  }
+  if (bc->folders == NULL)
+    bc->folders = rio_table_new (RIO_TABLE_FOLDERS, 0);
+
+  for (f = 0; f < bc->folders->count && f < RIO_BACKUP_MAX_FOLDERS; f++)
+  {
+    for (retries = 0; bc->songs[f] == NULL && retries < 3; retries++)
+      bc->songs[f] = rio_read_song_table (rio_dev, rio_table_folder (bc->folders, f), f, bc->card);
+    if (bc->songs[f] == NULL)
+      bc->songs[f] = rio_table_new (RIO_TABLE_SONGS, 0);
+  }
+}
+
+static void
+backup_free_card (backup_card *bc)
+{
+  int f;
+
+  for (f = 0; f < RIO_BACKUP_MAX_FOLDERS; f++)
+    rio_table_delete (bc->songs[f]);
+  rio_table_delete (bc->folders);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_backup_write
+   DESCRIPTION: Write an archive of the given cards to fd, which must be
+                seekable. Progress goes to log if it isn't NULL. Returns
+                0, or -1 if the archive could not be written.
+   ------------------------------------------------------------------- */
+
+int
+rio_backup_write (rio_device rio_dev, int fd, int *cards, int num_cards, FILE *log)
+{
+  rio_backup_header  header;
+  rio_backup_index  *index, *entry;
+  backup_card       *bc;
+  rio_download      *dl;
+  rio_sink          *sink;
+  song_entry        *song;
+  rio_table         *table;
+  unsigned long      pos;
+  int                c, f, s, n, num_entries, total, status;
+
+  bc = calloc (num_cards, sizeof (backup_card));
+  if (bc == NULL)
+    return -1;
+
+  /* All the tables first */
+  num_entries = 0;
+  for (c = 0; c < num_cards; c++)
+  {
+    bc[c].card = cards[c];
+    backup_read_card (rio_dev, &bc[c]);
+    num_entries += 1 + bc[c].folders->count;
+    for (f = 0; f < RIO_BACKUP_MAX_FOLDERS; f++)
+      if (bc[c].songs[f])
+        num_entries += bc[c].songs[f]->count;
+  }
+
+  /* Build the index: tables, then audio, each after the other */
+  index = calloc (num_entries, sizeof (rio_backup_index));
+  if (index == NULL)
+  {
+    for (c = 0; c < num_cards; c++)
+      backup_free_card (&bc[c]);
+    free (bc);
+    return -1;
+  }
+
+  pos = sizeof (rio_backup_header) + num_entries * sizeof (rio_backup_index);
+  n = 0;
+  for (c = 0; c < num_cards; c++)
+  {
+    entry = &index[n++];
+    entry->type   = RIO_BACKUP_FOLDERS;
+    entry->card   = bc[c].card;
+    entry->offset = pos;
+    entry->length = bc[c].folders->count * RIO_BACKUP_RECORD_SIZE;
+    pos += entry->length;
+
+    for (f = 0; f < bc[c].folders->count && f < RIO_BACKUP_MAX_FOLDERS; f++)
+    {
+      entry = &index[n++];
+      entry->type   = RIO_BACKUP_SONGS;
+      entry->card   = bc[c].card;
+      entry->folder = f;
+      entry->offset = pos;
+      entry->length = bc[c].songs[f]->count * RIO_BACKUP_RECORD_SIZE;
+      pos += entry->length;
+    }
+  }
+  for (c = 0; c < num_cards; c++)
+    for (f = 0; f < RIO_BACKUP_MAX_FOLDERS && bc[c].songs[f]; f++)
+      for (s = 0; s < bc[c].songs[f]->count; s++)
+      {
+        song = rio_table_song (bc[c].songs[f], s);
+        entry = &index[n++];
+        entry->type   = RIO_BACKUP_AUDIO;
+        entry->card   = bc[c].card;
+        entry->folder = f;
+        entry->song   = s;
+        entry->offset = pos;
+        entry->length = song->length;
+        pos += entry->length;
+      }
+
+  /* Header and index */
+  status = 0;
+  memcpy (header.magic, RIO_BACKUP_MAGIC, 8);
+  header.version     = RIO_BACKUP_VERSION;
+  header.num_entries = num_entries;
+#ifdef WORDS_BIGENDIAN
+  header.version     = bswap_32 (header.version);
+  header.num_entries = bswap_32 (header.num_entries);
+#endif
+  if (backup_pwrite (fd, &header, sizeof (header), 0) == -1)
+    status = -1;
+
+  for (n = 0; n < num_entries && status == 0; n++)
+  {
+    rio_backup_index swapped = index[n];
+
+    backup_swap_index (&swapped);
+    if (backup_pwrite (fd, &swapped, sizeof (swapped),
+                       sizeof (header) + n * sizeof (rio_backup_index)) == -1)
+      status = -1;
+  }
+
+  /* Tables */
+  for (n = 0; n < num_entries && status == 0; n++)
+  {
+    entry = &index[n];
+    for (c = 0; bc[c].card != entry->card; c++)
+      ;
+    if (entry->type == RIO_BACKUP_FOLDERS)
+      table = bc[c].folders;
+    else if (entry->type == RIO_BACKUP_SONGS)
+      table = bc[c].songs[entry->folder];
+    else
+      continue;
+
+    if (backup_write_table (fd, table, entry->offset) == -1)
+      status = -1;
+  }
+
+  /* Audio, one download session per card */
+  for (c = 0; c < num_cards && status == 0; c++)
+  {
+    dl = rio_download_begin_table (rio_dev, bc[c].folders, 0, bc[c].card);
+    if (dl == NULL)
+      continue;
+
+    for (n = 0; n < num_entries && status == 0; n++)
+    {
+      entry = &index[n];
+      if (entry->type != RIO_BACKUP_AUDIO || entry->card != bc[c].card)
+        continue;
+
+      song = rio_table_song (bc[c].songs[entry->folder], entry->song);
+      if (log)
+      {
+        fprintf (log, "Saving %s\n", song->name1);
+        fflush (log);
+      }
+
+      sink = rio_sink_open_fd (fd, entry->offset, entry->length, RIO_SYNC_NONE, NULL);
+      if (sink == NULL)
+      {
+        status = -1;
+        break;
+      }
+      rio_download_select (dl, song);
+      total = rio_download_read (dl, entry->length, sink);
+      if (rio_sink_close (sink) == -1)
+        status = -1;
+      if (total != entry->length && log)
+        fprintf (log, "Short read on %s (%d of %lu bytes)\n",
+                 song->name1, total, (unsigned long) entry->length);
+    }
+
+    rio_download_end (dl);
+  }
+
+  /* Short reads leave holes; make sure the file is as long as the index says */
+  if (status == 0 && ftruncate (fd, pos) == -1)
+    status = -1;
+
+  for (c = 0; c < num_cards; c++)
+    backup_free_card (&bc[c]);
+  free (index);
+  free (bc);
+
+  return status;
+}
+
+/* Put one card back the way the archive has it */
+static int
+restore_card (rio_device rio_dev, int fd, rio_backup_index *index,
+              int num_entries, int card, FILE *log)
+{
+  rio_backup_index *entry;
+  backup_card       bc;
+  folder_entry     *folder;
+  song_entry       *song;
+  rio_reader       *reader;
+  rio_space        *space;
+  BYTE             *lost;
+  DWORD             needed;
+  int               n, f, s, location, status = 0;
+
+  memset (&bc, 0, sizeof (bc));
+  bc.card = card;
+
+  for (n = 0; n < num_entries; n++)
+  {
+    entry = &index[n];
+    if (entry->card != card)
+      continue;
+    if (entry->type == RIO_BACKUP_FOLDERS)
+    {
+      rio_table_delete (bc.folders);
+      bc.folders = backup_read_table (fd, entry, RIO_TABLE_FOLDERS);
+    }
+    else if (entry->type == RIO_BACKUP_SONGS && entry->folder < RIO_BACKUP_MAX_FOLDERS)
+    {
+      rio_table_delete (bc.songs[entry->folder]);
+      bc.songs[entry->folder] = backup_read_table (fd, entry, RIO_TABLE_SONGS);
+    }
+  }
+
+  if (log)
+    fprintf (log, "Formatting card %d...\n", card);
+  format_flash (rio_dev, card);
+
+  /* In whole blocks, song tables included, or the card can fill up
+     halfway through */
+  space = rio_space_new ();
+  if (space == NULL || rio_space_load (space, rio_dev, card) == -1)
+  {
+    rio_space_delete (space);
+    backup_free_card (&bc);
+    return -1;
+  }
+  needed = 0;
+  for (n = 0; n < num_entries; n++)
+    if (index[n].card == card && index[n].type == RIO_BACKUP_AUDIO)
+      needed += rio_space_blocks (space, card, index[n].length);
+  for (f = 0; f < RIO_BACKUP_MAX_FOLDERS; f++)
+    if (bc.songs[f] != NULL)
+      needed += rio_space_blocks (space, card, bc.songs[f]->count * RIO_ENTRY_SIZE);
+  if (needed > rio_space_free (space, card))
+  {
+    if (log)
+      fprintf (log, "Not enough space on card %d for this backup.\n", card);
+    rio_space_delete (space);
+    backup_free_card (&bc);
+    return -1;
+  }
+  rio_space_delete (space);
+
+  if (bc.folders == NULL)
+    bc.folders = rio_table_new (RIO_TABLE_FOLDERS, 0);
+
+  /* Songs, then each folder's song block once */
+  for (f = 0; f < bc.folders->count && f < RIO_BACKUP_MAX_FOLDERS; f++)
+  {
+    folder = rio_table_folder (bc.folders, f);
+    lost = NULL;
+    if (bc.songs[f] != NULL
+        && (lost = calloc (bc.songs[f]->count + 1, 1)) == NULL)
+    {
+      backup_free_card (&bc);
+      return -1;
+    }
+    /* Until its audio is back on the card */
+    if (lost != NULL)
+      memset (lost, TRUE, bc.songs[f]->count);
+
+    for (n = 0; n < num_entries; n++)
+    {
+      entry = &index[n];
+      if (entry->type != RIO_BACKUP_AUDIO || entry->card != card || entry->folder != f)
+        continue;
+      if (bc.songs[f] == NULL || entry->song >= bc.songs[f]->count)
+        continue;
+      song = rio_table_song (bc.songs[f], entry->song);
+
+      if (log)
+      {
+        fprintf (log, "Restoring %s\n", song->name1);
+        fflush (log);
+      }
+      reader = rio_reader_new (fd, entry->offset, entry->length, NULL);
+      location = -1;
+      if (reader != NULL)
+      {
+        location = rio_upload_song (rio_dev, reader, entry->length, card, NULL);
+        rio_reader_delete (reader);
+      }
+      if (location == -1)
+        continue;
+      song->offset = location;
+      lost[entry->song] = FALSE;
+    }
+
+    /* The offsets of the others are from the archive, and garbage on
+       this card. Highest first, so the numbers stay right. */
+    for (s = bc.songs[f] ? bc.songs[f]->count - 1 : -1; s >= 0; s--)
+      if (lost[s])
+      {
+        if (log)
+          fprintf (log, "Could not restore %s, left out\n",
+                   rio_table_song (bc.songs[f], s)->name1);
+        rio_table_remove (bc.songs[f], s);
+        status = -1;
+      }
+    free (lost);
+
+    rio_write_song_table (rio_dev, f, bc.songs[f], card);
+    send_command (rio_dev, 0x42, 0, 0);
+    send_command (rio_dev, 0x42, 0, 0);
+    folder->offset = send_command (rio_dev, 0x43, 0x0, 0x0);
+    folder->fst_free_entry_off = bc.songs[f] ? bc.songs[f]->count * RIO_ENTRY_SIZE : 0;
+  }
+
+  /* And the folder block, once */
+  rio_write_folder_table (rio_dev, bc.folders, card);
+  send_command (rio_dev, 0x42, 0, 0);
+  send_command (rio_dev, 0x42, 0, 0);
+  location = send_command (rio_dev, 0x43, 0x0, 0x0);
+
+  /* Tell Rio where the root folder block is. */
+  send_folder_location (rio_dev, location, 0, card);
+
+  /* Not really sure what this does */
+  send_command (rio_dev, 0x58, 0x0, card);
+
+  backup_free_card (&bc);
+
+  return status;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_backup_restore
+   DESCRIPTION: Replace the content of every card found in the archive
+                with what the archive holds. Returns 0 or -1.
+   ------------------------------------------------------------------- */
+
+int
+rio_backup_restore (rio_device rio_dev, int fd, FILE *log)
+{
+  rio_backup_header  header;
+  rio_backup_index  *index;
+  int                n, num_entries, status;
+
+  if (backup_pread (fd, &header, sizeof (header), 0) == -1
+      || memcmp (header.magic, RIO_BACKUP_MAGIC, 8) != 0)
+  {
+    if (log)
+      fprintf (log, "Not a rio500 backup archive.\n");
+    return -1;
+  }
+#ifdef WORDS_BIGENDIAN
+  header.version     = bswap_32 (header.version);
+  header.num_entries = bswap_32 (header.num_entries);
+#endif
+  if (header.version != RIO_BACKUP_VERSION)
+  {
+    if (log)
+      fprintf (log, "Unsupported backup archive version %lu.\n",
+               (unsigned long) header.version);
+    return -1;
+  }
+
+  num_entries = header.num_entries;
+  index = calloc (num_entries ? num_entries : 1, sizeof (rio_backup_index));
+  if (index == NULL)
+    return -1;
+  if (backup_pread (fd, index, num_entries * sizeof (rio_backup_index),
+                    sizeof (header)) == -1)
+  {
+    free (index);
+    return -1;
+  }
+  for (n = 0; n < num_entries; n++)
+    backup_swap_index (&index[n]);
+
+  status = 0;
+  for (n = 0; n < num_entries; n++)
+    if (index[n].type == RIO_BACKUP_FOLDERS
+        && restore_card (rio_dev, fd, index, num_entries, index[n].card, log) == -1)
+      status = -1;
+
+  free (index);
+  return status;
+}
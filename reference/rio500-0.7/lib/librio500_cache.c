@@ -0,0 +1,525 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Folder and song table cache.
+
+   Adding, removing or renaming a song used to start by reading the
+   folder block and the song block over USB, every time. The cache keeps
+   the tables of each card in memory (and, if given a file name, on disk
+   between runs) and only reads them again when the Rio looks different.
+
+   Whether it does is decided by a stamp made of things the Rio tells us
+   in a couple of control messages: the firmware revision, the card size,
+   the first free block and number of unused blocks from 0x57 and the
+   offset of the last write from 0x43. Anything that changes the tables
+   writes a block, which moves all but the first two. Taking a stamp
+   costs a handful of control messages instead of the folder block plus
+   one song block per folder.
+
+   The tables handed out belong to the cache. Callers change them in
+   place, write them to the Rio and then call rio_cache_commit so the
+   cache takes the new stamp; anything that can't keep the cache right
+   (removing a folder renumbers the song tables) calls
+   rio_cache_invalidate instead.
+
+   Cache file layout (all numbers little endian):
+
+     magic "RIO500CA", version
+     for every card with tables:
+       card, stamp, number of folders, folder entries,
+       for every folder: number of songs (-1 if not cached), song entries
+     card -1
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+#include <byteswap.h>
+
+#define CACHE_MAGIC                 "RIO500CA"
+#define CACHE_VERSION               1
+
+#ifdef WORDS_BIGENDIAN
+#define CACHE_LE32(x)               bswap_32 (x)
+#else
+#define CACHE_LE32(x)               (x)
+#endif
+
+typedef struct
+{
+  DWORD            firmware;
+  DWORD            num_blocks;
+  DWORD            block_size;
+  DWORD            first_free_block;
+  DWORD            num_unused_blocks;
+  DWORD            last_write;
+} cache_stamp;
+
+typedef struct
+{
+  int              valid;
+  cache_stamp      stamp;
+  rio_table       *folders;
+  rio_table       *songs[RIO_CACHE_MAX_FOLDERS];
+} cache_card;
+
+struct _rio_cache
+{
+  char            *filename;
+  int              dirty;         /* not saved since the last change */
+  cache_card       cards[RIO_CACHE_MAX_CARDS];
+};
+
+
+static void
+cache_take_stamp (rio_device rio_dev, int card, cache_stamp *stamp)
+{
+  mem_status *mem;
+
+  memset (stamp, 0, sizeof (cache_stamp));
+  stamp->firmware = query_firmware_rev (rio_dev);
+
+  mem = get_mem_status (rio_dev, card);
+  stamp->num_blocks        = mem->num_blocks;
+  stamp->block_size        = mem->block_size;
+  stamp->first_free_block  = mem->first_free_block;
+  stamp->num_unused_blocks = mem->num_unused_blocks;
+
+  send_command (rio_dev, 0x42, 0, 0);
+  stamp->last_write = send_command (rio_dev, 0x43, 0x0, 0x0);
+}
+
+static void
+cache_clear_card (cache_card *cc)
+{
+  int f;
+
+  for (f = 0; f < RIO_CACHE_MAX_FOLDERS; f++)
+  {
+    rio_table_delete (cc->songs[f]);
+    cc->songs[f] = NULL;
+  }
+  rio_table_delete (cc->folders);
+  cc->folders = NULL;
+  cc->valid = FALSE;
+}
+
+static cache_card *
+cache_get_card (rio_cache *cache, int card)
+{
+  if (cache == NULL || card < 0 || card >= RIO_CACHE_MAX_CARDS)
+    return NULL;
+  return &cache->cards[card];
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_cache_new
+   DESCRIPTION: Create a table cache. If filename isn't NULL the cache is
+                loaded from it (if it exists) and saved back to it by
+                rio_cache_save and rio_cache_delete.
+   ------------------------------------------------------------------- */
+
+rio_cache *
+rio_cache_new (char *filename)
+{
+  rio_cache *cache;
+
+  cache = calloc (1, sizeof (rio_cache));
+  if (cache == NULL)
+    return NULL;
+
+  if (filename != NULL)
+  {
+    cache->filename = g_strdup (filename);
+    rio_cache_load (cache);
+  }
+
+  return cache;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_cache_delete
+   DESCRIPTION: Save the cache if it has a file and free it.
+   ------------------------------------------------------------------- */
+
+void
+rio_cache_delete (rio_cache *cache)
+{
+  int c;
+
+  if (cache == NULL)
+    return;
+
+  if (cache->dirty)
+    rio_cache_save (cache);
+
+  for (c = 0; c < RIO_CACHE_MAX_CARDS; c++)
+    cache_clear_card (&cache->cards[c]);
+  g_free (cache->filename);
+  free (cache);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_cache_folders
+   DESCRIPTION: The folder table of card. Checks the stamp first and
+                reads the table again if the Rio has changed since it
+                was cached. The table belongs to the cache. NULL if it
+                can't be read.
+   ------------------------------------------------------------------- */
+
+rio_table *
+rio_cache_folders (rio_cache *cache, rio_device rio_dev, int card)
+{
+  cache_card  *cc;
+  cache_stamp  stamp;
+
+  cc = cache_get_card (cache, card);
+  if (cc == NULL)
+    return NULL;
+
+  cache_take_stamp (rio_dev, card, &stamp);
+  if (cc->valid && memcmp (&stamp, &cc->stamp, sizeof (cache_stamp)) == 0)
+    return cc->folders;
+
+  cache_clear_card (cc);
+  cc->folders = rio_read_folder_table (rio_dev, card);
+  if (cc->folders == NULL)
+    return NULL;
+
+  cc->stamp = stamp;
+  cc->valid = TRUE;
+  cache->dirty = TRUE;
+
+  return cc->folders;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_cache_songs
+   DESCRIPTION: The song table of folder folder_num, read if it isn't
+                cached yet. Call after rio_cache_folders, which does the
+                checking. The table belongs to the cache.
+   ------------------------------------------------------------------- */
+
+rio_table *
+rio_cache_songs (rio_cache *cache, rio_device rio_dev, int card, int folder_num)
+{
+  cache_card *cc;
+
+  cc = cache_get_card (cache, card);
+  if (cc == NULL || !cc->valid || folder_num < 0
+      || folder_num >= cc->folders->count || folder_num >= RIO_CACHE_MAX_FOLDERS)
+    return NULL;
+
+  if (cc->songs[folder_num] == NULL)
+  {
+    cc->songs[folder_num] = rio_read_song_table (rio_dev,
+                                                 rio_table_folder (cc->folders, folder_num),
+                                                 folder_num, card);
+    cache->dirty = TRUE;
+  }
+
+  return cc->songs[folder_num];
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_cache_wants_songs
+   DESCRIPTION: TRUE if folder_num is a folder of the cached table whose
+                songs haven't been read yet.
+   ------------------------------------------------------------------- */
+
+int
+rio_cache_wants_songs (rio_cache *cache, int card, int folder_num)
+{
+  cache_card *cc;
+
+  cc = cache_get_card (cache, card);
+  return (cc != NULL && cc->valid && folder_num >= 0
+          && folder_num < cc->folders->count && folder_num < RIO_CACHE_MAX_FOLDERS
+          && cc->songs[folder_num] == NULL);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_cache_commit
+   DESCRIPTION: The cached tables of card have been changed and written
+                to the Rio; remember how the Rio looks now.
+   ------------------------------------------------------------------- */
+
+void
+rio_cache_commit (rio_cache *cache, rio_device rio_dev, int card)
+{
+  cache_card *cc;
+
+  cc = cache_get_card (cache, card);
+  if (cc == NULL || !cc->valid)
+    return;
+
+  cache_take_stamp (rio_dev, card, &cc->stamp);
+  cache->dirty = TRUE;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_cache_mem_status
+   DESCRIPTION: The memory status of card as of the last check or
+                commit, from the stamp; no control messages. Returns 0,
+                or -1 if nothing is cached for card.
+   ------------------------------------------------------------------- */
+
+int
+rio_cache_mem_status (rio_cache *cache, int card, mem_status *mem)
+{
+  cache_card *cc;
+
+  cc = cache_get_card (cache, card);
+  if (cc == NULL || !cc->valid)
+    return -1;
+
+  memset (mem, 0, sizeof (mem_status));
+  mem->block_size        = cc->stamp.block_size;
+  mem->num_blocks        = cc->stamp.num_blocks;
+  mem->first_free_block  = cc->stamp.first_free_block;
+  mem->num_unused_blocks = cc->stamp.num_unused_blocks;
+
+  return 0;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_cache_invalidate
+   DESCRIPTION: Forget everything about card (-1 for all of them).
+   ------------------------------------------------------------------- */
+
+void
+rio_cache_invalidate (rio_cache *cache, int card)
+{
+  int c;
+
+  if (cache == NULL)
+    return;
+
+  for (c = 0; c < RIO_CACHE_MAX_CARDS; c++)
+    if (card == -1 || card == c)
+      cache_clear_card (&cache->cards[c]);
+  cache->dirty = TRUE;
+}
+
+
+/* Cache file */
+
+static int
+cache_write_dword (FILE *fp, DWORD value)
+{
+  value = CACHE_LE32 (value);
+  return (fwrite (&value, sizeof (DWORD), 1, fp) == 1) ? 0 : -1;
+}
+
+static int
+cache_read_dword (FILE *fp, DWORD *value)
+{
+  if (fread (value, sizeof (DWORD), 1, fp) != 1)
+    return -1;
+  *value = CACHE_LE32 (*value);
+  return 0;
+}
+
+static int
+cache_write_table (FILE *fp, rio_table *table)
+{
+  int status = 0;
+#ifdef WORDS_BIGENDIAN
+  BYTE block[FOLDER_BLOCK_SIZE];
+  int  i, n;
+#endif
+
+  if (table == NULL)
+    return cache_write_dword (fp, (DWORD) -1);
+
+  if (cache_write_dword (fp, table->count) == -1)
+    return -1;
+
+#ifndef WORDS_BIGENDIAN
+  if (table->count > 0
+      && fwrite (table->entries, RIO_ENTRY_SIZE, table->count, fp) != table->count)
+    status = -1;
+#else
+  /* A block's worth at a time */
+  for (i = 0; i < table->count && status == 0; i += n)
+  {
+    n = table->count - i;
+    if (n > FOLDER_BLOCK_SIZE / RIO_ENTRY_SIZE)
+      n = FOLDER_BLOCK_SIZE / RIO_ENTRY_SIZE;
+    memcpy (block, rio_table_entry (table, i), n * RIO_ENTRY_SIZE);
+    rio_codec_entries (table->type, block, n);
+    if (fwrite (block, RIO_ENTRY_SIZE, n, fp) != n)
+      status = -1;
+  }
+#endif
+
+  return status;
+}
+
+/* Returns -1 on error; *table is NULL if nothing was cached */
+static int
+cache_read_table (FILE *fp, int type, rio_table **table)
+{
+  DWORD count;
+
+  *table = NULL;
+  if (cache_read_dword (fp, &count) == -1)
+    return -1;
+  if (count == (DWORD) -1)
+    return 0;
+  if (count > RIO_XFER_SIZE / RIO_ENTRY_SIZE)
+    return -1;
+
+  *table = rio_table_new (type, count);
+  if (*table == NULL)
+    return -1;
+  if (count > 0 && fread ((*table)->entries, RIO_ENTRY_SIZE, count, fp) != count)
+  {
+    rio_table_delete (*table);
+    *table = NULL;
+    return -1;
+  }
+  (*table)->count = count;
+  (*table)->dirty = 0;
+  rio_codec_entries (type, (*table)->entries, count);
+
+  return 0;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_cache_load
+   DESCRIPTION: Replace the cache content with what its file holds. A
+                missing or damaged file just leaves the cache empty.
+                Returns 0 if the file was loaded, -1 otherwise.
+   ------------------------------------------------------------------- */
+
+int
+rio_cache_load (rio_cache *cache)
+{
+  FILE        *fp;
+  cache_card  *cc;
+  char         magic[8];
+  DWORD        version, card, count;
+  DWORD       *fields;
+  int          f, i, status;
+
+  if (cache == NULL || cache->filename == NULL)
+    return -1;
+
+  rio_cache_invalidate (cache, -1);
+  cache->dirty = FALSE;
+
+  fp = fopen (cache->filename, "rb");
+  if (fp == NULL)
+    return -1;
+
+  status = -1;
+  if (fread (magic, 8, 1, fp) != 1 || memcmp (magic, CACHE_MAGIC, 8) != 0
+      || cache_read_dword (fp, &version) == -1 || version != CACHE_VERSION)
+    goto done;
+
+  for (;;)
+  {
+    if (cache_read_dword (fp, &card) == -1)
+      goto done;
+    if (card == (DWORD) -1)
+      break;
+    cc = cache_get_card (cache, card);
+    if (cc == NULL)
+      goto done;
+    cache_clear_card (cc);
+
+    fields = (DWORD *) &cc->stamp;
+    for (i = 0; i < sizeof (cache_stamp) / sizeof (DWORD); i++)
+      if (cache_read_dword (fp, &fields[i]) == -1)
+        goto done;
+
+    if (cache_read_table (fp, RIO_TABLE_FOLDERS, &cc->folders) == -1
+        || cc->folders == NULL)
+      goto done;
+
+    count = cc->folders->count;
+    for (f = 0; f < count && f < RIO_CACHE_MAX_FOLDERS; f++)
+      if (cache_read_table (fp, RIO_TABLE_SONGS, &cc->songs[f]) == -1)
+        goto done;
+    cc->valid = TRUE;
+  }
+  status = 0;
+
+done:
+  fclose (fp);
+  if (status == -1)
+    rio_cache_invalidate (cache, -1);
+  cache->dirty = FALSE;
+
+  return status;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_cache_save
+   DESCRIPTION: Write the cache to its file. Returns 0 or -1.
+   ------------------------------------------------------------------- */
+
+int
+rio_cache_save (rio_cache *cache)
+{
+  FILE        *fp;
+  cache_card  *cc;
+  DWORD       *fields;
+  int          c, f, i, status;
+
+  if (cache == NULL || cache->filename == NULL)
+    return -1;
+
+  fp = fopen (cache->filename, "wb");
+  if (fp == NULL)
+    return -1;
+
+  status = 0;
+  if (fwrite (CACHE_MAGIC, 8, 1, fp) != 1
+      || cache_write_dword (fp, CACHE_VERSION) == -1)
+    status = -1;
+
+  for (c = 0; c < RIO_CACHE_MAX_CARDS && status == 0; c++)
+  {
+    cc = &cache->cards[c];
+    if (!cc->valid)
+      continue;
+
+    status = cache_write_dword (fp, c);
+    fields = (DWORD *) &cc->stamp;
+    for (i = 0; i < sizeof (cache_stamp) / sizeof (DWORD) && status == 0; i++)
+      status = cache_write_dword (fp, fields[i]);
+    if (status == 0)
+      status = cache_write_table (fp, cc->folders);
+    for (f = 0; f < cc->folders->count && f < RIO_CACHE_MAX_FOLDERS && status == 0; f++)
+      status = cache_write_table (fp, cc->songs[f]);
+  }
+  if (status == 0)
+    status = cache_write_dword (fp, (DWORD) -1);
+
+  if (fclose (fp) != 0)
+    status = -1;
+  if (status == 0)
+    cache->dirty = FALSE;
+
+  return status;
+}
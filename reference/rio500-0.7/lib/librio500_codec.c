@@ -0,0 +1,255 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Rio byte order.
+
+   Everything the Rio sends or takes is little endian. The entries and
+   status structs used to be converted field by field, by hand, in a
+   bswap_ function or an #ifdef block per struct, trusting the compiler
+   to lay the structs out the way the Rio does. Here each wire format is
+   a table of where its numbers are, and one loop converts any of them:
+   a whole table block of entries at a time on big endian machines, and
+   nothing at all on little endian ones.
+
+   The entry layouts are checked against song_entry and folder_entry at
+   compile time, so a compiler that packs them differently fails the
+   build instead of talking nonsense to the Rio. The title bitmap's
+   num_blocks is not in the tables: entries keep it in Rio order on the
+   host too (song_entry_new and friends put it that way).
+
+   The status structs are small and have padding the compiler decides
+   on, so they are read from and written to a byte buffer instead.
+*/
+
+#include "librio500.h"
+
+#include <stddef.h>
+#include <string.h>
+
+typedef struct
+{
+  unsigned short   offset;
+  unsigned short   size;          /* 2 or 4; 0 ends the table */
+} codec_field;
+
+/* 0x57 reply. dunno2 is at 0x0c, where the compiler has always put it
+   when the reply was read straight into a mem_status. */
+static const codec_field mem_status_layout[] =
+{
+  { 0x00, 2 },                    /* dunno1 */
+  { 0x02, 2 },                    /* block_size */
+  { 0x04, 2 },                    /* num_blocks */
+  { 0x06, 2 },                    /* first_free_block */
+  { 0x08, 2 },                    /* num_unused_blocks */
+  { 0x0c, 4 },                    /* dunno2 */
+  { 0x10, 4 },                    /* dunno3 */
+  { 0, 0 }
+};
+
+/* 0x56 request */
+static const codec_field folder_location_layout[] =
+{
+  { 0x00, 2 },                    /* offset */
+  { 0x02, 2 },                    /* bytes */
+  { 0x04, 2 },                    /* folder_num */
+  { 0, 0 }
+};
+
+#define CODEC_CHECK(name, cond)     typedef char codec_check_##name[(cond) ? 1 : -1]
+
+CODEC_CHECK (song_size,      sizeof (song_entry) == RIO_ENTRY_SIZE);
+CODEC_CHECK (song_length,    offsetof (song_entry, length) == 0x04);
+CODEC_CHECK (song_mp3sig,    offsetof (song_entry, mp3sig) == 0x0c);
+CODEC_CHECK (song_time,      offsetof (song_entry, time) == 0x10);
+CODEC_CHECK (song_bitmap,    offsetof (song_entry, bitmap) == 0x14);
+CODEC_CHECK (song_name1,     offsetof (song_entry, name1) == 0x616);
+CODEC_CHECK (song_name2,     offsetof (song_entry, name2) == 0x780);
+CODEC_CHECK (folder_size,    sizeof (folder_entry) == RIO_ENTRY_SIZE);
+CODEC_CHECK (folder_free,    offsetof (folder_entry, fst_free_entry_off) == 0x04);
+CODEC_CHECK (folder_dunno3,  offsetof (folder_entry, dunno3) == 0x08);
+CODEC_CHECK (folder_time,    offsetof (folder_entry, time) == 0x10);
+CODEC_CHECK (folder_bitmap,  offsetof (folder_entry, bitmap) == 0x14);
+CODEC_CHECK (folder_name1,   offsetof (folder_entry, name1) == 0x616);
+CODEC_CHECK (folder_name2,   offsetof (folder_entry, name2) == 0x780);
+
+
+#ifdef WORDS_BIGENDIAN
+/* 0x800 byte song entry: numbers, bitmap at 0x14, name1 at 0x616,
+   name2 at 0x780 */
+static const codec_field song_layout[] =
+{
+  { 0x00, 2 },                    /* offset */
+  { 0x02, 2 },                    /* dunno1 */
+  { 0x04, 4 },                    /* length */
+  { 0x08, 2 },                    /* dunno2 */
+  { 0x0a, 2 },                    /* dunno3 */
+  { 0x0c, 4 },                    /* mp3sig */
+  { 0x10, 4 },                    /* time */
+  { 0, 0 }
+};
+
+/* 0x800 byte folder entry, same bitmap and names */
+static const codec_field folder_layout[] =
+{
+  { 0x00, 2 },                    /* offset */
+  { 0x02, 2 },                    /* dunno1 */
+  { 0x04, 2 },                    /* fst_free_entry_off */
+  { 0x06, 2 },                    /* dunno2 */
+  { 0x08, 4 },                    /* dunno3 */
+  { 0x0c, 4 },                    /* dunno4 */
+  { 0x10, 4 },                    /* time */
+  { 0, 0 }
+};
+
+static void
+codec_swap (const codec_field *layout, BYTE *data)
+{
+  BYTE *p, t;
+
+  for (; layout->size; layout++)
+  {
+    p = data + layout->offset;
+    if (layout->size == 2)
+    {
+      t = p[0]; p[0] = p[1]; p[1] = t;
+    }
+    else
+    {
+      t = p[0]; p[0] = p[3]; p[3] = t;
+      t = p[1]; p[1] = p[2]; p[2] = t;
+    }
+  }
+}
+#endif
+
+/* Copy the numbers of a wire struct into the fields of a host one, and
+   back. field_offsets says where each of them is in the host struct. */
+static void
+codec_get (const codec_field *layout, const BYTE *wire, BYTE *host,
+           const size_t *field_offsets)
+{
+  const BYTE *p;
+  WORD        w;
+  DWORD       d;
+
+  for (; layout->size; layout++, field_offsets++)
+  {
+    p = wire + layout->offset;
+    if (layout->size == 2)
+    {
+      w = (WORD) (p[0] | (p[1] << 8));
+      memcpy (host + *field_offsets, &w, sizeof (WORD));
+    }
+    else
+    {
+      d = (DWORD) p[0] | ((DWORD) p[1] << 8) | ((DWORD) p[2] << 16) | ((DWORD) p[3] << 24);
+      memcpy (host + *field_offsets, &d, sizeof (DWORD));
+    }
+  }
+}
+
+static void
+codec_put (const codec_field *layout, const BYTE *host, BYTE *wire,
+           const size_t *field_offsets)
+{
+  BYTE  *p;
+  WORD   w;
+  DWORD  d;
+
+  for (; layout->size; layout++, field_offsets++)
+  {
+    p = wire + layout->offset;
+    if (layout->size == 2)
+    {
+      memcpy (&w, host + *field_offsets, sizeof (WORD));
+      p[0] = w & 0xff;
+      p[1] = w >> 8;
+    }
+    else
+    {
+      memcpy (&d, host + *field_offsets, sizeof (DWORD));
+      p[0] = d & 0xff;
+      p[1] = (d >> 8) & 0xff;
+      p[2] = (d >> 16) & 0xff;
+      p[3] = d >> 24;
+    }
+  }
+}
+
+static const size_t mem_status_fields[] =
+{
+  offsetof (mem_status, dunno1),
+  offsetof (mem_status, block_size),
+  offsetof (mem_status, num_blocks),
+  offsetof (mem_status, first_free_block),
+  offsetof (mem_status, num_unused_blocks),
+  offsetof (mem_status, dunno2),
+  offsetof (mem_status, dunno3)
+};
+
+static const size_t folder_location_fields[] =
+{
+  offsetof (folder_location, offset),
+  offsetof (folder_location, bytes),
+  offsetof (folder_location, folder_num)
+};
+
+/* -------------------------------------------------------------------
+   NAME:        rio_codec_entries
+   DESCRIPTION: Convert count entries of a table (RIO_TABLE_FOLDERS or
+                RIO_TABLE_SONGS), back to back at entries, from Rio to
+                host order or the other way round. Does nothing on
+                little endian machines.
+   ------------------------------------------------------------------- */
+
+void
+rio_codec_entries (int type, BYTE *entries, int count)
+{
+#ifdef WORDS_BIGENDIAN
+  const codec_field *layout;
+  int                i;
+
+  layout = (type == RIO_TABLE_FOLDERS) ? folder_layout : song_layout;
+  for (i = 0; i < count; i++)
+    codec_swap (layout, entries + i * RIO_ENTRY_SIZE);
+#endif
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_codec_get_mem_status, rio_codec_put_folder_location
+   DESCRIPTION: Unpack a 0x57 reply (RIO_MEM_STATUS_SIZE bytes) and pack
+                a 0x56 request (RIO_FOLDER_LOCATION_SIZE bytes).
+   ------------------------------------------------------------------- */
+
+void
+rio_codec_get_mem_status (const BYTE *wire, mem_status *status)
+{
+  memset (status, 0, sizeof (mem_status));
+  codec_get (mem_status_layout, wire, (BYTE *) status, mem_status_fields);
+}
+
+void
+rio_codec_put_folder_location (const folder_location *location, BYTE *wire)
+{
+  memset (wire, 0, RIO_FOLDER_LOCATION_SIZE);
+  codec_put (folder_location_layout, (const BYTE *) location, wire,
+             folder_location_fields);
+}
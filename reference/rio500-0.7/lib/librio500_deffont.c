@@ -0,0 +1,268 @@
+/* Generated by rio_font_pack -c from defjam.fon; do not edit. */
+
+#include "librio500.h"
+
+const char rio_default_font_name[] = "defjam.fon";
+
+const int  rio_default_font_pack_size = 3080;
+
+const BYTE rio_default_font_pack[] =
+{
+  0x52, 0x47, 0x50, 0x31, 0x0b, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x05,
+  0x03, 0x05, 0x05, 0x02, 0x08, 0x02, 0x02, 0x05, 0x04, 0x06, 0x06, 0x06,
+  0x04, 0x08, 0x08, 0x05, 0x08, 0x02, 0x02, 0x02, 0x02, 0x03, 0x03, 0x07,
+  0x07, 0x03, 0x05, 0x08, 0x05, 0x08, 0x08, 0x05, 0x08, 0x02, 0x02, 0x02,
+  0x02, 0x02, 0x05, 0x05, 0x05, 0x04, 0x02, 0x05, 0x04, 0x08, 0x06, 0x08,
+  0x05, 0x02, 0x08, 0x05, 0x02, 0x08, 0x05, 0x05, 0x03, 0x05, 0x08, 0x02,
+  0x03, 0x05, 0x05, 0x08, 0x06, 0x06, 0x06, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x05, 0x07, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x07, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x05, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x06, 0x06, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c,
+  0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20,
+  0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78,
+  0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70,
+  0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20,
+  0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c,
+  0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20,
+  0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78,
+  0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70,
+  0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20,
+  0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x1c, 0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c,
+  0x20, 0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20,
+  0x78, 0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78,
+  0x70, 0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70,
+  0x20, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x38, 0x38, 0x38, 0x38, 0x00, 0x38,
+  0x00, 0x00, 0x00, 0x00, 0x66, 0x66, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x36, 0x36, 0x7f, 0x36, 0x7f, 0x36, 0x36, 0x00, 0x00,
+  0x00, 0x00, 0x18, 0x3e, 0x60, 0x3c, 0x06, 0x7c, 0x18, 0x00, 0x00, 0x00,
+  0x00, 0x62, 0x66, 0x0c, 0x18, 0x30, 0x66, 0x46, 0x00, 0x00, 0x00, 0x00,
+  0x3c, 0x66, 0x3c, 0x38, 0x67, 0x66, 0x3f, 0x00, 0x00, 0x00, 0x00, 0x0c,
+  0x18, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x30,
+  0x30, 0x30, 0x30, 0x30, 0x30, 0x1c, 0x00, 0x00, 0x00, 0x38, 0x0c, 0x0c,
+  0x0c, 0x0c, 0x0c, 0x0c, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x36, 0x1c,
+  0x7f, 0x1c, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x7e,
+  0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18,
+  0x18, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x7f, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x0c, 0x18, 0x30, 0x60, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x7f, 0x73, 0x73, 0x73, 0x7f, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x7c, 0x1c, 0x1c, 0x1c, 0x3e, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x7f, 0x03, 0x7f, 0x70, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x7f, 0x07, 0x7f, 0x07, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70,
+  0x70, 0x76, 0x7f, 0x06, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f,
+  0x70, 0x7f, 0x07, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0x70, 0x70,
+  0x7f, 0x73, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x07, 0x07,
+  0x07, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x73, 0x7f, 0x73,
+  0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x47, 0x7f, 0x07, 0x07,
+  0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x18, 0x18, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x18, 0x18, 0x30, 0x00,
+  0x00, 0x00, 0x0c, 0x18, 0x30, 0x60, 0x30, 0x18, 0x0c, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x7e, 0x7e, 0x00, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00,
+  0x30, 0x18, 0x0c, 0x06, 0x0c, 0x18, 0x30, 0x00, 0x00, 0x00, 0x00, 0x7c,
+  0x06, 0x1e, 0x1c, 0x1c, 0x00, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x3e, 0x71, 0x77, 0x70, 0x3f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+  0x03, 0x7f, 0x73, 0x73, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x03,
+  0x7e, 0x73, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x70, 0x70,
+  0x70, 0x3f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x03, 0x73, 0x73,
+  0x7e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x7f, 0x70, 0x7f,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x70, 0x7f, 0x70, 0x70, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x70, 0x73, 0x73, 0x3f, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x73, 0x73, 0x7f, 0x73, 0x73, 0x70, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0xff, 0x07, 0x07, 0x07, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x73, 0x76, 0x7c, 0x76, 0x73, 0x70, 0x00, 0x00, 0x00, 0x00, 0x70,
+  0x70, 0x70, 0x70, 0x70, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x63,
+  0x77, 0x7f, 0x6b, 0x63, 0x60, 0x00, 0x00, 0x00, 0x40, 0x60, 0x73, 0x7b,
+  0x7f, 0x77, 0x73, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x03, 0x73,
+  0x73, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x03, 0x7e, 0x70,
+  0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x73, 0x73, 0x77, 0x3e,
+  0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x03, 0x7e, 0x76, 0x73, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x0f, 0x1c, 0x1c, 0x1c, 0xf8, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0x1c, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x73, 0x73, 0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x73, 0x73, 0x73, 0x3e, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x03,
+  0x03, 0x63, 0x6b, 0x7f, 0x77, 0x63, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x73, 0x73, 0x3e, 0x73, 0x73, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x73,
+  0x73, 0x7f, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x07,
+  0x3e, 0x70, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x38, 0x38, 0x38,
+  0x38, 0x38, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x30, 0x18, 0x0c,
+  0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e,
+  0x3e, 0x00, 0x00, 0x18, 0x3c, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00,
+  0x00, 0x00, 0x30, 0x18, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0xff, 0x03, 0x7f, 0x73, 0x73, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0xfe, 0x03, 0x7e, 0x73, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x3f, 0x70, 0x70, 0x70, 0x3f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xfe, 0x03, 0x73, 0x73, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+  0x00, 0x7f, 0x70, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x70,
+  0x7f, 0x70, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x70, 0x73,
+  0x73, 0x3f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x73, 0x73, 0x7f, 0x73,
+  0x73, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x07, 0x07, 0x07, 0x7f, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x73, 0x76, 0x7c, 0x76, 0x73, 0x70, 0x00,
+  0x00, 0x00, 0x00, 0x70, 0x70, 0x70, 0x70, 0x70, 0x7f, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x63, 0x77, 0x7f, 0x6b, 0x63, 0x60, 0x00, 0x00, 0x00,
+  0x40, 0x60, 0x73, 0x7b, 0x7f, 0x77, 0x73, 0x01, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0xfe, 0x03, 0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xfe, 0x03, 0x7e, 0x70, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e,
+  0x63, 0x63, 0x67, 0x3e, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x03,
+  0x7e, 0x76, 0x73, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0f, 0x1c, 0x1c,
+  0x1c, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x1c, 0x1c, 0x1c,
+  0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x73, 0x73, 0x73, 0x73, 0x3e,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x73, 0x73, 0x73, 0x3e, 0x1c, 0x00,
+  0x00, 0x00, 0x00, 0x03, 0x03, 0x63, 0x6b, 0x7f, 0x77, 0x63, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x73, 0x73, 0x3e, 0x73, 0x73, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x73, 0x73, 0x7f, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0xff, 0x07, 0x3e, 0x70, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x10,
+  0x20, 0x20, 0x20, 0x40, 0x20, 0x20, 0x20, 0x10, 0x00, 0x00, 0x00, 0x40,
+  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x40, 0x20, 0x20,
+  0x20, 0x10, 0x20, 0x20, 0x20, 0x40, 0x00, 0x00, 0x00, 0x28, 0x50, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x40, 0x40, 0x40,
+  0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x20, 0x78, 0x70, 0x20,
+  0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+  0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x40,
+  0x00, 0x00, 0x00, 0x08, 0x10, 0x10, 0x38, 0x10, 0x10, 0x10, 0x50, 0x20,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x50, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x54, 0x00, 0x00, 0x00, 0x00,
+  0x10, 0x10, 0x7c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x10,
+  0x10, 0x7c, 0x10, 0x10, 0x7c, 0x10, 0x10, 0x00, 0x00, 0x00, 0x20, 0x50,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x24, 0x58, 0x28,
+  0x10, 0x2a, 0x35, 0x4a, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x04, 0x0f, 0x1c,
+  0x1c, 0x1c, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x20, 0x40,
+  0x20, 0x10, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x49, 0x48, 0x4e, 0x48, 0x49,
+  0x3f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+  0x40, 0x00, 0x00, 0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+  0x00, 0x00, 0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00,
+  0x00, 0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00,
+  0x00, 0x20, 0x40, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x60, 0x20, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x24,
+  0x48, 0x6c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x6c, 0x24,
+  0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x60, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x28, 0x50, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x7a, 0x2e, 0x2a, 0x2a, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x0a, 0x04, 0x0f, 0x1c, 0x1c, 0x1c, 0xf8, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x20, 0x10, 0x20, 0x40, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x36, 0x49, 0x4f, 0x48, 0x36, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00,
+  0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00,
+  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00,
+  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x08, 0x38,
+  0x40, 0x40, 0x38, 0x20, 0x00, 0x00, 0x00, 0x30, 0x40, 0x20, 0x70, 0x20,
+  0x40, 0x78, 0x00, 0x00, 0x00, 0x00, 0x48, 0x30, 0x30, 0x48, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x50, 0x20, 0x70, 0x20, 0x70, 0x20,
+  0x00, 0x00, 0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x00, 0x40, 0x40, 0x40,
+  0x40, 0x00, 0x00, 0x30, 0x48, 0x20, 0x50, 0x28, 0x10, 0x48, 0x30, 0x00,
+  0x00, 0x00, 0x00, 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x1c, 0x22, 0x5d, 0x51, 0x5d, 0x22, 0x1c, 0x00, 0x00, 0x00, 0x00,
+  0x70, 0x08, 0x38, 0x48, 0x38, 0x00, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x09, 0x12, 0x24, 0x12, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x78, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x59, 0x5d,
+  0x55, 0x22, 0x1c, 0x00, 0x00, 0x00, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x7e, 0x18, 0x18, 0x00, 0x7e,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x10, 0x20, 0x70, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x60, 0x10, 0x30, 0x60, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x20, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x50, 0x50, 0x50, 0x68, 0x40, 0x40, 0x00, 0x00,
+  0x00, 0x3e, 0x74, 0x74, 0x34, 0x14, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x60, 0x00, 0x00, 0x00, 0x20, 0x60,
+  0x20, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x50, 0x50,
+  0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x24, 0x12, 0x09,
+  0x12, 0x24, 0x00, 0x00, 0x00, 0x00, 0x40, 0x44, 0x48, 0x10, 0x24, 0x4c,
+  0x04, 0x00, 0x00, 0x00, 0x00, 0x40, 0x44, 0x48, 0x10, 0x2c, 0x44, 0x0c,
+  0x00, 0x00, 0x00, 0x00, 0x60, 0x24, 0x68, 0x10, 0x24, 0x4c, 0x04, 0x00,
+  0x00, 0x00, 0x00, 0x38, 0x00, 0x38, 0x38, 0x78, 0x60, 0x3e, 0x00, 0x00,
+  0x00, 0x08, 0x04, 0x00, 0xff, 0x03, 0x7f, 0x73, 0x73, 0x00, 0x00, 0x00,
+  0x04, 0x08, 0x00, 0xff, 0x03, 0x7f, 0x73, 0x73, 0x00, 0x00, 0x00, 0x08,
+  0x14, 0x00, 0xff, 0x03, 0x7f, 0x73, 0x73, 0x00, 0x00, 0x00, 0x0a, 0x14,
+  0x00, 0xff, 0x03, 0x7f, 0x73, 0x73, 0x00, 0x00, 0x00, 0x00, 0x36, 0x00,
+  0xff, 0x03, 0x7f, 0x73, 0x73, 0x00, 0x00, 0x00, 0x08, 0x14, 0x08, 0xff,
+  0x03, 0x7f, 0x73, 0x73, 0x00, 0x00, 0x00, 0x00, 0x1f, 0x29, 0x28, 0x4e,
+  0x78, 0x49, 0x4f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x70, 0x70,
+  0x70, 0x3f, 0x0c, 0x18, 0x00, 0x10, 0x08, 0x00, 0xff, 0x00, 0x7f, 0x70,
+  0x7f, 0x00, 0x00, 0x00, 0x08, 0x10, 0x00, 0xff, 0x00, 0x7f, 0x70, 0x7f,
+  0x00, 0x00, 0x00, 0x08, 0x14, 0x00, 0xff, 0x00, 0x7f, 0x70, 0x7f, 0x00,
+  0x00, 0x00, 0x00, 0x36, 0x00, 0xff, 0x00, 0x7f, 0x70, 0x7f, 0x00, 0x00,
+  0x00, 0x08, 0x04, 0x00, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00,
+  0x04, 0x08, 0x00, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00, 0x08,
+  0x14, 0x00, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x36,
+  0x00, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xfe, 0x03, 0x7b, 0x33, 0x3e, 0x00, 0x00, 0x00, 0x0a, 0x54, 0x60, 0x73,
+  0x7b, 0x7f, 0x77, 0x73, 0x01, 0x00, 0x00, 0x08, 0x04, 0x00, 0xfe, 0x03,
+  0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x04, 0x08, 0x00, 0xfe, 0x03, 0x73,
+  0x73, 0x3e, 0x00, 0x00, 0x00, 0x08, 0x14, 0x00, 0xfe, 0x03, 0x73, 0x73,
+  0x3e, 0x00, 0x00, 0x00, 0x1a, 0x2c, 0x00, 0xfe, 0x03, 0x73, 0x73, 0x3e,
+  0x00, 0x00, 0x00, 0x00, 0x36, 0x00, 0xfe, 0x03, 0x73, 0x73, 0x3e, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x30, 0x30, 0x48, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x3e, 0x46, 0x4a, 0x4a, 0x52, 0x62, 0x7c, 0x00, 0x00, 0x00,
+  0x08, 0x04, 0x00, 0x73, 0x73, 0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x04,
+  0x08, 0x00, 0x73, 0x73, 0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x08, 0x14,
+  0x00, 0x73, 0x73, 0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x36, 0x00,
+  0x73, 0x73, 0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x04, 0x08, 0x00, 0x73,
+  0x73, 0x7f, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00, 0x60, 0x3c, 0x22, 0x22,
+  0x22, 0x3c, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x03, 0x7e,
+  0x73, 0x7e, 0x70, 0x00, 0x00, 0x08, 0x04, 0x00, 0xff, 0x03, 0x7f, 0x73,
+  0x73, 0x00, 0x00, 0x00, 0x04, 0x08, 0x00, 0xff, 0x03, 0x7f, 0x73, 0x73,
+  0x00, 0x00, 0x00, 0x08, 0x14, 0x00, 0xff, 0x03, 0x7f, 0x73, 0x73, 0x00,
+  0x00, 0x00, 0x0a, 0x14, 0x00, 0xff, 0x03, 0x7f, 0x73, 0x73, 0x00, 0x00,
+  0x00, 0x00, 0x36, 0x00, 0xff, 0x03, 0x7f, 0x73, 0x73, 0x00, 0x00, 0x00,
+  0x08, 0x14, 0x08, 0xff, 0x03, 0x7f, 0x73, 0x73, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x36, 0x09, 0x3f, 0x48, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x3f, 0x70, 0x70, 0x70, 0x3f, 0x0c, 0x18, 0x00, 0x10, 0x08, 0x00,
+  0xff, 0x00, 0x7f, 0x70, 0x7f, 0x00, 0x00, 0x00, 0x08, 0x10, 0x00, 0xff,
+  0x00, 0x7f, 0x70, 0x7f, 0x00, 0x00, 0x00, 0x08, 0x14, 0x00, 0xff, 0x00,
+  0x7f, 0x70, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x36, 0x00, 0xff, 0x00, 0x7f,
+  0x70, 0x7f, 0x00, 0x00, 0x00, 0x08, 0x04, 0x00, 0x1c, 0x1c, 0x1c, 0x1c,
+  0x1c, 0x00, 0x00, 0x00, 0x04, 0x08, 0x00, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c,
+  0x00, 0x00, 0x00, 0x08, 0x14, 0x00, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x00,
+  0x00, 0x00, 0x00, 0x36, 0x00, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x00, 0x00,
+  0x00, 0x00, 0x60, 0x60, 0x10, 0x30, 0x48, 0x48, 0x30, 0x00, 0x00, 0x00,
+  0x0a, 0x54, 0x60, 0x73, 0x7b, 0x7f, 0x77, 0x73, 0x01, 0x00, 0x00, 0x08,
+  0x04, 0x00, 0xfe, 0x03, 0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x04, 0x08,
+  0x00, 0xfe, 0x03, 0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x08, 0x14, 0x00,
+  0xfe, 0x03, 0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x1a, 0x2c, 0x00, 0xfe,
+  0x03, 0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x36, 0x00, 0xfe, 0x03,
+  0x73, 0x73, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x7c,
+  0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x4c, 0x54, 0x64,
+  0x78, 0x00, 0x00, 0x00, 0x08, 0x04, 0x00, 0x73, 0x73, 0x73, 0x73, 0x3e,
+  0x00, 0x00, 0x00, 0x04, 0x08, 0x00, 0x73, 0x73, 0x73, 0x73, 0x3e, 0x00,
+  0x00, 0x00, 0x08, 0x14, 0x00, 0x73, 0x73, 0x73, 0x73, 0x3e, 0x00, 0x00,
+  0x00, 0x00, 0x36, 0x00, 0x73, 0x73, 0x73, 0x73, 0x3e, 0x00, 0x00, 0x00,
+  0x04, 0x08, 0x00, 0x73, 0x73, 0x7f, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00,
+  0x00, 0x30, 0x1c, 0x12, 0x12, 0x12, 0x1c, 0x10, 0x38, 0x00, 0x00, 0x73,
+  0x00, 0x73, 0x73, 0x7f, 0x1c, 0x1c, 0x1c, 0x00
+};
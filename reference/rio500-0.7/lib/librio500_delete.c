@@ -0,0 +1,172 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Batch delete.
+
+   Deleting a song used to mean reading both tables, releasing the song,
+   writing the song table, writing the folder table and telling the Rio
+   where it is; deleting a folder did that once for every song in it.
+   Here all the songs (or folders) are released first, with the numbers
+   they have in the tables the Rio still has, and the new tables are
+   written once at the end.
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+
+/* Sort descending and drop the duplicates and the ones out of range.
+   Returns how many are left. */
+static int
+delete_sort (int *nums, int count, int limit)
+{
+  int i, j, n, tmp;
+
+  for (i = 1; i < count; i++)
+    for (j = i; j > 0 && nums[j - 1] < nums[j]; j--)
+    {
+      tmp = nums[j];
+      nums[j] = nums[j - 1];
+      nums[j - 1] = tmp;
+    }
+
+  for (i = n = 0; i < count; i++)
+  {
+    if (nums[i] < 0 || nums[i] >= limit)
+      continue;
+    if (n > 0 && nums[n - 1] == nums[i])
+      continue;
+    nums[n++] = nums[i];
+  }
+
+  return n;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_delete_songs
+   DESCRIPTION: Delete count songs of folder folder_num. folders and
+                songs are the tables as the Rio has them now; they are
+                updated to match. song_nums is sorted in place. Returns
+                the number of songs deleted, or -1.
+   ------------------------------------------------------------------- */
+
+int
+rio_delete_songs (rio_device rio_dev, rio_table *folders, rio_table *songs,
+                  int folder_num, int *song_nums, int count, int card)
+{
+  return rio_delete_songs_keeping (rio_dev, folders, songs, folder_num,
+                                   song_nums, count, NULL, NULL, card);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_delete_songs_keeping
+   DESCRIPTION: Same, but asks keep (if not NULL) about each song just
+                before it goes; if keep returns TRUE the entry is
+                dropped without releasing the audio, because another
+                entry still points to it (see rio_copy_song_entries).
+   ------------------------------------------------------------------- */
+
+int
+rio_delete_songs_keeping (rio_device rio_dev, rio_table *folders, rio_table *songs,
+                          int folder_num, int *song_nums, int count,
+                          rio_keep_func keep, void *data, int card)
+{
+  folder_entry *folder;
+  int           i, n, location;
+
+  if (folders == NULL || songs == NULL
+      || folder_num < 0 || folder_num >= folders->count)
+    return -1;
+
+  n = delete_sort (song_nums, count, songs->count);
+  if (n == 0)
+    return 0;
+
+  /* Highest first, so the table numbers stay right as we go */
+  for (i = 0; i < n; i++)
+  {
+    if (keep == NULL || !(*keep) (folder_num, song_nums[i], data))
+      send_command (rio_dev, 0x4c, ((folder_num << 8) | song_nums[i]), card);
+    rio_table_remove (songs, song_nums[i]);
+  }
+
+  /* Write song block to the correct folder */
+  rio_write_song_table (rio_dev, folder_num, songs, card);
+
+  /* Now write the folder block again */
+  folder = rio_table_folder (folders, folder_num);
+  folder->offset = rio_last_write (rio_dev);
+  folder->fst_free_entry_off = songs->count * RIO_ENTRY_SIZE;
+
+  rio_write_folder_table (rio_dev, folders, card);
+  location = rio_last_write (rio_dev);
+
+  /* Tell Rio where the root folder block is. */
+  send_folder_location (rio_dev, location, folder_num, card);
+
+  /* Not really sure what this does */
+  send_command (rio_dev, 0x58, 0x0, card);
+
+  return n;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_delete_folders
+   DESCRIPTION: Delete count folders and every song in them. folders is
+                updated to match; folder_nums is sorted in place.
+                Returns the number of folders deleted, or -1.
+   ------------------------------------------------------------------- */
+
+int
+rio_delete_folders (rio_device rio_dev, rio_table *folders,
+                    int *folder_nums, int count, int card)
+{
+  int i, n, song_num, location;
+
+  if (folders == NULL)
+    return -1;
+
+  n = delete_sort (folder_nums, count, folders->count);
+  if (n == 0)
+    return 0;
+
+  for (i = 0; i < n; i++)
+  {
+    /* The songs, then the folder's song block */
+    song_num = rio_table_folder (folders, folder_nums[i])->fst_free_entry_off / RIO_ENTRY_SIZE;
+    while (--song_num >= 0)
+      send_command (rio_dev, 0x4c, ((folder_nums[i] << 8) | song_num), card);
+    send_command (rio_dev, 0x4c, ((folder_nums[i] << 8) | 0xff), card);
+
+    rio_table_remove (folders, folder_nums[i]);
+  }
+
+  rio_write_folder_table (rio_dev, folders, card);
+  location = rio_last_write (rio_dev);
+
+  /* Tell Rio where the root folder block is. */
+  send_folder_location (rio_dev, location, 0, card);
+
+  /* Not really sure what this does */
+  send_command (rio_dev, 0x58, 0x0, card);
+
+  return n;
+}
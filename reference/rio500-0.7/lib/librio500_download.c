@@ -0,0 +1,352 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Song download sessions.
+
+   The Rio has no command to read song data back. The trick (see
+   rio_get_song) is to point the first folder's song table offset at the
+   song, write the folder block and let the Rio "read the song table" of
+   folder 0, which hands us the song data instead. Afterwards the real
+   offset has to be put back or the Rio loses its folder information.
+
+   Doing that per song costs two folder block writes. A session keeps the
+   folder list around, repoints folder 0 once per song and only restores
+   the original folder block when the session ends.
+
+   A read can also cover just part of a song. There is no way to start
+   reading in the middle, so the bytes in front of the range are read
+   and thrown away, but the transfer stops at the end of the range.
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+
+
+/* Write the folder block and tell the Rio where it went */
+static void
+download_commit_folders (rio_download *dl)
+{
+  int folder_block_offset;
+
+  rio_write_folder_table (dl->rio_dev, dl->folders, dl->card);
+  send_command (dl->rio_dev, 0x42, 0, 0);
+  send_command (dl->rio_dev, 0x42, 0, 0);
+  folder_block_offset = send_command (dl->rio_dev, 0x43, 0x0, 0x0);
+
+#ifdef DEBUG
+  fprintf (stderr, "Folder block written to 0x%04x\n", folder_block_offset);
+#endif
+
+  /* Tell Rio where the root folder block is. */
+  send_folder_location (dl->rio_dev, folder_block_offset, dl->folder_num, dl->card);
+
+  /* Not really sure what this does */
+  send_command (dl->rio_dev, 0x58, 0x0, dl->card);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_download_begin_table
+   DESCRIPTION: Start a download session. folders is the folder table as
+                read from the Rio; it must stay alive until the session
+                has ended.
+   ------------------------------------------------------------------- */
+
+rio_download *
+rio_download_begin_table (rio_device rio_dev, rio_table *folders, int folder_num, int card)
+{
+  rio_download *dl;
+
+  if (folders == NULL || folders->count == 0)
+    return NULL;
+
+  dl = calloc (1, sizeof (rio_download));
+  if (dl == NULL)
+    return NULL;
+
+  dl->rio_dev    = rio_dev;
+  dl->card       = card;
+  dl->folder_num = folder_num;
+  dl->folders    = folders;
+  dl->root       = rio_table_folder (folders, 0);
+  dl->old_offset = dl->root->offset;
+  dl->repointed  = FALSE;
+
+  return dl;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_download_begin
+   DESCRIPTION: Same for a GList of folder entries. The session works on
+                its own copy of them.
+   ------------------------------------------------------------------- */
+
+rio_download *
+rio_download_begin (rio_device rio_dev, GList *folders, int folder_num, int card)
+{
+  rio_download *dl;
+  rio_table    *table;
+
+  table = rio_table_from_list (RIO_TABLE_FOLDERS, folders);
+  dl = rio_download_begin_table (rio_dev, table, folder_num, card);
+  if (dl == NULL)
+  {
+    rio_table_delete (table);
+    return NULL;
+  }
+  dl->own_folders = TRUE;
+
+  return dl;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_download_select
+   DESCRIPTION: Point the Rio at song. The next read of address 0xff
+                returns the song data.
+   ------------------------------------------------------------------- */
+
+int
+rio_download_select (rio_download *dl, song_entry *song)
+{
+  if (dl == NULL || song == NULL)
+    return -1;
+
+  dl->root->offset = song->offset;
+  dl->length       = song->length;
+  dl->repointed    = TRUE;
+  download_commit_folders (dl);
+
+  return 0;
+}
+
+/* Where a ranged read stands */
+typedef struct
+{
+  unsigned long  pos;             /* song offset of the next bulk read */
+  unsigned long  offset;          /* first byte wanted */
+  unsigned long  delivered;       /* bytes handed to the sink */
+} download_range;
+
+/* Read one bulk transfer straight into the next sink slot. Bytes before
+   the start of the range are read into the slot and dropped by simply
+   not committing them. Returns the number of bytes read off the Rio. */
+static int
+download_chunk (rio_download *dl, rio_sink *sink, download_range *range, int len)
+{
+  BYTE *p;
+  int   count, skip;
+
+  p = rio_sink_buffer (sink);
+  count = bulk_read (dl->rio_dev, p, len);
+  if (count <= 0)
+    return 0;
+
+  skip = 0;
+  if (range->pos < range->offset)
+    skip = (range->offset - range->pos < count) ? range->offset - range->pos : count;
+  range->pos += count;
+
+  if (skip < count)
+  {
+    if (skip > 0)
+      memmove (p, p + skip, count - skip);
+    rio_sink_commit (sink, count - skip);
+    range->delivered += count - skip;
+  }
+
+  return count;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_download_read_range
+   DESCRIPTION: Read len bytes of the selected song, starting offset
+                bytes in, into sink. Returns the number of bytes
+                transfered to the sink.
+   ------------------------------------------------------------------- */
+
+int
+rio_download_read_range (rio_download *dl, unsigned long offset,
+                         unsigned long len, rio_sink *sink)
+{
+  int  j, this_read, count;
+  int  num_blocks, remainder, blocks_left, num_chunks;
+  unsigned long  size;
+  download_range range;
+
+  if (dl == NULL || sink == NULL)
+    return -1;
+
+  /* The Rio only reads a song from its start, so the read goes up to
+     the end of the range and no further */
+  if (dl->length > 0)
+  {
+    if (offset >= dl->length)
+      return 0;
+    if (len > dl->length - offset)
+      len = dl->length - offset;
+  }
+  if (len == 0)
+    return 0;
+  size = offset + len;
+
+  range.pos       = 0;
+  range.offset    = offset;
+  range.delivered = 0;
+
+  /* Read 0x4000 bytes first */
+  this_read = (size > 0x4000) ? 0x4000 : size;
+  send_command (dl->rio_dev, 0x4e, 0xff, dl->card);
+  send_command (dl->rio_dev, 0x45, 0x0, this_read);
+
+  download_chunk (dl, sink, &range, this_read);
+  size -= this_read;
+  if (dl->progress)
+    (*dl->progress) (range.delivered, len);
+
+  if (size == 0)
+    return range.delivered;
+
+  num_blocks = size / 0x10000;
+  remainder  = size % 0x10000;
+
+  /* First read num_chunks, blocks at a time */
+  num_chunks = 0x10;
+  blocks_left = num_blocks - num_chunks;
+
+  while (blocks_left > 0)
+  {
+    send_command (dl->rio_dev, 0x45, num_chunks, 0x0);
+    for (j = 0; j < num_chunks / 2; j++)
+    {
+      count = download_chunk (dl, sink, &range, 0x20000);
+      if (count != 0x20000)
+        fprintf (stderr, "[Short read!]");
+      if (dl->progress)
+        (*dl->progress) (range.delivered, len);
+    }
+    blocks_left -= num_chunks;
+    // Send a 0x42.
+    send_command (dl->rio_dev, 0x42, 0, 0);
+    send_command (dl->rio_dev, 0x42, 0, 0);
+  }
+
+  /* Send remaining blocks */
+  blocks_left += num_chunks;
+  send_command (dl->rio_dev, 0x45, blocks_left, 0x0);
+  while (blocks_left > 0)
+  {
+    count = download_chunk (dl, sink, &range, 0x10000);
+    if (count != 0x10000)
+      fprintf (stderr, "[Short read!]");
+    if (dl->progress)
+      (*dl->progress) (range.delivered, len);
+    blocks_left--;
+    send_command (dl->rio_dev, 0x42, 0, 0);
+    send_command (dl->rio_dev, 0x42, 0, 0);
+  }
+
+  /* Read last block */
+  while (remainder > 0)
+  {
+    this_read = (remainder > 0x4000) ? 0x4000 : remainder;
+    send_command (dl->rio_dev, 0x45, 0x0, this_read);
+    download_chunk (dl, sink, &range, this_read);
+    remainder -= this_read;
+  }
+  if (dl->progress)
+    (*dl->progress) (range.delivered, len);
+
+  return range.delivered;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_download_read
+   DESCRIPTION: Read size bytes of the selected song into sink. Returns
+                the number of bytes transfered.
+   ------------------------------------------------------------------- */
+
+int
+rio_download_read (rio_download *dl, unsigned long size, rio_sink *sink)
+{
+  return rio_download_read_range (dl, 0, size, sink);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_read_song_range
+   DESCRIPTION: Read len bytes of song song_num of folder folder_num,
+                starting offset bytes in, into sink. One download session
+                from start to end; the folder block is restored before
+                returning. Returns the number of bytes read or -1.
+   ------------------------------------------------------------------- */
+
+int
+rio_read_song_range (rio_device rio_dev, GList *folders, int folder_num,
+                     int song_num, unsigned long offset, unsigned long len,
+                     int card, rio_sink *sink)
+{
+  rio_download *dl;
+  GList        *songs;
+  song_entry   *song;
+  GList        *item;
+  int           total;
+
+  songs = read_song_entries (rio_dev, folders, folder_num, card);
+  song = (song_entry *) g_list_nth_data (songs, song_num);
+
+  total = -1;
+  dl = (song != NULL) ? rio_download_begin (rio_dev, folders, folder_num, card) : NULL;
+  if (dl != NULL)
+  {
+    rio_download_select (dl, song);
+    total = rio_download_read_range (dl, offset, len, sink);
+    rio_download_end (dl);
+  }
+
+  for (item = g_list_first (songs); item; item = item->next)
+    free (item->data);
+  g_list_free (songs);
+
+  return total;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_download_end
+   DESCRIPTION: Restore the folder block if it was touched and free the
+                session.
+   ------------------------------------------------------------------- */
+
+int
+rio_download_end (rio_download *dl)
+{
+  if (dl == NULL)
+    return -1;
+
+  if (dl->repointed)
+  {
+    dl->root->offset = dl->old_offset;
+    download_commit_folders (dl);
+  }
+
+  if (dl->own_folders)
+    rio_table_delete (dl->folders);
+  free (dl);
+  return 0;
+}
@@ -0,0 +1,447 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Font cache.
+
+   bitmap_data_new used to open and parse the .fon file (or the .psf one
+   it falls back to) for every song and folder entry it made, so adding
+   200 songs parsed the same font 200 times. Fonts are now loaded once
+   per process, keyed by path and font number, and kept until
+   rio_font_flush. A font that can't be loaded is remembered too, so a
+   missing file isn't looked for again on every title.
+
+   rio_font_get hands out a reference; give it back with rio_font_put.
+   Fonts nobody holds stay cached, so a caller that knows its font can
+   rio_font_preload it before a batch and rendering is then only CPU work.
+
+   Whatever the file was, a loaded font is kept as a glyph table: the
+   height, and for each of the 256 character codes a width (at most 8
+   pixels) and one byte per row. The same table, written out, is a glyph
+   pack (rio_font_pack); the fonts in fonts/ are converted to packs when
+   they are built, and the default one is compiled in
+   (librio500_deffont.c), so titles in the default font need no file at
+   all. A glyph pack is
+
+     0    "RGP1"
+     4    height, 1 to 16
+     5    3 bytes, zero
+     8    256 widths
+     264  256 * height rows, character after character
+*/
+
+#include "librio500.h"
+#include "libpsf.h"
+#include "libfon.h"
+
+#include <string.h>
+
+#define GLYPH_MAGIC                 "RGP1"
+#define GLYPH_HEADER                8
+#define GLYPH_CODES                 256
+#define GLYPH_MAX_HEIGHT            16
+#define GLYPH_PACK_SIZE(height)     (GLYPH_HEADER + GLYPH_CODES + GLYPH_CODES * (height))
+
+/* The title bitmap: 96 blocks of 16 rows of 8 pixels */
+#define TITLE_BLOCKS                96
+#define TITLE_BLOCK_SIZE            16
+
+struct _rio_font
+{
+  char            *path;
+  int              number;
+  int              refs;
+  int              height;        /* 0 if the file couldn't be loaded */
+  BYTE             widths[GLYPH_CODES];
+  const BYTE      *bits;
+  BYTE            *own_bits;      /* bits, unless they are static */
+  struct _rio_font *next;
+};
+
+/* librio500_deffont.c */
+extern const char rio_default_font_name[];
+extern const BYTE rio_default_font_pack[];
+extern const int  rio_default_font_pack_size;
+
+static rio_font *fonts = NULL;
+static rio_font  builtin;
+
+
+static rio_font *
+font_find (char *path, int number)
+{
+  rio_font *font;
+
+  for (font = fonts; font; font = font->next)
+    if (font->number == number && strcmp (font->path, path) == 0)
+      return font;
+
+  return NULL;
+}
+
+static BYTE *
+font_alloc_bits (rio_font *font, int height)
+{
+  font->height   = height;
+  font->own_bits = calloc (GLYPH_CODES, height);
+  font->bits     = font->own_bits;
+  return font->own_bits;
+}
+
+/* A glyph pack in memory. The rows are used where they are if copy is
+   FALSE. */
+static int
+font_from_pack (rio_font *font, const BYTE *pack, int size, int copy)
+{
+  int height;
+
+  if (size < GLYPH_HEADER || memcmp (pack, GLYPH_MAGIC, 4) != 0)
+    return -1;
+  height = pack[4];
+  if (height < 1 || height > GLYPH_MAX_HEIGHT || size < GLYPH_PACK_SIZE (height))
+    return -1;
+
+  memcpy (font->widths, pack + GLYPH_HEADER, GLYPH_CODES);
+  if (!copy)
+  {
+    font->height = height;
+    font->bits   = pack + GLYPH_HEADER + GLYPH_CODES;
+  }
+  else if (font_alloc_bits (font, height) != NULL)
+    memcpy (font->own_bits, pack + GLYPH_HEADER + GLYPH_CODES, GLYPH_CODES * height);
+  else
+    return -1;
+
+  return 0;
+}
+
+static int
+font_from_psf (rio_font *font, psf_font *psf)
+{
+  int c;
+
+  if (psf->data == NULL || psf->height < 1 || psf->height > GLYPH_MAX_HEIGHT
+      || font_alloc_bits (font, psf->height) == NULL)
+    return -1;
+
+  for (c = 0; c < GLYPH_CODES; c++)
+    font->widths[c] = 8;
+  memcpy (font->own_bits, psf->data, GLYPH_CODES * psf->height);
+
+  return 0;
+}
+
+/* Where a Windows 2.0 font keeps code c; FALSE if it doesn't */
+static int
+font_fon_glyph (struct fon_font *fon, int c, int *width, const BYTE **bits)
+{
+  struct Font_header *header = &fon->Header[fon->font_number];
+  struct Win_charmap *charmap = &fon->Charmap[fon->font_number];
+  struct Win_bitmap  *bitmap = &fon->Bitmap[fon->font_number];
+  long                entry, offset;
+
+  if (c < header->Initial_char_code || c > header->Last_char_code)
+    return FALSE;
+
+  entry = (c - header->Initial_char_code) * 4;
+  if (entry + 4 > charmap->length)
+    return FALSE;
+  offset = charmap->data[entry + 3] * 256 + charmap->data[entry + 2]
+           - charmap->First_bitmap_offset;
+  if (offset < 0 || offset + header->Bytes_per_char_cell > bitmap->length)
+    return FALSE;
+
+  /* As fon_get_char_width has it */
+  *width = charmap->data[entry];
+  if (*width > 8)
+    *width = 8;
+  *bits = bitmap->data + offset;
+
+  return TRUE;
+}
+
+static int
+font_from_fon (rio_font *font, struct fon_font *fon)
+{
+  struct Font_header *header;
+  const BYTE         *bits;
+  int                 c, width, height, fallback;
+
+  if (fon->font_number < 0 || fon->font_number >= fon->number_of_fonts)
+    return -1;
+  header = &fon->Header[fon->font_number];
+  if (header->Windows_version != 0x200)
+    return -1;
+  height = header->Bytes_per_char_cell;
+  if (height < 1 || height > GLYPH_MAX_HEIGHT
+      || font_alloc_bits (font, height) == NULL)
+    return -1;
+
+  /* Codes the font doesn't have get its default character */
+  fallback = header->Initial_char_code + header->Default_char_code;
+  for (c = 0; c < GLYPH_CODES; c++)
+  {
+    if (font_fon_glyph (fon, c, &width, &bits)
+        || font_fon_glyph (fon, fallback, &width, &bits))
+    {
+      font->widths[c] = width;
+      memcpy (font->own_bits + c * height, bits, height);
+    }
+  }
+
+  return 0;
+}
+
+static int
+font_read_pack (rio_font *font, char *path)
+{
+  BYTE  pack[GLYPH_PACK_SIZE (GLYPH_MAX_HEIGHT)];
+  FILE *fp;
+  int   size;
+
+  fp = fopen (path, "rb");
+  if (fp == NULL)
+    return -1;
+  size = fread (pack, 1, sizeof (pack), fp);
+  fclose (fp);
+
+  return font_from_pack (font, pack, size, TRUE);
+}
+
+static rio_font *
+font_load (char *path, int number)
+{
+  struct fon_font *fon;
+  psf_font        *psf;
+  rio_font        *font;
+  int              status = -1;
+
+  font = calloc (1, sizeof (rio_font));
+  if (font == NULL)
+    return NULL;
+  font->path = strdup (path);
+  if (font->path == NULL)
+  {
+    free (font);
+    return NULL;
+  }
+  font->number = number;
+
+  /* A pack, or .psf: fon_load_font complains about anything else */
+  if (font_read_pack (font, path) == 0)
+    status = 0;
+  else if ((psf = psf_load_font (path)) != NULL)
+  {
+    status = font_from_psf (font, psf);
+    psf_delete_font (psf);
+    free (psf);
+  }
+  else if ((fon = fon_load_font (path)) != NULL)
+  {
+    fon->font_number = number;
+    status = font_from_fon (font, fon);
+    fon_delete_font (fon);
+  }
+  if (status == -1)
+  {
+    free (font->own_bits);
+    font->own_bits = NULL;
+    font->height = 0;
+  }
+
+  font->next = fonts;
+  fonts = font;
+
+  return font;
+}
+
+/* Is path the default font, which is compiled in? */
+static int
+font_is_default (char *path, int number)
+{
+  int len = strlen (DEFAULT_FONT_PATH);
+
+  return (number == 0 && strncmp (path, DEFAULT_FONT_PATH, len) == 0
+          && strcmp (path + len, rio_default_font_name) == 0);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_font_builtin
+   DESCRIPTION: The default font, from the table compiled into the
+                library. Needs no rio_font_put (but takes one).
+   ------------------------------------------------------------------- */
+
+rio_font *
+rio_font_builtin (void)
+{
+  if (builtin.height == 0
+      && font_from_pack (&builtin, rio_default_font_pack,
+                         rio_default_font_pack_size, FALSE) == -1)
+    return NULL;
+
+  builtin.refs++;
+  return &builtin;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_font_get
+   DESCRIPTION: Font font_number of the file path, which is a glyph
+                pack, a .psf font (which has only the one) or a .fon
+                file, loaded the first time it is asked for. The
+                default font comes from the library and the file isn't
+                read. NULL if it can't be loaded. Give it back with
+                rio_font_put.
+   ------------------------------------------------------------------- */
+
+rio_font *
+rio_font_get (char *path, int font_number)
+{
+  rio_font *font;
+
+  if (path == NULL)
+    return NULL;
+  if (font_is_default (path, font_number))
+    return rio_font_builtin ();
+
+  font = font_find (path, font_number);
+  if (font == NULL)
+    font = font_load (path, font_number);
+  if (font == NULL || font->height == 0)
+    return NULL;
+
+  font->refs++;
+  return font;
+}
+
+void
+rio_font_put (rio_font *font)
+{
+  if (font && font->refs > 0)
+    font->refs--;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_font_preload
+   DESCRIPTION: Load a font into the cache ahead of time. Returns 0, or
+                -1 if it can't be loaded.
+   ------------------------------------------------------------------- */
+
+int
+rio_font_preload (char *path, int font_number)
+{
+  rio_font *font;
+
+  font = rio_font_get (path, font_number);
+  if (font == NULL)
+    return -1;
+  rio_font_put (font);
+
+  return 0;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_font_flush
+   DESCRIPTION: Free the cached fonts nobody holds, and forget the ones
+                that couldn't be loaded so they are looked for again.
+   ------------------------------------------------------------------- */
+
+void
+rio_font_flush (void)
+{
+  rio_font **link, *font;
+
+  link = &fonts;
+  while ((font = *link) != NULL)
+  {
+    if (font->refs > 0)
+    {
+      link = &font->next;
+      continue;
+    }
+    *link = font->next;
+    free (font->own_bits);
+    free (font->path);
+    free (font);
+  }
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_font_write_string
+   DESCRIPTION: Render string into the bitmap dst, as fon_write_string
+                does. Returns what goes into the bitmap's num_blocks.
+   ------------------------------------------------------------------- */
+
+int
+rio_font_write_string (rio_font *font, char *string, BYTE *dst)
+{
+  const BYTE *bits;
+  BYTE       *p;
+  int         i, j, len, skip, x, xmod, w, block;
+
+  skip = (TITLE_BLOCK_SIZE - font->height) >> 1;
+
+  memset (dst, 0, TITLE_BLOCKS * TITLE_BLOCK_SIZE);
+  len = strlen (string);
+  for (i = x = 0; i < len; i++)
+  {
+    w     = font->widths[(BYTE) string[i]];
+    bits  = font->bits + (BYTE) string[i] * font->height;
+    block = x / 8;
+    xmod  = x % 8;
+    p     = &dst[TITLE_BLOCK_SIZE * block];
+    for (j = 0; j < font->height; j++)
+    {
+      p[skip + j] |= bits[j] >> xmod;
+      if (xmod + w > 8 && block + 1 < TITLE_BLOCKS)
+        p[skip + j + TITLE_BLOCK_SIZE] |= bits[j] << (8 - xmod);
+    }
+
+    x += w;
+    /* The name cannot exceed 96x8 pixels */
+    if ((x / 8) > TITLE_BLOCKS - 1)
+      break;
+  }
+
+  return i;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_font_pack
+   DESCRIPTION: The font as a glyph pack, in a buffer the caller frees.
+                Returns its size, or -1.
+   ------------------------------------------------------------------- */
+
+int
+rio_font_pack (rio_font *font, BYTE **pack)
+{
+  int size;
+
+  size = GLYPH_PACK_SIZE (font->height);
+  *pack = calloc (size, 1);
+  if (*pack == NULL)
+    return -1;
+
+  memcpy (*pack, GLYPH_MAGIC, 4);
+  (*pack)[4] = font->height;
+  memcpy (*pack + GLYPH_HEADER, font->widths, GLYPH_CODES);
+  memcpy (*pack + GLYPH_HEADER + GLYPH_CODES, font->bits, GLYPH_CODES * font->height);
+
+  return size;
+}
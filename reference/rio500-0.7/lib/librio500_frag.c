@@ -0,0 +1,392 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Flash fragmentation.
+
+   The Rio hands out flash from its first free block on. After a lot of
+   adding and deleting the free blocks are scattered between the songs
+   that are left, and uploads get slow. The Rio only tells us how many
+   blocks are unused and where the first one is (0x57), so the map is
+   put together from the tables: every song covers the blocks from its
+   offset for its length, every song table the blocks its entries need.
+   Blocks under the first free block that nothing in the tables covers
+   are in use by something else (the folder table, for one); above it
+   they are taken to be free.
+
+   Compaction takes every song that starts past the first free block
+   into host memory (one download session), releases it, and sends it
+   up again in table order, so the songs fill the space from the first
+   free block on and what is left free is in one piece. Nothing is
+   released until every song has been read back and is ready to go up
+   again; a song that still fails to go up loses its entries. Then each song table
+   that changed is written once and the folder table once, however many
+   songs moved. Songs that share their audio (see rio_copy_song_entries)
+   move once and every entry follows.
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+#include <unistd.h>
+
+typedef struct
+{
+  WORD             old_offset;
+  DWORD            length;
+  unsigned long    pos;           /* where it is kept on the host */
+  int              folder;        /* the entry it is read and released by */
+  int              song;
+  int              lost;          /* released but not written back */
+  WORD             new_offset;
+} frag_move;
+
+
+/* Blocks len bytes take up */
+static DWORD
+frag_blocks (rio_frag *frag, unsigned long len)
+{
+  return (len + frag->block_size - 1) / frag->block_size;
+}
+
+/* Mark the blocks from first on as used by what */
+static DWORD
+frag_mark (rio_frag *frag, DWORD first, DWORD count, int what)
+{
+  DWORD b, marked = 0;
+
+  for (b = first; b < first + count && b < frag->num_blocks; b++)
+    if (frag->map[b] == RIO_BLOCK_FREE)
+    {
+      frag->map[b] = what;
+      marked++;
+    }
+  return marked;
+}
+
+/* The move of the song at old_offset, or NULL */
+static frag_move *
+frag_find (frag_move *moves, int count, WORD old_offset)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    if (moves[i].old_offset == old_offset)
+      return &moves[i];
+  return NULL;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_frag_analyze
+   DESCRIPTION: Put together the block map of card from its tables
+                (songs[f] is the song table of folder f) and the memory
+                status. NULL if the Rio reports no blocks.
+   ------------------------------------------------------------------- */
+
+rio_frag *
+rio_frag_analyze (rio_device rio_dev, rio_table *folders, rio_table **songs, int card)
+{
+  rio_frag     *frag;
+  mem_status   *mem;
+  folder_entry *folder;
+  song_entry   *song;
+  DWORD         b, run;
+  int           f, s;
+
+  mem = get_mem_status (rio_dev, card);
+  if (mem->block_size == 0 || mem->num_blocks == 0)
+    return NULL;
+
+  frag = calloc (1, sizeof (rio_frag));
+  if (frag == NULL)
+    return NULL;
+  frag->map = calloc (mem->num_blocks, 1);
+  if (frag->map == NULL)
+  {
+    free (frag);
+    return NULL;
+  }
+
+  frag->card              = card;
+  frag->block_size        = mem->block_size;
+  frag->num_blocks        = mem->num_blocks;
+  frag->first_free_block  = mem->first_free_block;
+  frag->num_unused_blocks = mem->num_unused_blocks;
+
+  /* What the tables say */
+  for (f = 0; folders != NULL && f < folders->count; f++)
+  {
+    folder = rio_table_folder (folders, f);
+    if (songs[f] == NULL || songs[f]->count == 0)
+      continue;
+    frag->table_blocks += frag_mark (frag, folder->offset,
+                                     frag_blocks (frag, songs[f]->count * RIO_ENTRY_SIZE),
+                                     RIO_BLOCK_TABLE);
+    for (s = 0; s < songs[f]->count; s++)
+    {
+      song = rio_table_song (songs[f], s);
+      frag->song_blocks += frag_mark (frag, song->offset,
+                                      frag_blocks (frag, song->length),
+                                      RIO_BLOCK_SONG);
+    }
+  }
+
+  /* The rest is used below the first free block, free above it */
+  frag->first_hole = -1;
+  for (b = 0; b < frag->num_blocks; b++)
+  {
+    if (frag->map[b] != RIO_BLOCK_FREE)
+      continue;
+    if (b < frag->first_free_block)
+    {
+      frag->map[b] = RIO_BLOCK_OTHER;
+      frag->other_blocks++;
+    }
+    else if (frag->first_hole == -1)
+      frag->first_hole = b;
+  }
+
+  for (b = run = 0; b <= frag->num_blocks; b++)
+  {
+    if (b < frag->num_blocks && frag->map[b] == RIO_BLOCK_FREE)
+    {
+      run++;
+      continue;
+    }
+    if (run > 0)
+    {
+      frag->free_runs++;
+      if (run > frag->largest_run)
+        frag->largest_run = run;
+    }
+    run = 0;
+  }
+
+  /* What compaction would have to move */
+  for (f = 0; frag->first_hole >= 0 && folders != NULL && f < folders->count; f++)
+    for (s = 0; songs[f] != NULL && s < songs[f]->count; s++)
+    {
+      song = rio_table_song (songs[f], s);
+      if (song->offset > frag->first_hole && song->length > 0)
+      {
+        frag->movable++;
+        frag->movable_bytes += song->length;
+      }
+    }
+
+  return frag;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_frag_delete
+   DESCRIPTION: Free a block map.
+   ------------------------------------------------------------------- */
+
+void
+rio_frag_delete (rio_frag *frag)
+{
+  if (frag == NULL)
+    return;
+  free (frag->map);
+  free (frag);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_frag_compact
+   DESCRIPTION: Move every song that starts past the first free block
+                of frag down, as described above. folders and songs are
+                the tables frag was made from; they are updated and
+                written. Progress goes to log if it isn't NULL. Returns
+                the number of songs moved, or -1 (the Rio is untouched
+                if a song can't be read back; a song that can't be
+                written back again is taken out of the tables).
+   ------------------------------------------------------------------- */
+
+int
+rio_frag_compact (rio_device rio_dev, rio_table *folders, rio_table **songs,
+                  rio_frag *frag, int card, FILE *log)
+{
+  frag_move    *moves, *move;
+  folder_entry *folder;
+  song_entry   *song;
+  rio_download *dl;
+  rio_sink     *sink;
+  rio_reader   *reader;
+  FILE         *scratch;
+  unsigned long pos;
+  int           f, s, i, n, total, last, location, status;
+
+  if (frag == NULL || folders == NULL || frag->first_hole < 0)
+    return 0;
+
+  /* The songs to move, each shared one once, in table order */
+  total = 0;
+  for (f = 0; f < folders->count; f++)
+    if (songs[f] != NULL)
+      total += songs[f]->count;
+  moves = calloc (total + 1, sizeof (frag_move));
+  if (moves == NULL)
+    return -1;
+
+  n = 0;
+  pos = 0;
+  for (f = 0; f < folders->count; f++)
+    for (s = 0; songs[f] != NULL && s < songs[f]->count; s++)
+    {
+      song = rio_table_song (songs[f], s);
+      if (song->offset <= frag->first_hole || song->length == 0
+          || frag_find (moves, n, song->offset) != NULL)
+        continue;
+      moves[n].old_offset = song->offset;
+      moves[n].length     = song->length;
+      moves[n].pos        = pos;
+      moves[n].folder     = f;
+      moves[n].song       = s;
+      pos += song->length;
+      n++;
+    }
+  if (n == 0)
+  {
+    free (moves);
+    return 0;
+  }
+
+  /* Everything to the host first */
+  scratch = tmpfile ();
+  dl = (scratch != NULL) ? rio_download_begin_table (rio_dev, folders, 0, card) : NULL;
+  status = (dl != NULL) ? 0 : -1;
+  for (i = 0; i < n && status == 0; i++)
+  {
+    song = rio_table_song (songs[moves[i].folder], moves[i].song);
+    if (log)
+    {
+      fprintf (log, "Reading %s\n", song->name1);
+      fflush (log);
+    }
+    sink = rio_sink_open_fd (fileno (scratch), moves[i].pos, moves[i].length,
+                             RIO_SYNC_NONE, NULL);
+    if (sink == NULL)
+    {
+      status = -1;
+      break;
+    }
+    rio_download_select (dl, song);
+    total = rio_download_read (dl, moves[i].length, sink);
+    if (rio_sink_close (sink) == -1 || total != moves[i].length)
+      status = -1;
+  }
+  if (dl != NULL)
+    rio_download_end (dl);
+
+  /* The songs lie back to back in scratch in the order they go up
+     again, so one reader over all of them feeds every upload. It has
+     to be there before any song is let go. */
+  reader = (status == 0) ? rio_reader_new (fileno (scratch), 0, pos, NULL) : NULL;
+  if (reader == NULL)
+  {
+    if (log)
+      fprintf (log, "Could not read every song back; nothing was moved.\n");
+    if (scratch != NULL)
+      fclose (scratch);
+    free (moves);
+    return -1;
+  }
+
+  /* Let go of them, highest song number of each folder first */
+  for (f = folders->count - 1; f >= 0; f--)
+    for (s = (songs[f] != NULL) ? songs[f]->count - 1 : -1; s >= 0; s--)
+    {
+      move = frag_find (moves, n, rio_table_song (songs[f], s)->offset);
+      if (move != NULL && move->folder == f && move->song == s)
+        send_command (rio_dev, 0x4c, ((f << 8) | s), card);
+    }
+
+  /* And up again in table order, into the space that was freed */
+  for (i = 0; i < n; i++)
+  {
+    if (log)
+    {
+      fprintf (log, "Writing %s\n", rio_table_song (songs[moves[i].folder], moves[i].song)->name1);
+      fflush (log);
+    }
+    location = rio_upload_song (rio_dev, reader, moves[i].length, card, NULL);
+    if (location == -1)
+    {
+      moves[i].lost = TRUE;
+      status = -1;
+      continue;
+    }
+    moves[i].new_offset = location;
+  }
+  rio_reader_delete (reader);
+  fclose (scratch);
+
+  /* Every entry follows its song, and the entries of a song that is
+     gone go too (highest first, so the numbers stay right); each song
+     table once, then the folder table once */
+  for (f = 0; f < folders->count; f++)
+    for (s = (songs[f] != NULL) ? songs[f]->count - 1 : -1; s >= 0; s--)
+    {
+      song = rio_table_song (songs[f], s);
+      move = frag_find (moves, n, song->offset);
+      if (move == NULL)
+        continue;
+      if (move->lost)
+      {
+        if (log)
+          fprintf (log, "Could not write %s back, left out\n", song->name1);
+        rio_table_remove (songs[f], s);
+        continue;
+      }
+      song->offset = move->new_offset;
+      rio_table_touch (songs[f], s);
+    }
+
+  last = 0;
+  for (f = 0; f < folders->count; f++)
+  {
+    if (songs[f] == NULL || !rio_flush_song_table (rio_dev, f, songs[f], card))
+      continue;
+    send_command (rio_dev, 0x42, 0, 0);
+    send_command (rio_dev, 0x42, 0, 0);
+    folder = rio_table_folder (folders, f);
+    folder->offset = send_command (rio_dev, 0x43, 0x0, 0x0);
+    folder->fst_free_entry_off = songs[f]->count * RIO_ENTRY_SIZE;
+    rio_table_touch (folders, f);
+    last = f;
+  }
+
+  if (rio_flush_folder_table (rio_dev, folders, card))
+  {
+    send_command (rio_dev, 0x42, 0, 0);
+    send_command (rio_dev, 0x42, 0, 0);
+    location = send_command (rio_dev, 0x43, 0x0, 0x0);
+
+    /* Tell Rio where the root folder block is. */
+    send_folder_location (rio_dev, location, last, card);
+
+    /* Not really sure what this does */
+    send_command (rio_dev, 0x58, 0x0, card);
+  }
+
+  free (moves);
+
+  return (status == 0) ? n : -1;
+}
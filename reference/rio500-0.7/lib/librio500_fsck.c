@@ -0,0 +1,429 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Table checker.
+
+   An interrupted transfer can leave a folder pointing at an old song
+   table, a first free entry offset that doesn't match the entries, or
+   entries nothing points at any more. rio_fsck reads the folder table
+   and every song table once, each straight into a view (no unpacking),
+   keeps them, and checks:
+
+     - first free entry offsets that aren't a whole number of entries,
+       or that count more entries than there are before the 0xffff
+       terminator, or fewer
+     - entries after the terminator
+     - song offsets outside the card, or running off its end
+     - songs that overlap each other or a song table (two entries with
+       the same offset and length share their audio, which is fine)
+     - blocks the Rio counts as used that no table reaches
+
+   Repair only ever drops what the Rio can't use anyway: entries after
+   the terminator or past the count, songs off the card, and of two
+   overlapping songs the older one (the blocks were handed out again
+   after it, so its audio is gone). Each song table that changes is
+   written once, then the folder table once. Unreachable blocks are only
+   reported; there is no command to free blocks no entry points at.
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+#include <stdarg.h>
+
+#define FSCK_ENTRIES(blocks)        ((blocks) * (FOLDER_BLOCK_SIZE / RIO_ENTRY_SIZE))
+
+typedef struct
+{
+  rio_view        *songs;         /* NULL if it couldn't be read */
+  int              claimed;       /* entries fst_free_entry_off counts */
+  int              valid;         /* entries before the terminator */
+  int              keep;          /* entries the Rio plays */
+  BYTE            *drop;          /* per entry, left out on repair */
+  int              rewrite;       /* song table has to be written again */
+  int              recount;       /* folder entry needs the right count */
+} fsck_folder;
+
+typedef struct
+{
+  DWORD            first;
+  DWORD            end;           /* one past the last block */
+  int              folder;
+  int              song;          /* -1 for the folder's song table */
+  DWORD            time;
+} fsck_extent;
+
+
+static void
+fsck_say (rio_fsck_report *report, FILE *log, const char *format, ...)
+{
+  va_list args;
+
+  report->problems++;
+  if (log == NULL)
+    return;
+  va_start (args, format);
+  vfprintf (log, format, args);
+  va_end (args);
+  fputc ('\n', log);
+}
+
+/* Slots before the first unused one, and whether any slot after it is
+   in use */
+static int
+fsck_count (const BYTE *blocks, int slots, int *stray)
+{
+  WORD offset;
+  int  i, valid = -1;
+
+  *stray = 0;
+  for (i = 0; i < slots; i++)
+  {
+    memcpy (&offset, blocks + i * RIO_ENTRY_SIZE, sizeof (WORD));
+    if (offset == 0xffff)
+    {
+      if (valid == -1)
+        valid = i;
+    }
+    else if (valid != -1)
+      (*stray)++;
+  }
+
+  return (valid == -1) ? slots : valid;
+}
+
+static int
+fsck_compare (const void *a, const void *b)
+{
+  const fsck_extent *x = (const fsck_extent *) a;
+  const fsck_extent *y = (const fsck_extent *) b;
+
+  if (x->first != y->first)
+    return (x->first < y->first) ? -1 : 1;
+  if (x->end != y->end)
+    return (x->end < y->end) ? -1 : 1;
+  return 0;
+}
+
+/* A table of the entries of blocks that are to stay, in host order */
+static rio_table *
+fsck_table (int type, const BYTE *blocks, int count, const BYTE *drop)
+{
+  rio_table *table;
+  BYTE       entry[RIO_ENTRY_SIZE];
+  int        i;
+
+  table = rio_table_new (type, count);
+  if (table == NULL)
+    return NULL;
+
+  for (i = 0; i < count; i++)
+  {
+    if (drop != NULL && drop[i])
+      continue;
+    memcpy (entry, blocks + i * RIO_ENTRY_SIZE, RIO_ENTRY_SIZE);
+    rio_codec_entries (type, entry, 1);
+    rio_table_append (table, entry);
+  }
+
+  return table;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_fsck
+   DESCRIPTION: Check the tables of card, and repair them if repair is
+                TRUE. What is found goes to log (if not NULL), one line
+                each, and is counted in report. Returns the number of
+                problems found, or -1 if the folder table can't be read.
+   ------------------------------------------------------------------- */
+
+int
+rio_fsck (rio_device rio_dev, int card, int repair, rio_fsck_report *report, FILE *log)
+{
+  rio_view      *folders;
+  fsck_folder   *ff;
+  fsck_extent   *extents, *owner, *loser, *other;
+  mem_status     mem;
+  rio_table     *table;
+  folder_entry  *folder;
+  const song_entry *song;
+  BYTE          *reached;
+  DWORD          num_blocks, used, b, length;
+  unsigned long  folder_blocks;
+  int            f, s, n, slots, stray, nf, location, changed, status = 0;
+
+  memset (report, 0, sizeof (rio_fsck_report));
+
+  /* get_mem_status hands back a static one */
+  mem = *get_mem_status (rio_dev, card);
+  num_blocks = mem.num_blocks;
+  used       = mem.num_blocks - mem.num_unused_blocks;
+  if (mem.block_size == 0)
+    return -1;
+
+  /* The folder table */
+  folder_blocks = get_num_folder_blocks (rio_dev, 0xff00, card);
+  if (folder_blocks == -1)
+    return -1;
+  folders = rio_read_folder_view (rio_dev, card);
+  if (folders == NULL)
+    return -1;
+
+  slots = FSCK_ENTRIES (folder_blocks);
+  nf = fsck_count (folders->blocks, slots, &stray);
+  changed = FALSE;
+  if (stray > 0)
+  {
+    fsck_say (report, log, "folder table: %d entries after the end", stray);
+    changed = TRUE;
+  }
+  report->folders = nf;
+
+  ff = calloc (nf + 1, sizeof (fsck_folder));
+  if (ff == NULL)
+  {
+    rio_view_delete (folders);
+    return -1;
+  }
+  folders->count = nf;
+
+  /* Every song table, once */
+  n = 0;
+  for (f = 0; f < nf; f++)
+  {
+    WORD used_off = RIO_LE16 (rio_view_folder (folders, f)->fst_free_entry_off);
+
+    ff[f].claimed = used_off / RIO_ENTRY_SIZE;
+    if (used_off % RIO_ENTRY_SIZE != 0)
+    {
+      fsck_say (report, log, "folder %d: first free entry offset 0x%04x is not a whole entry",
+                f, used_off);
+      ff[f].recount = TRUE;
+    }
+
+    ff[f].songs = rio_read_song_view (rio_dev, folders, f, card);
+    if (ff[f].songs == NULL)
+    {
+      fsck_say (report, log, "folder %d: song table can't be read", f);
+      continue;
+    }
+
+    slots = FSCK_ENTRIES ((used_off + FOLDER_BLOCK_SIZE - 1) / FOLDER_BLOCK_SIZE);
+    ff[f].valid = fsck_count (ff[f].songs->blocks, slots, &stray);
+    ff[f].keep  = ff[f].claimed < ff[f].valid ? ff[f].claimed : ff[f].valid;
+    ff[f].drop  = calloc (ff[f].keep + 1, 1);
+    if (ff[f].drop == NULL)
+    {
+      status = -1;
+      goto done;
+    }
+    n += ff[f].keep + 1;
+
+    if (stray > 0)
+    {
+      fsck_say (report, log, "folder %d: %d song entries after the end", f, stray);
+      ff[f].rewrite = TRUE;
+    }
+    if (ff[f].valid < ff[f].claimed)
+    {
+      fsck_say (report, log, "folder %d: counts %d songs, the table has %d",
+                f, ff[f].claimed, ff[f].valid);
+      ff[f].recount = TRUE;
+    }
+    else if (ff[f].valid > ff[f].claimed)
+    {
+      fsck_say (report, log, "folder %d: %d song entries past the count",
+                f, ff[f].valid - ff[f].claimed);
+      ff[f].rewrite = TRUE;
+    }
+    report->songs += ff[f].keep;
+  }
+
+  /* Where everything is */
+  extents = calloc (n + 1, sizeof (fsck_extent));
+  reached = calloc (num_blocks + 1, 1);
+  if (extents == NULL || reached == NULL)
+  {
+    free (extents);
+    free (reached);
+    status = -1;
+    goto done;
+  }
+
+  n = 0;
+  for (f = 0; f < nf; f++)
+  {
+    if (ff[f].songs == NULL)
+      continue;
+
+    if (ff[f].claimed > 0)
+    {
+      extents[n].first  = rio_folder_offset (rio_view_folder (folders, f));
+      extents[n].end    = extents[n].first
+                          + (ff[f].claimed * RIO_ENTRY_SIZE + mem.block_size - 1) / mem.block_size;
+      extents[n].folder = f;
+      extents[n].song   = -1;
+      if (extents[n].end > num_blocks)
+        fsck_say (report, log, "folder %d: song table at 0x%04lx is off the card",
+                  f, (unsigned long) extents[n].first);
+      else
+        n++;
+    }
+
+    for (s = 0; s < ff[f].keep; s++)
+    {
+      song   = rio_view_song (ff[f].songs, s);
+      length = rio_song_length (song);
+      extents[n].first  = rio_song_offset (song);
+      extents[n].end    = extents[n].first + (length + mem.block_size - 1) / mem.block_size;
+      extents[n].folder = f;
+      extents[n].song   = s;
+      extents[n].time   = rio_song_time (song);
+
+      if (extents[n].end > num_blocks || length == 0)
+      {
+        fsck_say (report, log, "folder %d song %d: offset 0x%04lx length %lu is off the card",
+                  f, s, (unsigned long) extents[n].first, (unsigned long) length);
+        ff[f].drop[s] = TRUE;
+        ff[f].rewrite = TRUE;
+        continue;
+      }
+      n++;
+    }
+  }
+
+  /* Overlaps, in one sweep over the extents sorted by where they start */
+  qsort (extents, n, sizeof (fsck_extent), fsck_compare);
+  owner = NULL;
+  for (s = 0; s < n; s++)
+  {
+    for (b = extents[s].first; b < extents[s].end && b < num_blocks; b++)
+      reached[b] = TRUE;
+
+    if (owner != NULL && extents[s].first < owner->end
+        && !(extents[s].first == owner->first && extents[s].end == owner->end
+             && owner->song >= 0 && extents[s].song >= 0))
+    {
+      /* A song table is what its folder points at now, so a song on
+         top of one loses; of two songs the older one does */
+      if (owner->song < 0 && extents[s].song < 0)
+        loser = NULL;
+      else if (owner->song < 0)
+        loser = &extents[s];
+      else if (extents[s].song < 0)
+        loser = owner;
+      else
+        loser = (extents[s].time < owner->time) ? &extents[s] : owner;
+      other = (loser == owner) ? &extents[s] : owner;
+
+      if (loser == NULL)
+        fsck_say (report, log, "folders %d and %d: song tables overlap at block 0x%04lx",
+                  owner->folder, extents[s].folder, (unsigned long) extents[s].first);
+      else if (other->song < 0)
+        fsck_say (report, log, "folder %d song %d: overlaps the song table of folder %d",
+                  loser->folder, loser->song, other->folder);
+      else
+        fsck_say (report, log, "folder %d song %d: overlaps newer folder %d song %d",
+                  loser->folder, loser->song, other->folder, other->song);
+
+      if (loser != NULL)
+      {
+        ff[loser->folder].drop[loser->song] = TRUE;
+        ff[loser->folder].rewrite = TRUE;
+      }
+    }
+
+    if (owner == NULL || extents[s].end > owner->end)
+      owner = &extents[s];
+  }
+
+  /* Used blocks nothing reaches; the folder table is somewhere too */
+  for (b = 0; b < num_blocks; b++)
+    if (reached[b])
+      report->reached++;
+  if (used > report->reached + folder_blocks)
+  {
+    report->unreachable = used - report->reached - folder_blocks;
+    fsck_say (report, log, "%lu blocks are in use but no table reaches them",
+              (unsigned long) report->unreachable);
+  }
+  free (extents);
+  free (reached);
+
+  if (!repair)
+    goto done;
+
+  /* Each song table that changes once, then the folder table once */
+  table = fsck_table (RIO_TABLE_FOLDERS, folders->blocks, nf, NULL);
+  if (table == NULL)
+    goto done;
+  for (f = 0; f < nf; f++)
+  {
+    folder = rio_table_folder (table, f);
+    if (ff[f].songs != NULL && ff[f].rewrite)
+    {
+      rio_table *songs = fsck_table (RIO_TABLE_SONGS, ff[f].songs->blocks, ff[f].keep, ff[f].drop);
+
+      if (songs == NULL)
+        continue;
+      rio_write_song_table (rio_dev, f, songs, card);
+      send_command (rio_dev, 0x42, 0, 0);
+      send_command (rio_dev, 0x42, 0, 0);
+      folder->offset = send_command (rio_dev, 0x43, 0x0, 0x0);
+      folder->fst_free_entry_off = songs->count * RIO_ENTRY_SIZE;
+      rio_table_delete (songs);
+      report->repaired++;
+      changed = TRUE;
+    }
+    else if (ff[f].songs != NULL && ff[f].recount)
+    {
+      folder->fst_free_entry_off = ff[f].keep * RIO_ENTRY_SIZE;
+      report->repaired++;
+      changed = TRUE;
+    }
+  }
+
+  if (changed)
+  {
+    rio_write_folder_table (rio_dev, table, card);
+    send_command (rio_dev, 0x42, 0, 0);
+    send_command (rio_dev, 0x42, 0, 0);
+    location = send_command (rio_dev, 0x43, 0x0, 0x0);
+
+    /* Tell Rio where the root folder block is. */
+    send_folder_location (rio_dev, location, 0, card);
+
+    /* Not really sure what this does */
+    send_command (rio_dev, 0x58, 0x0, card);
+  }
+  rio_table_delete (table);
+
+done:
+  for (f = 0; f < nf; f++)
+  {
+    rio_view_delete (ff[f].songs);
+    free (ff[f].drop);
+  }
+  free (ff);
+  rio_view_delete (folders);
+
+  return (status == -1) ? -1 : report->problems;
+}
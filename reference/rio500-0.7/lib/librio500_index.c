@@ -0,0 +1,227 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Name index.
+
+   Finding a folder or song by name used to mean a strcmp over every
+   entry, each fetched with g_list_nth. The index is built once from the
+   folder and song lists that were read anyway and maps name1 to where
+   the entry is (card, folder, song). Several entries can have the same
+   name; they are chained in table order.
+
+   The keys point into the entries themselves, so the lists must stay
+   alive as long as the index does.
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+#include <fnmatch.h>
+#include <regex.h>
+
+struct _rio_name_index
+{
+  GHashTable  *folders;
+  GHashTable  *songs;
+  GList       *folder_refs;       /* every ref, newest first */
+  GList       *song_refs;
+};
+
+
+static rio_name_ref *
+index_add (GHashTable *table, GList **refs, int card, int folder, int song,
+           char *name, void *entry)
+{
+  rio_name_ref *ref, *last;
+
+  ref = calloc (1, sizeof (rio_name_ref));
+  if (ref == NULL)
+    return NULL;
+  ref->card   = card;
+  ref->folder = folder;
+  ref->song   = song;
+  ref->name   = name;
+  ref->entry  = entry;
+
+  last = (rio_name_ref *) g_hash_table_lookup (table, name);
+  if (last == NULL)
+    g_hash_table_insert (table, name, ref);
+  else
+  {
+    while (last->next)
+      last = last->next;
+    last->next = ref;
+  }
+  *refs = g_list_prepend (*refs, ref);
+
+  return ref;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_name_index_new
+   DESCRIPTION: Create an empty name index.
+   ------------------------------------------------------------------- */
+
+rio_name_index *
+rio_name_index_new (void)
+{
+  rio_name_index *index;
+
+  index = calloc (1, sizeof (rio_name_index));
+  if (index == NULL)
+    return NULL;
+
+  index->folders = g_hash_table_new (g_str_hash, g_str_equal);
+  index->songs   = g_hash_table_new (g_str_hash, g_str_equal);
+
+  return index;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_name_index_add_folders
+   DESCRIPTION: Index the folders of a card.
+   ------------------------------------------------------------------- */
+
+void
+rio_name_index_add_folders (rio_name_index *index, int card, GList *folders)
+{
+  folder_entry *folder;
+  GList        *item;
+  int           f;
+
+  for (f = 0, item = g_list_first (folders); item; item = item->next, f++)
+  {
+    folder = (folder_entry *) item->data;
+    index_add (index->folders, &index->folder_refs, card, f, -1,
+               (char *) folder->name1, folder);
+  }
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_name_index_add_songs
+   DESCRIPTION: Index the songs of one folder.
+   ------------------------------------------------------------------- */
+
+void
+rio_name_index_add_songs (rio_name_index *index, int card, int folder_num, GList *songs)
+{
+  song_entry *song;
+  GList      *item;
+  int         s;
+
+  for (s = 0, item = g_list_first (songs); item; item = item->next, s++)
+  {
+    song = (song_entry *) item->data;
+    index_add (index->songs, &index->song_refs, card, folder_num, s,
+               (char *) song->name1, song);
+  }
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_name_index_folder, rio_name_index_song
+   DESCRIPTION: Look a name up. Returns the first entry with that name
+                (others follow through ->next) or NULL.
+   ------------------------------------------------------------------- */
+
+rio_name_ref *
+rio_name_index_folder (rio_name_index *index, char *name)
+{
+  return (rio_name_ref *) g_hash_table_lookup (index->folders, name);
+}
+
+rio_name_ref *
+rio_name_index_song (rio_name_index *index, char *name)
+{
+  return (rio_name_ref *) g_hash_table_lookup (index->songs, name);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_name_index_match
+   DESCRIPTION: All the songs (or folders if songs is FALSE) whose name
+                matches pattern, in table order. how is RIO_MATCH_EXACT,
+                RIO_MATCH_GLOB (shell wildcards) or RIO_MATCH_REGEX
+                (extended regular expression). Free the list with
+                g_list_free, not the refs. Returns NULL if nothing
+                matches or the regular expression is bad.
+   ------------------------------------------------------------------- */
+
+GList *
+rio_name_index_match (rio_name_index *index, char *pattern, int how, int songs)
+{
+  rio_name_ref *ref;
+  GList        *item, *matches = NULL;
+  regex_t       re;
+  int           match;
+
+  if (how == RIO_MATCH_EXACT)
+  {
+    ref = songs ? rio_name_index_song (index, pattern)
+                : rio_name_index_folder (index, pattern);
+    for (; ref; ref = ref->next)
+      matches = g_list_append (matches, ref);
+    return matches;
+  }
+
+  if (how == RIO_MATCH_REGEX
+      && regcomp (&re, pattern, REG_EXTENDED | REG_NOSUB) != 0)
+    return NULL;
+
+  /* refs are newest first, so prepending puts the matches in order */
+  for (item = songs ? index->song_refs : index->folder_refs; item; item = item->next)
+  {
+    ref = (rio_name_ref *) item->data;
+    if (how == RIO_MATCH_REGEX)
+      match = (regexec (&re, ref->name, 0, NULL, 0) == 0);
+    else
+      match = (fnmatch (pattern, ref->name, 0) == 0);
+    if (match)
+      matches = g_list_prepend (matches, ref);
+  }
+
+  if (how == RIO_MATCH_REGEX)
+    regfree (&re);
+
+  return matches;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_name_index_delete
+   DESCRIPTION: Free the index (not the entries it points to).
+   ------------------------------------------------------------------- */
+
+void
+rio_name_index_delete (rio_name_index *index)
+{
+  GList *item;
+
+  if (index == NULL)
+    return;
+
+  for (item = index->folder_refs; item; item = item->next)
+    free (item->data);
+  for (item = index->song_refs; item; item = item->next)
+    free (item->data);
+  g_list_free (index->folder_refs);
+  g_list_free (index->song_refs);
+  g_hash_table_destroy (index->folders);
+  g_hash_table_destroy (index->songs);
+  free (index);
+}
@@ -0,0 +1,410 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Intent log.
+
+   Adding or renaming a song writes the folder's song table, which lands
+   somewhere new, so the folder entry has to point there: a write of the
+   whole folder table, send_folder_location and 0x58, every time, even
+   when the next song goes into the same folder. With an intent log the
+   API only writes the song table and notes the folder entry's new
+   offset and song count here; the folder table is written once when the
+   session is flushed or closed.
+
+   A note is on disk (fsync'd) before the call that made it returns, so
+   if the program dies before the folder table is written the next
+   session can replay the notes and point the folders at the song tables
+   that were written. Each note keeps the offset the folder had on the
+   Rio before the session touched it; a note is only replayed onto a
+   folder that still has that offset (or already has the new one), so a
+   stale log can't point some other folder at the wrong songs.
+
+   Log file layout (all numbers little endian):
+
+     magic "RIO500IL", version
+     notes of card, folder, old offset, new offset, first free entry
+     offset and a check word; a later note for the same folder replaces
+     an earlier one, a torn note at the end is ignored.
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <byteswap.h>
+
+#define INTENT_MAGIC                "RIO500IL"
+#define INTENT_VERSION              1
+#define INTENT_CHECK                0x52494f35
+
+#ifdef WORDS_BIGENDIAN
+#define INTENT_LE32(x)              bswap_32 (x)
+#else
+#define INTENT_LE32(x)              (x)
+#endif
+
+typedef struct
+{
+  DWORD            card;
+  DWORD            folder;
+  DWORD            base;          /* offset on the Rio before the session */
+  DWORD            offset;
+  DWORD            fst_free_entry_off;
+  DWORD            check;
+} intent_note;
+
+typedef struct
+{
+  int              pending;
+  intent_note      note;
+} intent_slot;
+
+struct _rio_intent
+{
+  char            *filename;
+  int              fd;            /* log, open for appending; -1 if none */
+  intent_slot      slots[RIO_CACHE_MAX_CARDS][RIO_CACHE_MAX_FOLDERS];
+};
+
+
+static DWORD
+intent_check (intent_note *note)
+{
+  return note->card ^ note->folder ^ note->base ^ note->offset
+         ^ note->fst_free_entry_off ^ INTENT_CHECK;
+}
+
+static int
+intent_write (int fd, void *data, int len)
+{
+  BYTE *p = (BYTE *) data;
+  int   n;
+
+  while (len > 0)
+  {
+    n = write (fd, p, len);
+    if (n <= 0)
+      return -1;
+    p   += n;
+    len -= n;
+  }
+  return 0;
+}
+
+static int
+intent_write_note (int fd, intent_note *note)
+{
+  intent_note le;
+  DWORD      *fields;
+  int         i;
+
+  note->check = intent_check (note);
+  le = *note;
+  fields = (DWORD *) &le;
+  for (i = 0; i < sizeof (intent_note) / sizeof (DWORD); i++)
+    fields[i] = INTENT_LE32 (fields[i]);
+
+  return intent_write (fd, &le, sizeof (intent_note));
+}
+
+/* Start the log file again with just the notes still pending and leave
+   it open for appending. The new file goes in under a temporary name
+   first so a crash leaves either the old log or the new one. */
+static int
+intent_rewrite (rio_intent *intent)
+{
+  intent_slot *slot;
+  char        *tmpname;
+  DWORD        version;
+  int          fd, c, f, any, status;
+
+  if (intent->fd != -1)
+  {
+    close (intent->fd);
+    intent->fd = -1;
+  }
+
+  any = FALSE;
+  for (c = 0; c < RIO_CACHE_MAX_CARDS; c++)
+    for (f = 0; f < RIO_CACHE_MAX_FOLDERS; f++)
+      any |= intent->slots[c][f].pending;
+
+  if (!any)
+  {
+    unlink (intent->filename);
+    intent->fd = open (intent->filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (intent->fd == -1)
+      return -1;
+    /* An empty log is just the header */
+    version = INTENT_LE32 (INTENT_VERSION);
+    if (intent_write (intent->fd, INTENT_MAGIC, 8) == -1
+        || intent_write (intent->fd, &version, sizeof (DWORD)) == -1
+        || fsync (intent->fd) == -1)
+      return -1;
+    return 0;
+  }
+
+  tmpname = g_strconcat (intent->filename, ".new", NULL);
+  fd = open (tmpname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1)
+  {
+    g_free (tmpname);
+    return -1;
+  }
+
+  version = INTENT_LE32 (INTENT_VERSION);
+  status = intent_write (fd, INTENT_MAGIC, 8);
+  if (status == 0)
+    status = intent_write (fd, &version, sizeof (DWORD));
+  for (c = 0; c < RIO_CACHE_MAX_CARDS && status == 0; c++)
+    for (f = 0; f < RIO_CACHE_MAX_FOLDERS && status == 0; f++)
+    {
+      slot = &intent->slots[c][f];
+      if (slot->pending)
+        status = intent_write_note (fd, &slot->note);
+    }
+  if (status == 0)
+    status = fsync (fd);
+  close (fd);
+
+  if (status == 0)
+    status = rename (tmpname, intent->filename);
+  if (status != 0)
+    unlink (tmpname);
+  g_free (tmpname);
+
+  intent->fd = open (intent->filename, O_WRONLY | O_APPEND);
+  return (status == 0 && intent->fd != -1) ? 0 : -1;
+}
+
+static void
+intent_load (rio_intent *intent)
+{
+  intent_note  note;
+  DWORD       *fields;
+  char         magic[8];
+  DWORD        version;
+  int          fd, i;
+
+  fd = open (intent->filename, O_RDONLY);
+  if (fd == -1)
+    return;
+
+  if (read (fd, magic, 8) != 8 || memcmp (magic, INTENT_MAGIC, 8) != 0
+      || read (fd, &version, sizeof (DWORD)) != sizeof (DWORD)
+      || INTENT_LE32 (version) != INTENT_VERSION)
+  {
+    printf ("Ignoring %s: not an intent log\n", intent->filename);
+    close (fd);
+    return;
+  }
+
+  while (read (fd, &note, sizeof (intent_note)) == sizeof (intent_note))
+  {
+    fields = (DWORD *) &note;
+    for (i = 0; i < sizeof (intent_note) / sizeof (DWORD); i++)
+      fields[i] = INTENT_LE32 (fields[i]);
+    if (note.check != intent_check (&note))
+      break;
+    if (note.card >= RIO_CACHE_MAX_CARDS || note.folder >= RIO_CACHE_MAX_FOLDERS)
+      continue;
+    intent->slots[note.card][note.folder].pending = TRUE;
+    intent->slots[note.card][note.folder].note    = note;
+  }
+
+  close (fd);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_intent_new
+   DESCRIPTION: Create an intent log. If filename isn't NULL the notes
+                are kept in it, and any left there by a session that
+                didn't get to write its folder table are pending again.
+                With NULL the notes are only kept in memory.
+   ------------------------------------------------------------------- */
+
+rio_intent *
+rio_intent_new (char *filename)
+{
+  rio_intent *intent;
+
+  intent = calloc (1, sizeof (rio_intent));
+  if (intent == NULL)
+    return NULL;
+  intent->fd = -1;
+
+  if (filename != NULL)
+  {
+    intent->filename = g_strdup (filename);
+    intent_load (intent);
+    if (intent_rewrite (intent) == -1)
+      printf ("Can't write intent log %s\n", filename);
+  }
+
+  return intent;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_intent_delete
+   DESCRIPTION: Free the log. Pending notes stay in the file for the
+                next session.
+   ------------------------------------------------------------------- */
+
+void
+rio_intent_delete (rio_intent *intent)
+{
+  if (intent == NULL)
+    return;
+
+  if (intent->fd != -1)
+    close (intent->fd);
+  g_free (intent->filename);
+  free (intent);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_intent_record
+   DESCRIPTION: Note that folder folder_num of card should now look like
+                folder (its offset and first free entry offset). base is
+                the offset the folder has in the folder table on the
+                Rio. The note is on disk when this returns 0; -1 if it
+                couldn't be written (write the folder table now then).
+   ------------------------------------------------------------------- */
+
+int
+rio_intent_record (rio_intent *intent, int card, int folder_num,
+                   WORD base, folder_entry *folder)
+{
+  intent_slot *slot;
+
+  if (intent == NULL || card < 0 || card >= RIO_CACHE_MAX_CARDS
+      || folder_num < 0 || folder_num >= RIO_CACHE_MAX_FOLDERS)
+    return -1;
+
+  slot = &intent->slots[card][folder_num];
+  if (!slot->pending)
+  {
+    slot->note.card   = card;
+    slot->note.folder = folder_num;
+    slot->note.base   = base;
+  }
+  slot->note.offset             = folder->offset;
+  slot->note.fst_free_entry_off = folder->fst_free_entry_off;
+
+  if (intent->fd != -1
+      && (intent_write_note (intent->fd, &slot->note) == -1
+          || fsync (intent->fd) == -1))
+    return -1;
+
+  slot->pending = TRUE;
+  return 0;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_intent_pending
+   DESCRIPTION: Number of folders of card with pending notes.
+   ------------------------------------------------------------------- */
+
+int
+rio_intent_pending (rio_intent *intent, int card)
+{
+  int f, n = 0;
+
+  if (intent == NULL || card < 0 || card >= RIO_CACHE_MAX_CARDS)
+    return 0;
+
+  for (f = 0; f < RIO_CACHE_MAX_FOLDERS; f++)
+    n += intent->slots[card][f].pending;
+
+  return n;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_intent_apply
+   DESCRIPTION: Put the pending notes of card into folders, the folder
+                table as the Rio has it (or as the session has changed
+                it). Returns the number of the last folder with a note
+                that applies, or -1 if there is none.
+   ------------------------------------------------------------------- */
+
+int
+rio_intent_apply (rio_intent *intent, rio_table *folders, int card)
+{
+  intent_slot  *slot;
+  folder_entry *folder;
+  int           f, last = -1;
+
+  if (intent == NULL || folders == NULL || rio_intent_pending (intent, card) == 0)
+    return -1;
+
+  for (f = 0; f < RIO_CACHE_MAX_FOLDERS; f++)
+  {
+    slot = &intent->slots[card][f];
+    if (!slot->pending)
+      continue;
+    if (f >= folders->count)
+    {
+      printf ("Intent log: folder %d is gone, not replayed\n", f);
+      continue;
+    }
+
+    folder = rio_table_folder (folders, f);
+    if (folder->offset != slot->note.offset
+        || folder->fst_free_entry_off != slot->note.fst_free_entry_off)
+    {
+      if (folder->offset != slot->note.base)
+      {
+        printf ("Intent log: folder %d has changed, not replayed\n", f);
+        continue;
+      }
+      folder->offset             = slot->note.offset;
+      folder->fst_free_entry_off = slot->note.fst_free_entry_off;
+      rio_table_touch (folders, f);
+    }
+    last = f;
+  }
+
+  return last;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_intent_clear
+   DESCRIPTION: The folder table of card has been written; drop its
+                notes. Returns 0 or -1 if the log couldn't be rewritten.
+   ------------------------------------------------------------------- */
+
+int
+rio_intent_clear (rio_intent *intent, int card)
+{
+  int f;
+
+  if (intent == NULL || card < 0 || card >= RIO_CACHE_MAX_CARDS)
+    return -1;
+
+  for (f = 0; f < RIO_CACHE_MAX_FOLDERS; f++)
+    intent->slots[card][f].pending = FALSE;
+
+  if (intent->filename == NULL)
+    return 0;
+
+  return intent_rewrite (intent);
+}
@@ -0,0 +1,302 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Moving songs around.
+
+   A song entry says where the song's audio is on the flash (offset) and
+   how long it is, and nothing on the Rio ties the audio to the folder
+   or the position the entry is at. So moving a song to another folder,
+   putting a folder's songs in another order or making a second entry
+   for the same song only takes rewriting the song tables involved and
+   the folder table; the audio stays where it is.
+
+   A copy shares its audio with the original, and releasing the audio
+   of one (0x4c) would pull it from under the other. Whoever deletes
+   songs where copies may exist has to use rio_delete_songs_keeping and
+   let only the last entry release it.
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+
+/* Write a folder's song table and point its folder entry at it */
+static void
+move_write_songs (rio_device rio_dev, rio_table *folders, rio_table *songs,
+                  int folder_num, int card)
+{
+  folder_entry *folder;
+
+  rio_write_song_table (rio_dev, folder_num, songs, card);
+
+  folder = rio_table_folder (folders, folder_num);
+  folder->offset = rio_last_write (rio_dev);
+  folder->fst_free_entry_off = songs->count * RIO_ENTRY_SIZE;
+  rio_table_touch (folders, folder_num);
+}
+
+/* Write the folder table and tell the Rio about it */
+static void
+move_write_folders (rio_device rio_dev, rio_table *folders, int folder_num, int card)
+{
+  int location;
+
+  rio_write_folder_table (rio_dev, folders, card);
+  location = rio_last_write (rio_dev);
+
+  /* Tell Rio where the root folder block is. */
+  send_folder_location (rio_dev, location, folder_num, card);
+
+  /* Not really sure what this does */
+  send_command (rio_dev, 0x58, 0x0, card);
+}
+
+/* Take copies of the entries song_nums names, in that order. Fails on
+   numbers out of range or given twice. */
+static BYTE *
+move_take (rio_table *songs, int *song_nums, int count)
+{
+  BYTE *entries;
+  int   i, j;
+
+  if (count <= 0)
+    return NULL;
+
+  for (i = 0; i < count; i++)
+  {
+    if (song_nums[i] < 0 || song_nums[i] >= songs->count)
+      return NULL;
+    for (j = 0; j < i; j++)
+      if (song_nums[j] == song_nums[i])
+        return NULL;
+  }
+
+  entries = malloc (count * RIO_ENTRY_SIZE);
+  if (entries == NULL)
+    return NULL;
+  for (i = 0; i < count; i++)
+    memcpy (entries + i * RIO_ENTRY_SIZE, rio_table_entry (songs, song_nums[i]),
+            RIO_ENTRY_SIZE);
+
+  return entries;
+}
+
+/* Insert count entries at pos (-1 or past the end: append). On failure
+   the ones already in are taken out again and songs is as it was. */
+static int
+move_put (rio_table *songs, BYTE *entries, int count, int pos)
+{
+  int i;
+
+  if (pos < 0 || pos > songs->count)
+    pos = songs->count;
+  for (i = 0; i < count; i++)
+    if (rio_table_insert (songs, pos + i, entries + i * RIO_ENTRY_SIZE) == -1)
+    {
+      while (i-- > 0)
+        rio_table_remove (songs, pos + i);
+      return -1;
+    }
+
+  return 0;
+}
+
+/* Put songs in the order order gives (every song number once) */
+static int
+move_order (rio_table *songs, int *order)
+{
+  BYTE *entries;
+  int   i;
+
+  entries = move_take (songs, order, songs->count);
+  if (entries == NULL)
+    return -1;
+
+  for (i = 0; i < songs->count; i++)
+    memcpy (rio_table_entry (songs, i), entries + i * RIO_ENTRY_SIZE, RIO_ENTRY_SIZE);
+  free (entries);
+
+  return 0;
+}
+
+/* Moving within one folder is a new order: the songs not moved keep
+   theirs, with the moved ones put in at pos among them */
+static int
+move_within (rio_table *songs, int *song_nums, int count, int pos)
+{
+  int *order;
+  int  i, j, n, k, kept, status;
+
+  kept = songs->count - count;
+  if (pos < 0 || pos > kept)
+    pos = kept;
+
+  order = malloc (songs->count * sizeof (int));
+  if (order == NULL)
+    return -1;
+
+  for (i = n = k = 0; i < songs->count; i++)
+  {
+    for (j = 0; j < count; j++)
+      if (song_nums[j] == i)
+        break;
+    if (j < count)
+      continue;
+    if (k++ == pos)
+      for (j = 0; j < count; j++)
+        order[n++] = song_nums[j];
+    order[n++] = i;
+  }
+  if (n < songs->count)
+    for (j = 0; j < count; j++)
+      order[n++] = song_nums[j];
+
+  status = move_order (songs, order);
+  free (order);
+  return status;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_move_song_entries
+   DESCRIPTION: Move count songs of folder from_folder (table from) to
+                folder to_folder (table to), in the order given, to
+                position to_pos there (-1 for the end). Moving within a
+                folder (from == to) is fine; to_pos then counts without
+                the songs being moved. The tables are the ones the Rio
+                has now and are updated to match. Returns the number of
+                songs moved, or -1.
+   ------------------------------------------------------------------- */
+
+int
+rio_move_song_entries (rio_device rio_dev, rio_table *folders,
+                       rio_table *from, int from_folder,
+                       int *song_nums, int count,
+                       rio_table *to, int to_folder, int to_pos, int card)
+{
+  BYTE *entries;
+  int   j, num;
+
+  if (folders == NULL || from == NULL || to == NULL
+      || from_folder < 0 || from_folder >= folders->count
+      || to_folder < 0 || to_folder >= folders->count
+      || (from == to) != (from_folder == to_folder))
+    return -1;
+
+  entries = move_take (from, song_nums, count);
+  if (entries == NULL)
+    return -1;
+
+  /* Into the destination first: if that fails neither table changed */
+  if (from == to)
+  {
+    if (move_within (from, song_nums, count, to_pos) == -1)
+    {
+      free (entries);
+      return -1;
+    }
+  }
+  else
+  {
+    if (move_put (to, entries, count, to_pos) == -1)
+    {
+      free (entries);
+      return -1;
+    }
+
+    /* Out of the source, highest first so the numbers stay right */
+    for (num = from->count - 1; num >= 0; num--)
+      for (j = 0; j < count; j++)
+        if (song_nums[j] == num)
+        {
+          rio_table_remove (from, num);
+          break;
+        }
+  }
+  free (entries);
+
+  if (from != to)
+    move_write_songs (rio_dev, folders, from, from_folder, card);
+  move_write_songs (rio_dev, folders, to, to_folder, card);
+  move_write_folders (rio_dev, folders, to_folder, card);
+
+  return count;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_copy_song_entries
+   DESCRIPTION: Same, but leave the songs where they are too. The copies
+                share the audio with the originals.
+   ------------------------------------------------------------------- */
+
+int
+rio_copy_song_entries (rio_device rio_dev, rio_table *folders,
+                       rio_table *from, int from_folder,
+                       int *song_nums, int count,
+                       rio_table *to, int to_folder, int to_pos, int card)
+{
+  BYTE *entries;
+
+  if (folders == NULL || from == NULL || to == NULL
+      || to_folder < 0 || to_folder >= folders->count)
+    return -1;
+
+  entries = move_take (from, song_nums, count);
+  if (entries == NULL)
+    return -1;
+
+  if (move_put (to, entries, count, to_pos) == -1)
+  {
+    free (entries);
+    return -1;
+  }
+  free (entries);
+
+  move_write_songs (rio_dev, folders, to, to_folder, card);
+  move_write_folders (rio_dev, folders, to_folder, card);
+
+  return count;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_reorder_song_entries
+   DESCRIPTION: Put the songs of folder folder_num in a new order: song
+                i becomes the one that was order[i]. order must hold
+                every song number once. Returns 0 or -1.
+   ------------------------------------------------------------------- */
+
+int
+rio_reorder_song_entries (rio_device rio_dev, rio_table *folders,
+                          rio_table *songs, int folder_num, int *order, int card)
+{
+  if (folders == NULL || songs == NULL
+      || folder_num < 0 || folder_num >= folders->count)
+    return -1;
+  if (songs->count == 0)
+    return 0;
+
+  if (move_order (songs, order) == -1)
+    return -1;
+
+  move_write_songs (rio_dev, folders, songs, folder_num, card);
+  move_write_folders (rio_dev, folders, folder_num, card);
+
+  return 0;
+}
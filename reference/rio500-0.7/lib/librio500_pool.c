@@ -0,0 +1,150 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Transfer buffer pool.
+
+   Song uploads and downloads move data through a 512Kb buffer and every
+   table write goes through a 16Kb block. Instead of allocating (and
+   usually leaking) those for every song, buffers are parked in a pool
+   when the caller is done with them and handed out again on the next
+   request. Table blocks are given back already cleared (zeroed with the
+   0xffff end-of-entry markers in place) so they can be filled right away.
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+
+static rio_pool *default_pool = NULL;
+
+static BYTE *
+rio_pool_alloc (size_t size)
+{
+  void *buf = NULL;
+  long  page;
+
+  page = sysconf (_SC_PAGESIZE);
+  if (page <= 0)
+    page = 4096;
+
+  if (posix_memalign (&buf, page, size) != 0)
+    return NULL;
+
+  return (BYTE *) buf;
+}
+
+rio_pool *
+rio_pool_new ()
+{
+  return (rio_pool *) calloc (1, sizeof (rio_pool));
+}
+
+void
+rio_pool_delete (rio_pool *pool)
+{
+  int i;
+
+  if (pool == NULL)
+    return;
+
+  for (i = 0; i < pool->num_xfer; i++)
+    free (pool->xfer[i]);
+  for (i = 0; i < pool->num_blocks; i++)
+    free (pool->blocks[i]);
+
+  if (pool == default_pool)
+    default_pool = NULL;
+  free (pool);
+}
+
+/* Pool used by the low level table routines and by callers that don't
+   keep a pool of their own. */
+rio_pool *
+rio_pool_default ()
+{
+  if (default_pool == NULL)
+    default_pool = rio_pool_new ();
+  return default_pool;
+}
+
+BYTE *
+rio_pool_get_xfer (rio_pool *pool)
+{
+  if (pool == NULL)
+    pool = rio_pool_default ();
+
+  if (pool && pool->num_xfer > 0)
+    return pool->xfer[--pool->num_xfer];
+
+  return rio_pool_alloc (RIO_XFER_SIZE);
+}
+
+void
+rio_pool_put_xfer (rio_pool *pool, BYTE *buf)
+{
+  if (buf == NULL)
+    return;
+  if (pool == NULL)
+    pool = rio_pool_default ();
+
+  if (pool && pool->num_xfer < RIO_POOL_MAX_XFER)
+    pool->xfer[pool->num_xfer++] = buf;
+  else
+    free (buf);
+}
+
+BYTE *
+rio_pool_get_block (rio_pool *pool)
+{
+  BYTE *block;
+
+  if (pool == NULL)
+    pool = rio_pool_default ();
+
+  if (pool && pool->num_blocks > 0)
+    return pool->blocks[--pool->num_blocks];
+
+  block = rio_pool_alloc (FOLDER_BLOCK_SIZE);
+  if (block)
+  {
+    memset (block, 0, FOLDER_BLOCK_SIZE);
+    clear_block (block);
+  }
+  return block;
+}
+
+void
+rio_pool_put_block (rio_pool *pool, BYTE *block)
+{
+  if (block == NULL)
+    return;
+  if (pool == NULL)
+    pool = rio_pool_default ();
+
+  if (pool && pool->num_blocks < RIO_POOL_MAX_BLOCKS)
+  {
+    /* Hand it out clean next time */
+    memset (block, 0, FOLDER_BLOCK_SIZE);
+    clear_block (block);
+    pool->blocks[pool->num_blocks++] = block;
+  } else
+    free (block);
+}
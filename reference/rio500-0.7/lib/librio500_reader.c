@@ -0,0 +1,532 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Read-ahead source reader for song uploads.
+
+   The upload loop alternates between reading the mp3 and pushing it
+   down the USB pipe. With a slow source (NFS, a spun down disk) every
+   read() stalls the Rio. The reader splits one transfer buffer from the
+   pool into RIO_READER_SLOTS slots and keeps all of them queued ahead of
+   the consumer, so by the time write_song asks for the next chunk it is
+   normally already in memory.
+
+   When <linux/io_uring.h> is found at configure time the slots are read
+   through an io_uring with the slot buffers registered (READ_FIXED), and
+   the kernel fills them while we are busy on the bus: one io_uring_enter
+   submits a whole batch and reaps completions. If the ring can't be set
+   up (old kernel, seccomp) we fall back to plain pread() plus
+   posix_fadvise() hints, which is what the upload code did before.
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup         425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter         426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register      427
+#endif
+
+typedef struct
+{
+  int                  fd;
+  int                  fixed;         /* slot buffers are registered */
+  int                  pending;       /* prepared but not yet submitted */
+  unsigned            *sq_tail;
+  unsigned            *sq_mask;
+  unsigned            *sq_array;
+  unsigned            *cq_head;
+  unsigned            *cq_tail;
+  unsigned            *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void                *sq_ptr;
+  void                *cq_ptr;
+  size_t               sq_size;
+  size_t               cq_size;
+  size_t               sqes_size;
+  struct iovec         iov[RIO_READER_SLOTS];
+} rio_uring;
+#endif /* HAVE_LINUX_IO_URING_H */
+
+#define SLOT_EMPTY                  0   /* nothing left to read into it */
+#define SLOT_QUEUED                 1
+#define SLOT_READY                  2
+
+struct _rio_reader
+{
+  int            fd;
+  unsigned long  end;            /* file offset where reading stops */
+  rio_pool      *pool;
+  BYTE          *buffer;         /* the slots, one xfer buffer */
+  BYTE          *bounce;         /* a chunk straddling two slots (one slot's worth) */
+  unsigned long  next_offset;    /* file offset of the next slot to queue */
+  int            cur;            /* slot being consumed */
+  int            pos;            /* bytes of it already handed out */
+  int            state[RIO_READER_SLOTS];
+  unsigned long  offset[RIO_READER_SLOTS];
+  int            want[RIO_READER_SLOTS];
+  int            len[RIO_READER_SLOTS];
+#ifdef HAVE_LINUX_IO_URING_H
+  rio_uring     *ring;
+#endif
+};
+
+#define SLOT_BUF(r, s)   ((r)->buffer + (s) * RIO_READER_SLOT_SIZE)
+
+
+/* Synchronously read whatever is missing from slot s */
+static int
+reader_pread (rio_reader *r, int s, int done)
+{
+  int count;
+
+  while (done < r->want[s])
+  {
+    count = pread (r->fd, SLOT_BUF (r, s) + done, r->want[s] - done,
+                   r->offset[s] + done);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count < 0)
+      return (done > 0) ? done : -1;
+    if (count == 0)
+      break;
+    done += count;
+  }
+  return done;
+}
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+static void
+uring_free (rio_uring *ring)
+{
+  if (ring->sqes)
+    munmap (ring->sqes, ring->sqes_size);
+  if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr)
+    munmap (ring->cq_ptr, ring->cq_size);
+  if (ring->sq_ptr)
+    munmap (ring->sq_ptr, ring->sq_size);
+  close (ring->fd);
+  free (ring);
+}
+
+static rio_uring *
+uring_new (rio_reader *r)
+{
+  struct io_uring_params params;
+  rio_uring *ring;
+  int        i;
+
+  ring = calloc (1, sizeof (rio_uring));
+  if (ring == NULL)
+    return NULL;
+
+  memset (&params, 0, sizeof (params));
+  ring->fd = syscall (__NR_io_uring_setup, RIO_READER_SLOTS, &params);
+  if (ring->fd < 0)
+  {
+    free (ring);
+    return NULL;
+  }
+
+  ring->sq_size = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+  ring->cq_size = params.cq_off.cqes
+                  + params.cq_entries * sizeof (struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (ring->cq_size > ring->sq_size)
+      ring->sq_size = ring->cq_size;
+    ring->cq_size = ring->sq_size;
+  }
+
+  ring->sq_ptr = mmap (NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ptr == MAP_FAILED)
+  {
+    ring->sq_ptr = NULL;
+    uring_free (ring);
+    return NULL;
+  }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    ring->cq_ptr = ring->sq_ptr;
+  else
+  {
+    ring->cq_ptr = mmap (NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ptr == MAP_FAILED)
+    {
+      ring->cq_ptr = NULL;
+      uring_free (ring);
+      return NULL;
+    }
+  }
+
+  ring->sqes_size = params.sq_entries * sizeof (struct io_uring_sqe);
+  ring->sqes = mmap (NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED)
+  {
+    ring->sqes = NULL;
+    uring_free (ring);
+    return NULL;
+  }
+
+  ring->sq_tail  = (unsigned *) ((char *) ring->sq_ptr + params.sq_off.tail);
+  ring->sq_mask  = (unsigned *) ((char *) ring->sq_ptr + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned *) ((char *) ring->sq_ptr + params.sq_off.array);
+  ring->cq_head  = (unsigned *) ((char *) ring->cq_ptr + params.cq_off.head);
+  ring->cq_tail  = (unsigned *) ((char *) ring->cq_ptr + params.cq_off.tail);
+  ring->cq_mask  = (unsigned *) ((char *) ring->cq_ptr + params.cq_off.ring_mask);
+  ring->cqes     = (struct io_uring_cqe *) ((char *) ring->cq_ptr + params.cq_off.cqes);
+
+  /* Pin the slots so the kernel can skip the per read page lookups.
+     This needs RLIMIT_MEMLOCK headroom; without it use plain readv. */
+  for (i = 0; i < RIO_READER_SLOTS; i++)
+  {
+    ring->iov[i].iov_base = SLOT_BUF (r, i);
+    ring->iov[i].iov_len  = RIO_READER_SLOT_SIZE;
+  }
+  ring->fixed = (syscall (__NR_io_uring_register, ring->fd,
+                          IORING_REGISTER_BUFFERS, ring->iov,
+                          RIO_READER_SLOTS) == 0);
+
+  return ring;
+}
+
+static void
+uring_prep_read (rio_uring *ring, rio_reader *r, int s)
+{
+  struct io_uring_sqe *sqe;
+  unsigned             tail, idx;
+
+  tail = *ring->sq_tail;
+  idx  = tail & *ring->sq_mask;
+  sqe  = &ring->sqes[idx];
+  memset (sqe, 0, sizeof (*sqe));
+
+  sqe->fd  = r->fd;
+  sqe->off = r->offset[s];
+  sqe->user_data = s;
+  if (ring->fixed)
+  {
+    sqe->opcode    = IORING_OP_READ_FIXED;
+    sqe->addr      = (unsigned long) SLOT_BUF (r, s);
+    sqe->len       = r->want[s];
+    sqe->buf_index = s;
+  } else {
+    ring->iov[s].iov_base = SLOT_BUF (r, s);
+    ring->iov[s].iov_len  = r->want[s];
+    sqe->opcode = IORING_OP_READV;
+    sqe->addr   = (unsigned long) &ring->iov[s];
+    sqe->len    = 1;
+  }
+
+  ring->sq_array[idx] = idx;
+  __atomic_store_n (ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ring->pending++;
+}
+
+/* Submit everything prepared and, if wait is set, block until at least
+   one completion is available */
+static int
+uring_enter (rio_uring *ring, int wait)
+{
+  int ret;
+
+  do {
+    ret = syscall (__NR_io_uring_enter, ring->fd, ring->pending, wait ? 1 : 0,
+                   wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+  } while (ret < 0 && errno == EINTR);
+
+  if (ret < 0)
+    return -1;
+  ring->pending -= (ret < ring->pending) ? ret : ring->pending;
+  return 0;
+}
+
+/* Reap completions until slot s has landed */
+static void
+uring_wait (rio_uring *ring, rio_reader *r, int s)
+{
+  struct io_uring_cqe *cqe;
+  unsigned             head;
+  int                  done;
+
+  while (r->state[s] == SLOT_QUEUED)
+  {
+    head = *ring->cq_head;
+    if (head == __atomic_load_n (ring->cq_tail, __ATOMIC_ACQUIRE))
+    {
+      if (uring_enter (ring, 1) == -1)
+      {
+        /* Shouldn't happen once the ring is up; read it ourselves */
+        r->len[s]   = reader_pread (r, s, 0);
+        r->state[s] = SLOT_READY;
+        return;
+      }
+      continue;
+    }
+
+    cqe  = &ring->cqes[head & *ring->cq_mask];
+    done = (int) cqe->user_data;
+    r->len[done] = cqe->res;
+    __atomic_store_n (ring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+    /* Short or failed reads are topped up synchronously */
+    if (r->len[done] < 0)
+      r->len[done] = reader_pread (r, done, 0);
+    else if (r->len[done] < r->want[done])
+      r->len[done] = reader_pread (r, done, r->len[done]);
+    r->state[done] = SLOT_READY;
+  }
+}
+
+#endif /* HAVE_LINUX_IO_URING_H */
+
+/* Point slot s at the next piece of the file and start reading it */
+static void
+reader_queue (rio_reader *r, int s)
+{
+  unsigned long left;
+
+  if (r->next_offset >= r->end)
+  {
+    r->state[s] = SLOT_EMPTY;
+    r->len[s]   = 0;
+    return;
+  }
+
+  left = r->end - r->next_offset;
+  r->offset[s] = r->next_offset;
+  r->want[s]   = (left > RIO_READER_SLOT_SIZE) ? RIO_READER_SLOT_SIZE : left;
+  r->len[s]    = 0;
+  r->state[s]  = SLOT_QUEUED;
+  r->next_offset += r->want[s];
+
+#ifdef HAVE_LINUX_IO_URING_H
+  if (r->ring)
+  {
+    uring_prep_read (r->ring, r, s);
+    return;
+  }
+#endif
+  posix_fadvise (r->fd, r->offset[s], r->want[s], POSIX_FADV_WILLNEED);
+}
+
+static void
+reader_submit (rio_reader *r)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+  if (r->ring && r->ring->pending > 0)
+    uring_enter (r->ring, 0);
+#endif
+}
+
+static void
+reader_wait (rio_reader *r, int s)
+{
+  if (r->state[s] != SLOT_QUEUED)
+    return;
+
+#ifdef HAVE_LINUX_IO_URING_H
+  if (r->ring)
+  {
+    uring_wait (r->ring, r, s);
+    return;
+  }
+#endif
+  r->len[s]   = reader_pread (r, s, 0);
+  r->state[s] = SLOT_READY;
+}
+
+/* Make the current slot readable, recycling it first if it has been
+   used up. Returns the bytes left in it, 0 at end of file, -1 on error */
+static int
+reader_fill (rio_reader *r)
+{
+  if (r->state[r->cur] == SLOT_READY && r->pos >= r->len[r->cur])
+  {
+    reader_queue (r, r->cur);
+    reader_submit (r);
+    r->cur = (r->cur + 1) % RIO_READER_SLOTS;
+    r->pos = 0;
+  }
+
+  if (r->state[r->cur] == SLOT_EMPTY)
+    return 0;
+
+  reader_wait (r, r->cur);
+  if (r->len[r->cur] < 0)
+    return -1;
+  return r->len[r->cur] - r->pos;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_reader_new
+   DESCRIPTION: Start reading size bytes of fd from offset on. The slot
+                buffers come from pool (NULL = default pool).
+   ------------------------------------------------------------------- */
+
+rio_reader *
+rio_reader_new (int fd, unsigned long offset, unsigned long size, rio_pool *pool)
+{
+  rio_reader *r;
+  int         i;
+
+  r = calloc (1, sizeof (rio_reader));
+  if (r == NULL)
+    return NULL;
+
+  r->fd     = fd;
+  r->end    = offset + size;
+  r->pool   = pool;
+  r->next_offset = offset;
+  r->buffer = rio_pool_get_xfer (pool);
+  r->bounce = malloc (RIO_READER_SLOT_SIZE);
+  if (r->buffer == NULL || r->bounce == NULL)
+  {
+    rio_pool_put_xfer (pool, r->buffer);
+    free (r->bounce);
+    free (r);
+    return NULL;
+  }
+
+#ifdef HAVE_LINUX_IO_URING_H
+  r->ring = uring_new (r);
+#endif
+  posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  for (i = 0; i < RIO_READER_SLOTS; i++)
+    reader_queue (r, i);
+  reader_submit (r);
+
+  return r;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_reader_next
+   DESCRIPTION: Return a pointer to the next len bytes of the file (len
+                is at most RIO_READER_SLOT_SIZE). *count gets the number
+                of bytes actually read, which is less than len only at the
+                end of the file, or -1 on a read error; the buffer is
+                always len bytes long. It stays valid until the next call.
+   ------------------------------------------------------------------- */
+
+BYTE *
+rio_reader_next (rio_reader *r, int len, int *count)
+{
+  BYTE *p;
+  int   avail, n, got;
+
+  if (len <= 0)
+  {
+    *count = 0;
+    return r->bounce;
+  }
+  if (len > RIO_READER_SLOT_SIZE)
+    len = RIO_READER_SLOT_SIZE;
+
+  avail = reader_fill (r);
+  if (avail >= len)
+  {
+    p = SLOT_BUF (r, r->cur) + r->pos;
+    r->pos += len;
+    *count = len;
+    return p;
+  }
+
+  /* Chunk straddles two slots or runs into the end of the file */
+  got = 0;
+  while (got < len && avail > 0)
+  {
+    n = (avail < len - got) ? avail : len - got;
+    memcpy (r->bounce + got, SLOT_BUF (r, r->cur) + r->pos, n);
+    r->pos += n;
+    got    += n;
+    if (got < len)
+      avail = reader_fill (r);
+  }
+  if (got < len)
+    memset (r->bounce + got, 0, len - got);
+
+  *count = (avail < 0 && got == 0) ? -1 : got;
+  return r->bounce;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_reader_uses_uring
+   DESCRIPTION: TRUE if reads are going through io_uring.
+   ------------------------------------------------------------------- */
+
+int
+rio_reader_uses_uring (rio_reader *r)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+  return (r != NULL && r->ring != NULL);
+#else
+  return FALSE;
+#endif
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_reader_delete
+   DESCRIPTION: Finish outstanding reads and give the buffers back. The
+                file descriptor is left open.
+   ------------------------------------------------------------------- */
+
+void
+rio_reader_delete (rio_reader *r)
+{
+  if (r == NULL)
+    return;
+
+#ifdef HAVE_LINUX_IO_URING_H
+  if (r->ring)
+  {
+    int i;
+
+    /* The kernel may still be writing into the slots */
+    reader_submit (r);
+    for (i = 0; i < RIO_READER_SLOTS; i++)
+      reader_wait (r, i);
+    uring_free (r->ring);
+  }
+#endif
+
+  rio_pool_put_xfer (r->pool, r->buffer);
+  free (r->bounce);
+  free (r);
+}
@@ -0,0 +1,341 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Download sink.
+
+   Songs coming off the Rio used to be written with one write() per bulk
+   read, so the USB pipe sat idle while the disk caught up. The sink
+   hands out slots of one pool transfer buffer: the download loop reads
+   the Rio straight into a slot and commits it, and a writer thread
+   pwrite()s committed slots to their offset in the file. The download
+   only waits when all slots are full.
+
+   The file is truncated on open (overwriting a longer file used to leave
+   its tail behind), preallocated to the song size so it doesn't fragment,
+   and cut to the number of bytes actually received on close. How hard we
+   push the data to disk is up to the caller: not at all, once on close,
+   or after every slot.
+
+   A sink can also be put on an already open file at some offset, which
+   is how a backup archive collects all the songs in one file, or on a
+   pipe (stdout, say). A stream sink write()s every slot as soon as it is
+   committed, so whatever reads the other end gets the song as it comes
+   off the Rio.
+*/
+
+#define _GNU_SOURCE
+#include "librio500.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+struct _rio_sink
+{
+  int              fd;
+  int              own_fd;        /* opened (and closed) by us */
+  int              stream;        /* write() in order, no offsets */
+  unsigned long    base;          /* file offset of the first byte */
+  int              sync;
+  rio_pool        *pool;
+  BYTE            *buffer;
+  int              threaded;
+  pthread_t        thread;
+  pthread_mutex_t  lock;
+  pthread_cond_t   cond;
+  int              head;          /* next slot to hand out */
+  int              tail;          /* next slot to write */
+  int              queued;        /* committed, not yet written */
+  int              done;          /* no more slots coming */
+  int              error;
+  unsigned long    offset;        /* file offset of the next commit */
+  unsigned long    slot_offset[RIO_SINK_SLOTS];
+  int              len[RIO_SINK_SLOTS];
+};
+
+#define SLOT_BUF(k, s)   ((k)->buffer + (s) * RIO_SINK_SLOT_SIZE)
+
+
+/* Write out slot s; returns -1 on error */
+static int
+sink_write_slot (rio_sink *sink, int s)
+{
+  BYTE          *p = SLOT_BUF (sink, s);
+  int            left = sink->len[s];
+  unsigned long  offset = sink->base + sink->slot_offset[s];
+  int            count;
+
+  while (left > 0)
+  {
+    if (sink->stream)
+      count = write (sink->fd, p, left);
+    else
+      count = pwrite (sink->fd, p, left, offset);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return -1;
+    p      += count;
+    offset += count;
+    left   -= count;
+  }
+
+  if (sink->sync == RIO_SYNC_ALWAYS && fdatasync (sink->fd) == -1)
+    return -1;
+
+  return 0;
+}
+
+static void *
+sink_writer (void *data)
+{
+  rio_sink *sink = (rio_sink *) data;
+  int       s, status, failed;
+
+  pthread_mutex_lock (&sink->lock);
+  for (;;)
+  {
+    while (sink->queued == 0 && !sink->done)
+      pthread_cond_wait (&sink->cond, &sink->lock);
+    if (sink->queued == 0)
+      break;
+
+    s = sink->tail;
+    failed = sink->error;
+    pthread_mutex_unlock (&sink->lock);
+
+    /* Keep going after an error so the producer never blocks on us;
+       the error is reported by rio_sink_close */
+    status = failed ? 0 : sink_write_slot (sink, s);
+
+    pthread_mutex_lock (&sink->lock);
+    if (status == -1)
+      sink->error = errno ? errno : EIO;
+    sink->tail = (sink->tail + 1) % RIO_SINK_SLOTS;
+    sink->queued--;
+    pthread_cond_broadcast (&sink->cond);
+  }
+  pthread_mutex_unlock (&sink->lock);
+
+  return NULL;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_sink_open_fd
+   DESCRIPTION: Write size bytes to fd starting at offset. The file is
+                neither truncated nor closed by the sink.
+   ------------------------------------------------------------------- */
+
+rio_sink *
+rio_sink_open_fd (int fd, unsigned long offset, unsigned long size, int sync,
+                  rio_pool *pool)
+{
+  rio_sink *sink;
+
+  sink = calloc (1, sizeof (rio_sink));
+  if (sink == NULL)
+    return NULL;
+
+  sink->buffer = rio_pool_get_xfer (pool);
+  if (sink->buffer == NULL)
+  {
+    free (sink);
+    return NULL;
+  }
+  sink->fd   = fd;
+  sink->base = offset;
+  sink->pool = pool;
+  sink->sync = sync;
+
+  /* Not every filesystem can do this, and it doesn't matter if not */
+  if (size > 0)
+    fallocate (fd, 0, offset, size);
+
+  pthread_mutex_init (&sink->lock, NULL);
+  pthread_cond_init (&sink->cond, NULL);
+  sink->threaded = (pthread_create (&sink->thread, NULL, sink_writer, sink) == 0);
+
+  return sink;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_sink_open
+   DESCRIPTION: Create (or truncate) filename for a download of size
+                bytes. sync is one of RIO_SYNC_NONE, RIO_SYNC_CLOSE or
+                RIO_SYNC_ALWAYS. Returns NULL if the file can't be opened.
+   ------------------------------------------------------------------- */
+
+rio_sink *
+rio_sink_open (char *filename, unsigned long size, int sync, rio_pool *pool)
+{
+  rio_sink *sink;
+  int       fd;
+
+  fd = open (filename, O_WRONLY | O_CREAT | O_TRUNC,
+             S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (fd == -1)
+    return NULL;
+
+  sink = rio_sink_open_fd (fd, 0, size, sync, pool);
+  if (sink == NULL)
+  {
+    close (fd);
+    return NULL;
+  }
+  sink->own_fd = TRUE;
+
+  return sink;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_sink_open_stream
+   DESCRIPTION: Write to fd from wherever it is, in order. Works on pipes
+                and terminals; syncing is only done on regular files.
+                The fd is not closed by the sink.
+   ------------------------------------------------------------------- */
+
+rio_sink *
+rio_sink_open_stream (int fd, int sync, rio_pool *pool)
+{
+  rio_sink    *sink;
+  struct stat  st;
+
+  if (fstat (fd, &st) == -1)
+    return NULL;
+  if (!S_ISREG (st.st_mode))
+    sync = RIO_SYNC_NONE;
+
+  sink = rio_sink_open_fd (fd, 0, 0, sync, pool);
+  if (sink != NULL)
+    sink->stream = TRUE;
+
+  return sink;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_sink_buffer
+   DESCRIPTION: Get the next free slot (RIO_SINK_SLOT_SIZE bytes) to read
+                into, waiting for the writer if they are all in use.
+   ------------------------------------------------------------------- */
+
+BYTE *
+rio_sink_buffer (rio_sink *sink)
+{
+  BYTE *p;
+
+  if (!sink->threaded)
+    return SLOT_BUF (sink, sink->head);
+
+  pthread_mutex_lock (&sink->lock);
+  while (sink->queued == RIO_SINK_SLOTS)
+    pthread_cond_wait (&sink->cond, &sink->lock);
+  p = SLOT_BUF (sink, sink->head);
+  pthread_mutex_unlock (&sink->lock);
+
+  return p;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_sink_commit
+   DESCRIPTION: Queue len bytes of the slot returned by rio_sink_buffer
+                for writing. Returns -1 once a write has failed.
+   ------------------------------------------------------------------- */
+
+int
+rio_sink_commit (rio_sink *sink, int len)
+{
+  int s, status;
+
+  if (len < 0)
+    len = 0;
+
+  if (!sink->threaded)
+  {
+    s = sink->head;
+    sink->len[s] = len;
+    sink->slot_offset[s] = sink->offset;
+    sink->offset += len;
+    if (!sink->error && sink_write_slot (sink, s) == -1)
+      sink->error = errno ? errno : EIO;
+    return sink->error ? -1 : 0;
+  }
+
+  pthread_mutex_lock (&sink->lock);
+  s = sink->head;
+  sink->len[s] = len;
+  sink->slot_offset[s] = sink->offset;
+  sink->offset += len;
+  sink->head = (sink->head + 1) % RIO_SINK_SLOTS;
+  sink->queued++;
+  status = sink->error ? -1 : 0;
+  pthread_cond_broadcast (&sink->cond);
+  pthread_mutex_unlock (&sink->lock);
+
+  return status;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_sink_close
+   DESCRIPTION: Wait for the writer and sync if asked to. A file opened
+                by rio_sink_open is also cut to what was committed and
+                closed. Returns 0 if every byte made it to the file, -1
+                otherwise (errno is set).
+   ------------------------------------------------------------------- */
+
+int
+rio_sink_close (rio_sink *sink)
+{
+  int error;
+
+  if (sink == NULL)
+    return -1;
+
+  if (sink->threaded)
+  {
+    pthread_mutex_lock (&sink->lock);
+    sink->done = TRUE;
+    pthread_cond_broadcast (&sink->cond);
+    pthread_mutex_unlock (&sink->lock);
+    pthread_join (sink->thread, NULL);
+  }
+  pthread_mutex_destroy (&sink->lock);
+  pthread_cond_destroy (&sink->cond);
+
+  error = sink->error;
+  if (sink->own_fd && ftruncate (sink->fd, sink->offset) == -1 && !error)
+    error = errno;
+  if (sink->sync != RIO_SYNC_NONE && fsync (sink->fd) == -1 && !error)
+    error = errno;
+  if (sink->own_fd && close (sink->fd) == -1 && !error)
+    error = errno;
+
+  rio_pool_put_xfer (sink->pool, sink->buffer);
+  free (sink);
+
+  if (error)
+  {
+    errno = error;
+    return -1;
+  }
+  return 0;
+}
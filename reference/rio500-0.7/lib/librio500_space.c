@@ -0,0 +1,263 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Free space model.
+
+   Adding a song used to ask the Rio how much room is left (0x42, 0x50,
+   0x42) up to three times, because it sometimes says 0 when there is
+   room, and then compared the answer with the size of the file in
+   bytes; the flash hands out whole blocks, so a file could pass the
+   check and still not fit. The model reads the block size and the
+   number of unused blocks once per card from 0x57, takes every upload
+   off in whole blocks and is put right again from what the Rio says
+   when the tables are committed (rio_cache_commit reads 0x57 for its
+   stamp anyway). Asking whether a file fits costs nothing.
+
+   Table writes also take and give back blocks; the model doesn't try
+   to follow them, the check at the commit catches up.
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+
+typedef struct
+{
+  int              seeded;
+  DWORD            block_size;
+  DWORD            num_blocks;
+  DWORD            free_blocks;
+} space_card;
+
+struct _rio_space
+{
+  space_card       cards[RIO_CACHE_MAX_CARDS];
+};
+
+
+static space_card *
+space_get_card (rio_space *space, int card)
+{
+  if (space == NULL || card < 0 || card >= RIO_CACHE_MAX_CARDS)
+    return NULL;
+  return &space->cards[card];
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_space_new, rio_space_delete
+   DESCRIPTION: Create an empty free space model, or free one.
+   ------------------------------------------------------------------- */
+
+rio_space *
+rio_space_new (void)
+{
+  return (rio_space *) calloc (1, sizeof (rio_space));
+}
+
+void
+rio_space_delete (rio_space *space)
+{
+  free (space);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_space_load
+   DESCRIPTION: Seed the model of card from the Rio, unless it already
+                is. Returns 0, or -1 if card is out of range or the Rio
+                reports no blocks.
+   ------------------------------------------------------------------- */
+
+int
+rio_space_load (rio_space *space, rio_device rio_dev, int card)
+{
+  space_card *sc;
+
+  sc = space_get_card (space, card);
+  if (sc == NULL)
+    return -1;
+
+  if (!sc->seeded)
+    rio_space_seed (space, card, get_mem_status (rio_dev, card));
+
+  return sc->seeded ? 0 : -1;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_space_seed
+   DESCRIPTION: Take the free space of card from a mem_status the caller
+                already has. Returns how many blocks the model was off
+                by (what the Rio says minus what the model had), 0 if it
+                wasn't seeded before.
+   ------------------------------------------------------------------- */
+
+int
+rio_space_seed (rio_space *space, int card, mem_status *mem)
+{
+  space_card *sc;
+  int         drift;
+
+  sc = space_get_card (space, card);
+  if (sc == NULL || mem == NULL)
+    return 0;
+
+  if (mem->block_size == 0)
+  {
+    sc->seeded = FALSE;
+    return 0;
+  }
+
+  drift = sc->seeded ? (int) mem->num_unused_blocks - (int) sc->free_blocks : 0;
+#ifdef DEBUG
+  if (drift != 0)
+    printf ("card %d: %d blocks more free than counted\n", card, drift);
+#endif
+
+  sc->block_size  = mem->block_size;
+  sc->num_blocks  = mem->num_blocks;
+  sc->free_blocks = mem->num_unused_blocks;
+  sc->seeded      = TRUE;
+
+  return drift;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_space_forget
+   DESCRIPTION: Drop the model of card (-1 for all of them), so the next
+                rio_space_load asks the Rio again. For when something
+                freed blocks the model can't count, like a format.
+   ------------------------------------------------------------------- */
+
+void
+rio_space_forget (rio_space *space, int card)
+{
+  int c;
+
+  if (space == NULL)
+    return;
+
+  for (c = 0; c < RIO_CACHE_MAX_CARDS; c++)
+    if (card == -1 || card == c)
+      space->cards[c].seeded = FALSE;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_space_blocks
+   DESCRIPTION: How many blocks of card bytes take up. 0 if the model
+                isn't seeded.
+   ------------------------------------------------------------------- */
+
+DWORD
+rio_space_blocks (rio_space *space, int card, unsigned long bytes)
+{
+  space_card *sc;
+
+  sc = space_get_card (space, card);
+  if (sc == NULL || !sc->seeded)
+    return 0;
+
+  return (bytes + sc->block_size - 1) / sc->block_size;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_space_free
+   DESCRIPTION: Free blocks on card, as far as the model knows.
+   ------------------------------------------------------------------- */
+
+DWORD
+rio_space_free (rio_space *space, int card)
+{
+  space_card *sc;
+
+  sc = space_get_card (space, card);
+  if (sc == NULL || !sc->seeded)
+    return 0;
+
+  return sc->free_blocks;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_space_left
+   DESCRIPTION: Free bytes on card, in whole blocks.
+   ------------------------------------------------------------------- */
+
+unsigned long
+rio_space_left (rio_space *space, int card)
+{
+  space_card *sc;
+
+  sc = space_get_card (space, card);
+  if (sc == NULL || !sc->seeded)
+    return 0;
+
+  return (unsigned long) sc->free_blocks * sc->block_size;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_space_fits
+   DESCRIPTION: TRUE if bytes fit in the free blocks of card. FALSE if
+                the model isn't seeded.
+   ------------------------------------------------------------------- */
+
+int
+rio_space_fits (rio_space *space, int card, unsigned long bytes)
+{
+  space_card *sc;
+
+  sc = space_get_card (space, card);
+  if (sc == NULL || !sc->seeded)
+    return FALSE;
+
+  return rio_space_blocks (space, card, bytes) <= sc->free_blocks;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_space_take, rio_space_give
+   DESCRIPTION: Count bytes written to card (or released from it) in
+                whole blocks.
+   ------------------------------------------------------------------- */
+
+void
+rio_space_take (rio_space *space, int card, unsigned long bytes)
+{
+  space_card *sc;
+  DWORD       blocks;
+
+  sc = space_get_card (space, card);
+  if (sc == NULL || !sc->seeded)
+    return;
+
+  blocks = rio_space_blocks (space, card, bytes);
+  sc->free_blocks = (blocks < sc->free_blocks) ? sc->free_blocks - blocks : 0;
+}
+
+void
+rio_space_give (rio_space *space, int card, unsigned long bytes)
+{
+  space_card *sc;
+
+  sc = space_get_card (space, card);
+  if (sc == NULL || !sc->seeded)
+    return;
+
+  sc->free_blocks += rio_space_blocks (space, card, bytes);
+  if (sc->free_blocks > sc->num_blocks)
+    sc->free_blocks = sc->num_blocks;
+}
@@ -0,0 +1,825 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Folder and song tables.
+
+   A table keeps its entries back to back in one allocation, in host byte
+   order, the way they sit in the Rio's 0x4000 byte blocks. Getting entry
+   i or the number of entries costs nothing, reading a table is one copy
+   out of the transfer buffer and, on little endian machines, writing one
+   sends the full blocks straight from the table.
+
+   Every table remembers which of its blocks have changed since it was
+   read or last written. The Rio can't take part of a table: a write
+   names the table (0xff00 or the folder's song table) and the number
+   of blocks, and the blocks go to a fresh place whose offset then has
+   to go into the folder entry, so there is no way to send only block
+   3 of a song table. What the dirty blocks do buy is knowing when
+   nothing changed at all; rio_flush_*_table skip the write (and the
+   flash wear) then and fall back to writing the whole table otherwise.
+   Changes made through rio_table_folder/rio_table_song pointers have to
+   be marked with rio_table_touch.
+
+   Tools that only list the Rio's content don't need to change anything,
+   so they can ask for a view instead: the blocks are read straight into
+   one allocation and left exactly as the Rio sent them, and the entries
+   are looked at in place. On big endian machines the numbers are swapped
+   when they are read (rio_song_length and friends), not up front.
+
+   A song entry is 0x800 bytes and 1538 of them are the title bitmap,
+   which nothing that lists songs looks at. A song list keeps a small
+   record per song instead: the numbers, the name (interned in a
+   rio_names, so it is stored once for the whole listing) and a
+   reference to where the entry is. rio_song_bitmap reads the bitmap
+   from the song table again when it is wanted, as long as the table
+   hasn't moved since the list was made. The blocks themselves only
+   live in a pooled transfer buffer while the list is made.
+
+   read/write_folder_entries and read/write_song_entries are kept for the
+   tools and the API; they turn tables into GLists of separately
+   allocated entries and back.
+*/
+
+#include "librio500.h"
+
+#include <string.h>
+
+#define ENTRIES_PER_BLOCK           (FOLDER_BLOCK_SIZE / RIO_ENTRY_SIZE)
+#define DIRTY_ALL                   0xffffffff
+
+/* Mark the blocks holding entries from up to (not including) to */
+static void
+table_mark (rio_table *table, int from, int to)
+{
+  int block;
+
+  if (to <= from)
+    to = from + 1;
+  for (block = from / ENTRIES_PER_BLOCK; block <= (to - 1) / ENTRIES_PER_BLOCK; block++)
+    table->dirty |= (DWORD) 1 << (block < 31 ? block : 31);
+}
+
+
+/* -------------------------------------------------------------------
+   NAME:        rio_table_new
+   DESCRIPTION: Create an empty table of type RIO_TABLE_FOLDERS or
+                RIO_TABLE_SONGS with room for size entries.
+   ------------------------------------------------------------------- */
+
+rio_table *
+rio_table_new (int type, int size)
+{
+  rio_table *table;
+
+  table = calloc (1, sizeof (rio_table));
+  if (table == NULL)
+    return NULL;
+
+  table->type  = type;
+  table->size  = (size > 0) ? size : ENTRIES_PER_BLOCK;
+  table->dirty = DIRTY_ALL;       /* nothing on the Rio looks like it yet */
+  table->entries = calloc (table->size, RIO_ENTRY_SIZE);
+  if (table->entries == NULL)
+  {
+    free (table);
+    return NULL;
+  }
+
+  return table;
+}
+
+void
+rio_table_delete (rio_table *table)
+{
+  if (table == NULL)
+    return;
+  free (table->entries);
+  free (table);
+}
+
+static int
+table_grow (rio_table *table, int count)
+{
+  BYTE *entries;
+  int   size;
+
+  if (count <= table->size)
+    return 0;
+
+  size = table->size * 2;
+  if (size < count)
+    size = count;
+  entries = realloc (table->entries, size * RIO_ENTRY_SIZE);
+  if (entries == NULL)
+    return -1;
+  memset (entries + table->size * RIO_ENTRY_SIZE, 0,
+          (size - table->size) * RIO_ENTRY_SIZE);
+
+  table->entries = entries;
+  table->size = size;
+  return 0;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_table_insert
+   DESCRIPTION: Copy entry into the table at position i (count appends).
+                Returns i, or -1 if out of memory or range.
+   ------------------------------------------------------------------- */
+
+int
+rio_table_insert (rio_table *table, int i, void *entry)
+{
+  if (i < 0 || i > table->count || table_grow (table, table->count + 1) == -1)
+    return -1;
+
+  if (i < table->count)
+    memmove (rio_table_entry (table, i + 1), rio_table_entry (table, i),
+             (table->count - i) * RIO_ENTRY_SIZE);
+  memcpy (rio_table_entry (table, i), entry, RIO_ENTRY_SIZE);
+  table->count++;
+  table_mark (table, i, table->count);
+
+  return i;
+}
+
+int
+rio_table_append (rio_table *table, void *entry)
+{
+  return rio_table_insert (table, table->count, entry);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_table_remove
+   DESCRIPTION: Drop entry i, moving the ones after it up.
+   ------------------------------------------------------------------- */
+
+int
+rio_table_remove (rio_table *table, int i)
+{
+  if (i < 0 || i >= table->count)
+    return -1;
+
+  table->count--;
+  if (i < table->count)
+    memmove (rio_table_entry (table, i), rio_table_entry (table, i + 1),
+             (table->count - i) * RIO_ENTRY_SIZE);
+  memset (rio_table_entry (table, table->count), 0, RIO_ENTRY_SIZE);
+  table_mark (table, i, table->count + 1);
+
+  return 0;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_table_touch
+   DESCRIPTION: Note that entry i has been changed in place.
+   ------------------------------------------------------------------- */
+
+void
+rio_table_touch (rio_table *table, int i)
+{
+  if (i >= 0 && i < table->count)
+    table_mark (table, i, i + 1);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_table_from_list, rio_table_to_list
+   DESCRIPTION: Convert between a table and a GList of entries. The list
+                gets its own copy of every entry.
+   ------------------------------------------------------------------- */
+
+rio_table *
+rio_table_from_list (int type, GList *list)
+{
+  rio_table *table;
+  GList     *item;
+
+  table = rio_table_new (type, g_list_length (list));
+  if (table == NULL)
+    return NULL;
+
+  for (item = g_list_first (list); item; item = item->next)
+    rio_table_append (table, item->data);
+
+  return table;
+}
+
+GList *
+rio_table_to_list (rio_table *table)
+{
+  GList *list = NULL;
+  void  *copy;
+  int    i;
+
+  if (table == NULL)
+    return NULL;
+
+  /* prepend backwards: g_list_append would walk the list every time */
+  for (i = table->count - 1; i >= 0; i--)
+  {
+    copy = malloc (RIO_ENTRY_SIZE);
+    if (copy == NULL)
+      continue;
+    memcpy (copy, rio_table_entry (table, i), RIO_ENTRY_SIZE);
+    list = g_list_prepend (list, copy);
+  }
+
+  return list;
+}
+
+/* The entries end at the first unused one. offset is the first field
+   of both entry types, and 0xffff either way round. */
+static int
+table_count_entries (BYTE *blocks, int max_entries)
+{
+  WORD offset;
+  int  count;
+
+  for (count = 0; count < max_entries; count++)
+  {
+    memcpy (&offset, blocks + count * RIO_ENTRY_SIZE, sizeof (WORD));
+    if (offset == 0xffff)
+      break;
+  }
+
+  return count;
+}
+
+/* Read num_blocks at address and keep up to max_entries of them */
+static rio_table *
+table_read (rio_device rio_dev, int type, int address, int num_blocks,
+            int max_entries, int card)
+{
+  rio_table     *table;
+  BYTE          *block;
+  unsigned long  com_status;
+  int            size, total_read, count;
+
+  size = num_blocks * FOLDER_BLOCK_SIZE;
+  if (size > RIO_XFER_SIZE)
+    return NULL;
+
+  block = rio_pool_get_xfer (NULL);
+  if (block == NULL)
+    return NULL;
+
+  com_status = send_read_command (rio_dev, address, num_blocks, card);
+  if (com_status == -1)
+  {
+    rio_pool_put_xfer (NULL, block);
+    return NULL;
+  }
+
+  total_read = bulk_read (rio_dev, block, size);
+  if (total_read != size)
+  {
+    rio_pool_put_xfer (NULL, block);
+    return NULL;
+  }
+
+  count = table_count_entries (block, max_entries);
+  table = rio_table_new (type, count);
+  if (table != NULL)
+  {
+    memcpy (table->entries, block, count * RIO_ENTRY_SIZE);
+    table->count = count;
+    table->dirty = 0;
+    rio_codec_entries (type, table->entries, count);
+  }
+
+  rio_pool_put_xfer (NULL, block);
+  return table;
+}
+
+/* Write a table to address, 8 entries per block */
+static void
+table_write (rio_device rio_dev, int address, rio_table *table, int card)
+{
+  BYTE *block;
+  int   num_blocks, full_blocks, count, i;
+
+  count = (table != NULL) ? table->count : 0;
+  if (table != NULL)
+    table->dirty = 0;
+
+  /* If there are no entries just send a blank block */
+  num_blocks = (count + ENTRIES_PER_BLOCK - 1) / ENTRIES_PER_BLOCK;
+  if (num_blocks == 0)
+    num_blocks = 1;
+  full_blocks = count / ENTRIES_PER_BLOCK;
+
+  send_write_command (rio_dev, address, num_blocks, card);
+
+#ifndef WORDS_BIGENDIAN
+  /* Whole blocks go out as they are */
+  for (i = 0; i < full_blocks; i++)
+    bulk_write (rio_dev, table->entries + i * FOLDER_BLOCK_SIZE, FOLDER_BLOCK_SIZE);
+#else
+  full_blocks = 0;
+#endif
+
+  if (full_blocks == num_blocks)
+    return;
+
+  block = rio_pool_get_block (NULL);
+  for (i = full_blocks * ENTRIES_PER_BLOCK; i < count; i++)
+  {
+    memcpy (block + (i % ENTRIES_PER_BLOCK) * RIO_ENTRY_SIZE,
+            rio_table_entry (table, i), RIO_ENTRY_SIZE);
+    if (i % ENTRIES_PER_BLOCK == ENTRIES_PER_BLOCK - 1)
+    {
+      rio_codec_entries (table->type, block, ENTRIES_PER_BLOCK);
+      bulk_write (rio_dev, block, FOLDER_BLOCK_SIZE);
+      clear_block (block);
+    }
+  }
+
+  /* The last block if it was not full (or the blank one, which has
+     nothing to convert and may come with no table at all) */
+  if (count % ENTRIES_PER_BLOCK != 0)
+    rio_codec_entries (table->type, block, count % ENTRIES_PER_BLOCK);
+  if (count % ENTRIES_PER_BLOCK != 0 || count == 0)
+    bulk_write (rio_dev, block, FOLDER_BLOCK_SIZE);
+
+  rio_pool_put_block (NULL, block);
+}
+
+static int
+song_address (int folder_num)
+{
+  return ((folder_num << 8) | 0x00ff) & 0xffff;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_read_folder_table
+   DESCRIPTION: Read the folder table of a card. NULL on error.
+   ------------------------------------------------------------------- */
+
+rio_table *
+rio_read_folder_table (rio_device rio_dev, int card)
+{
+  unsigned long folder_block_count;
+
+  /* Determine number of folder blocks */
+  folder_block_count = get_num_folder_blocks (rio_dev, 0xff00, card);
+  if (folder_block_count == -1)
+    return NULL;
+
+  return table_read (rio_dev, RIO_TABLE_FOLDERS, 0xff00, folder_block_count,
+                     ENTRIES_PER_BLOCK * folder_block_count, card);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_read_song_table
+   DESCRIPTION: Read the song table of folder folder_num, whose entry in
+                the folder table is folder. An empty folder gives an
+                empty table; NULL means the read failed.
+   ------------------------------------------------------------------- */
+
+rio_table *
+rio_read_song_table (rio_device rio_dev, folder_entry *folder, int folder_num, int card)
+{
+  rio_table *table;
+  int        num_blocks, count;
+
+  if (folder == NULL)
+    return NULL;
+
+  /* Calculate how many blocks this folder uses up */
+  count = folder->fst_free_entry_off / RIO_ENTRY_SIZE;
+  num_blocks = (folder->fst_free_entry_off + FOLDER_BLOCK_SIZE - 1) / FOLDER_BLOCK_SIZE;
+
+  if (num_blocks == 0)
+  {
+    table = rio_table_new (RIO_TABLE_SONGS, 0);
+    if (table != NULL)
+      table->dirty = 0;
+    return table;
+  }
+
+  return table_read (rio_dev, RIO_TABLE_SONGS, song_address (folder_num),
+                     num_blocks, count, card);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_write_folder_table, rio_write_song_table
+   DESCRIPTION: Write a table back. A NULL or empty table writes one
+                blank block.
+   ------------------------------------------------------------------- */
+
+void
+rio_write_folder_table (rio_device rio_dev, rio_table *table, int card)
+{
+  table_write (rio_dev, 0xff00, table, card);
+}
+
+void
+rio_write_song_table (rio_device rio_dev, int folder_num, rio_table *table, int card)
+{
+  table_write (rio_dev, song_address (folder_num), table, card);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_flush_folder_table, rio_flush_song_table
+   DESCRIPTION: Write a table back if anything in it has changed.
+                Returns TRUE if it was written, FALSE if there was no
+                need to (and so no new table offset to pick up).
+   ------------------------------------------------------------------- */
+
+int
+rio_flush_folder_table (rio_device rio_dev, rio_table *table, int card)
+{
+  if (table != NULL && !rio_table_is_dirty (table))
+    return FALSE;
+  rio_write_folder_table (rio_dev, table, card);
+  return TRUE;
+}
+
+int
+rio_flush_song_table (rio_device rio_dev, int folder_num, rio_table *table, int card)
+{
+  if (table != NULL && !rio_table_is_dirty (table))
+    return FALSE;
+  rio_write_song_table (rio_dev, folder_num, table, card);
+  return TRUE;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_last_write
+   DESCRIPTION: Wait for the last write to finish and return the offset
+                it went to, which is what the folder entry (for a song
+                table) or send_folder_location (for the folder table)
+                wants.
+   ------------------------------------------------------------------- */
+
+int
+rio_last_write (rio_device rio_dev)
+{
+  send_command (rio_dev, 0x42, 0, 0);
+  send_command (rio_dev, 0x42, 0, 0);
+  return send_command (rio_dev, 0x43, 0x0, 0x0);
+}
+
+
+/* Read-only views */
+
+static rio_view *
+view_read (rio_device rio_dev, int type, int address, int num_blocks,
+           int max_entries, int card)
+{
+  rio_view *view;
+  int       size;
+
+  size = num_blocks * FOLDER_BLOCK_SIZE;
+  if (size > RIO_XFER_SIZE)
+    return NULL;
+
+  view = malloc (sizeof (rio_view) + size);
+  if (view == NULL)
+    return NULL;
+  view->type   = type;
+  view->count  = 0;
+  view->blocks = (BYTE *) (view + 1);
+
+  if (size == 0)
+    return view;
+
+  if (send_read_command (rio_dev, address, num_blocks, card) == -1
+      || bulk_read (rio_dev, view->blocks, size) != size)
+  {
+    free (view);
+    return NULL;
+  }
+  view->count = table_count_entries (view->blocks, max_entries);
+
+  return view;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_read_folder_view
+   DESCRIPTION: Read the folder table of a card without unpacking it.
+                NULL on error. Free with rio_view_delete.
+   ------------------------------------------------------------------- */
+
+rio_view *
+rio_read_folder_view (rio_device rio_dev, int card)
+{
+  unsigned long folder_block_count;
+
+  folder_block_count = get_num_folder_blocks (rio_dev, 0xff00, card);
+  if (folder_block_count == -1)
+    return NULL;
+
+  return view_read (rio_dev, RIO_TABLE_FOLDERS, 0xff00, folder_block_count,
+                    ENTRIES_PER_BLOCK * folder_block_count, card);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_read_song_view
+   DESCRIPTION: Same for the songs of folder folder_num of folders.
+   ------------------------------------------------------------------- */
+
+rio_view *
+rio_read_song_view (rio_device rio_dev, rio_view *folders, int folder_num, int card)
+{
+  WORD used;
+
+  if (folders == NULL || folder_num < 0 || folder_num >= folders->count)
+    return NULL;
+
+  used = RIO_LE16 (rio_view_folder (folders, folder_num)->fst_free_entry_off);
+
+  return view_read (rio_dev, RIO_TABLE_SONGS, song_address (folder_num),
+                    (used + FOLDER_BLOCK_SIZE - 1) / FOLDER_BLOCK_SIZE,
+                    used / RIO_ENTRY_SIZE, card);
+}
+
+void
+rio_view_delete (rio_view *view)
+{
+  free (view);
+}
+
+
+/* Compact song lists */
+
+#define NAMES_CHUNK                 0x1000
+
+struct _rio_names
+{
+  GHashTable      *table;
+  GList           *chunks;
+  char            *next;          /* free space in the first chunk */
+  int              left;
+};
+
+/* -------------------------------------------------------------------
+   NAME:        rio_names_new
+   DESCRIPTION: Create an empty name pool.
+   ------------------------------------------------------------------- */
+
+rio_names *
+rio_names_new (void)
+{
+  rio_names *names;
+
+  names = calloc (1, sizeof (rio_names));
+  if (names == NULL)
+    return NULL;
+  names->table = g_hash_table_new (g_str_hash, g_str_equal);
+
+  return names;
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_names_intern
+   DESCRIPTION: The pool's copy of name (at most max_len bytes of it,
+                it needn't be terminated within them). Every call with
+                the same name gets the same pointer. NULL if out of
+                memory.
+   ------------------------------------------------------------------- */
+
+const char *
+rio_names_intern (rio_names *names, const char *name, int max_len)
+{
+  char  key[RIO_ENTRY_SIZE];
+  char *copy, *chunk;
+  int   len, size;
+
+  for (len = 0; len < max_len && len < RIO_ENTRY_SIZE - 1 && name[len]; len++)
+    ;
+  memcpy (key, name, len);
+  key[len] = '\0';
+
+  copy = (char *) g_hash_table_lookup (names->table, key);
+  if (copy != NULL)
+    return copy;
+
+  if (len + 1 > names->left)
+  {
+    size = (len + 1 > NAMES_CHUNK) ? len + 1 : NAMES_CHUNK;
+    chunk = malloc (size);
+    if (chunk == NULL)
+      return NULL;
+    names->chunks = g_list_prepend (names->chunks, chunk);
+    names->next = chunk;
+    names->left = size;
+  }
+
+  copy = names->next;
+  memcpy (copy, key, len + 1);
+  names->next += len + 1;
+  names->left -= len + 1;
+  g_hash_table_insert (names->table, copy, copy);
+
+  return copy;
+}
+
+void
+rio_names_delete (rio_names *names)
+{
+  GList *item;
+
+  if (names == NULL)
+    return;
+
+  for (item = names->chunks; item; item = item->next)
+    free (item->data);
+  g_list_free (names->chunks);
+  g_hash_table_destroy (names->table);
+  free (names);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_read_song_list
+   DESCRIPTION: Read the songs of folder folder_num of folders, keeping
+                a rio_song_info for each. The names go into names.
+                NULL on error. Free with rio_song_list_delete.
+   ------------------------------------------------------------------- */
+
+rio_song_list *
+rio_read_song_list (rio_device rio_dev, rio_view *folders, int folder_num,
+                    int card, rio_names *names)
+{
+  rio_song_list    *list;
+  rio_song_info    *info;
+  const song_entry *entry;
+  BYTE             *block;
+  WORD              used;
+  int               i, count, num_blocks, size;
+
+  if (folders == NULL || names == NULL || folder_num < 0
+      || folder_num >= folders->count || folder_num > 0xff)
+    return NULL;
+
+  used = RIO_LE16 (rio_view_folder (folders, folder_num)->fst_free_entry_off);
+  count = used / RIO_ENTRY_SIZE;
+  num_blocks = (used + FOLDER_BLOCK_SIZE - 1) / FOLDER_BLOCK_SIZE;
+  size = num_blocks * FOLDER_BLOCK_SIZE;
+  if (size > RIO_XFER_SIZE)
+    return NULL;
+
+  list = malloc (sizeof (rio_song_list) + count * sizeof (rio_song_info));
+  if (list == NULL)
+    return NULL;
+  list->count = 0;
+  list->songs = (rio_song_info *) (list + 1);
+
+  if (num_blocks == 0)
+    return list;
+
+  block = rio_pool_get_xfer (NULL);
+  if (block == NULL
+      || send_read_command (rio_dev, song_address (folder_num), num_blocks, card) == -1
+      || bulk_read (rio_dev, block, size) != size)
+  {
+    rio_pool_put_xfer (NULL, block);
+    free (list);
+    return NULL;
+  }
+
+  count = table_count_entries (block, count);
+  for (i = 0; i < count; i++)
+  {
+    entry = (const song_entry *) (block + i * RIO_ENTRY_SIZE);
+    info  = &list->songs[i];
+
+    info->offset = rio_song_offset (entry);
+    info->length = rio_song_length (entry);
+    info->time   = rio_song_time (entry);
+    info->mp3sig = (DWORD) RIO_LE32 (entry->mp3sig);
+    info->name   = rio_names_intern (names, (const char *) entry->name1,
+                                     sizeof (entry->name1));
+    if (info->name == NULL)
+      break;
+
+    info->bitmap.table_offset = rio_folder_offset (rio_view_folder (folders, folder_num));
+    info->bitmap.card         = card;
+    info->bitmap.folder       = folder_num;
+    info->bitmap.song         = i;
+  }
+  list->count = i;
+
+  rio_pool_put_xfer (NULL, block);
+  return list;
+}
+
+void
+rio_song_list_delete (rio_song_list *list)
+{
+  free (list);
+}
+
+/* -------------------------------------------------------------------
+   NAME:        rio_song_bitmap
+   DESCRIPTION: Fetch the title bitmap of the song ref points to. folders
+                is the folder table as it is now. Only the song table
+                blocks up to the one holding the entry are read. Returns
+                0, or -1 if the table has moved since the list was made
+                or the read failed.
+   ------------------------------------------------------------------- */
+
+int
+rio_song_bitmap (rio_device rio_dev, rio_view *folders, rio_bitmap_ref *ref,
+                 rio_bitmap_data *bitmap)
+{
+  const folder_entry *folder;
+  const song_entry   *entry;
+  BYTE               *block;
+  int                 num_blocks, size, status;
+
+  if (folders == NULL || ref == NULL || ref->folder >= folders->count)
+    return -1;
+
+  folder = rio_view_folder (folders, ref->folder);
+  if (rio_folder_offset (folder) != ref->table_offset
+      || ref->song >= rio_folder_num_songs (folder))
+    return -1;
+
+  num_blocks = ref->song / ENTRIES_PER_BLOCK + 1;
+  size = num_blocks * FOLDER_BLOCK_SIZE;
+
+  block = rio_pool_get_xfer (NULL);
+  if (block == NULL)
+    return -1;
+
+  status = -1;
+  if (send_read_command (rio_dev, song_address (ref->folder), num_blocks, ref->card) != -1
+      && bulk_read (rio_dev, block, size) == size)
+  {
+    entry = (const song_entry *) (block + ref->song * RIO_ENTRY_SIZE);
+    memcpy (bitmap, &entry->bitmap, sizeof (rio_bitmap_data));
+    status = 0;
+  }
+
+  rio_pool_put_xfer (NULL, block);
+  return status;
+}
+
+
+/* GList adapters */
+
+GList *
+read_folder_entries (rio_device rio_dev, int card)
+{
+  rio_table *table;
+  GList     *list;
+
+  table = rio_read_folder_table (rio_dev, card);
+  list = rio_table_to_list (table);
+  rio_table_delete (table);
+
+  return list;
+}
+
+GList *
+read_song_entries (rio_device rio_dev, GList *folder_entries, int folder_num, int card)
+{
+  rio_table *table;
+  GList     *list;
+
+  table = rio_read_song_table (rio_dev,
+                               (folder_entry *) g_list_nth_data (folder_entries, folder_num),
+                               folder_num, card);
+  list = rio_table_to_list (table);
+  rio_table_delete (table);
+
+  return list;
+}
+
+void
+write_folder_entries (rio_device rio_dev, GList *folder_list, int card)
+{
+  rio_table *table;
+
+  table = rio_table_from_list (RIO_TABLE_FOLDERS, folder_list);
+  rio_write_folder_table (rio_dev, table, card);
+  rio_table_delete (table);
+}
+
+void
+write_song_entries (rio_device rio_dev, int folder_num, GList *song_list, int card)
+{
+  rio_table *table;
+
+  table = rio_table_from_list (RIO_TABLE_SONGS, song_list);
+  rio_write_song_table (rio_dev, folder_num, table, card);
+  rio_table_delete (table);
+}
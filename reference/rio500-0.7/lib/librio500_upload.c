@@ -0,0 +1,123 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+/*
+   Song data upload.
+
+   Pushes size bytes from a reader into the Rio's flash and returns where
+   the Rio put them. Song and folder tables are not touched: the caller
+   adds the song entry and commits the tables, which lets several songs
+   go up before the tables are written once.
+*/
+
+#include "librio500.h"
+
+
+/* -------------------------------------------------------------------
+   NAME:        rio_upload_song
+   DESCRIPTION: Send size bytes from reader to the Rio. Returns the song
+                location (offset of the last write).
+   ------------------------------------------------------------------- */
+
+int
+rio_upload_song (rio_device rio_dev, rio_reader *reader, unsigned long size,
+                 int card, rio_progress_func progress)
+{
+  int  j, total, count, num_blocks, remainder, blocks_left;
+  int  num_chunks, song_location;
+  BYTE *p;
+
+  num_blocks = size / 0x10000;
+  remainder  = size % 0x10000;
+
+  /* First send num_chunks, blocks at a time */
+  num_chunks = 0x10;
+  total = 0;
+  blocks_left = num_blocks - num_chunks;
+
+  send_command (rio_dev, 0x4f, 0xffff, card);
+  while (blocks_left > 0)
+  {
+    send_command (rio_dev, 0x46, num_chunks, 0);
+    for (j = 0; j < num_chunks / 2; j++)
+    {
+      p = rio_reader_next (reader, 0x20000, &count);
+      total += count;
+      if (count != 0x20000)
+        printf ("[Short read!]");
+      bulk_write (rio_dev, p, 0x20000);
+      if (progress)
+        (*progress) (total, size);
+    }
+    blocks_left -= num_chunks;
+    // Send a 0x42.
+    send_command (rio_dev, 0x42, 0, 0);
+    send_command (rio_dev, 0x42, 0, 0);
+  }
+
+  /* Send remaining blocks */
+  blocks_left += num_chunks;
+  send_command (rio_dev, 0x46, blocks_left, 0);
+  while (blocks_left > 0)
+  {
+    p = rio_reader_next (reader, 0x10000, &count);
+    total += count;
+    if (count != 0x10000)
+      printf ("[Short read!]");
+    bulk_write (rio_dev, p, 0x10000);
+    if (progress)
+      (*progress) (total, size);
+    blocks_left--;
+    send_command (rio_dev, 0x42, 0, 0);
+    send_command (rio_dev, 0x42, 0, 0);
+  }
+
+  /* Send last block */
+  p = rio_reader_next (reader, remainder, &count);
+  j = remainder;
+  total += count;
+  while (j > 0)
+  {
+    if (j > 0x4000)
+    {
+      send_command (rio_dev, 0x46, 00, 0x4000);
+      bulk_write (rio_dev, p, 0x4000);
+    } else {
+      send_command (rio_dev, 0x46, 00, j);
+      bulk_write (rio_dev, p, j);
+    }
+    j -= 0x4000;
+    p += 0x4000;
+    send_command (rio_dev, 0x42, 0, 0);
+    send_command (rio_dev, 0x42, 0, 0);
+  }
+  if (progress && remainder > 0)
+    (*progress) (total, size);
+
+  send_command (rio_dev, 0x42, 0, 0);
+  send_command (rio_dev, 0x42, 0, 0);
+  song_location = send_command (rio_dev, 0x43, 0, 0);
+
+#ifdef DEBUG
+  fprintf (stderr, "Wrote song to offset 0x%04x\n", song_location);
+#endif
+
+  return song_location;
+}
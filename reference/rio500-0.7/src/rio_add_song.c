@@ -53,6 +53,8 @@ int   write_song (int rio_dev, char *filename, int card_number);
 int   write_song (struct usbdevice *rio_dev, char *filename, int card_number);
 #endif
 int   file_size (char *filename);
+int   space_fits (rio_space *space, rio_device rio_dev, int card, int size);
+void  show_dot (unsigned long done, unsigned long total);
 char *strip_path (char *f);
 #ifdef USE_ID3_TAGS
 void
@@ -70,6 +72,7 @@ static int mp3_read_byte(unsigned long *fhp, FILE *fp);
 
 char *font_name = DEFAULT_FONT_PATH;
 char *temp_name;
+int   bytes_sent = 0;
 
 /* Support for displaying id3 tag information
  *   There codes are very experimental, will safely be changed... */
@@ -141,11 +144,12 @@ return;
 int
 main(int argc, char *argv[])
 {
-  int               retries, song_location, new_size;
+  int               song_location, new_size;
   int               folder_block_offset, song_block_offset;
   int               folder_num, font_number, card_number, card_auto;
-  int 		    mem_left,filesize,card_changed;
+  int 		    filesize,card_changed;
   GList            *folders, *songs;
+  rio_space        *space;
   mem_status       *mem;
   folder_entry     *f_entry;
   char             *filename;
@@ -168,8 +172,8 @@ main(int argc, char *argv[])
   card_auto = 0;
   folder_num = 0;
   font_number = 0;
-  mem_left = 0;
   folders = NULL;
+  space = rio_space_new ();
 
 #ifdef USE_ID3_TAGS
   get_some_switches(argc,argv,&font_number,&folder_num,
@@ -194,6 +198,9 @@ main(int argc, char *argv[])
         font_name=temp_name;
   }
 
+  /* Parse the font once, before the titles of all the songs */
+  rio_font_preload (font_name, font_number);
+
   /* Open connection to rio */
 #ifndef WITH_USBDEVFS
   rio_dev = open (DEFAULT_DEV_PATH, O_RDWR);
@@ -219,19 +226,9 @@ main(int argc, char *argv[])
   {
         filename = argv[optind++];
 
- /* Make sure there's enough space left */
-   /* Sometimes quert_mem_left returns 0 but there really is space in
-      the device. So... try 3 times and make sure that it really is
-      returning 0. */
-   retries = 3;
-   while (retries-- > 0)
-   {
-     mem_left = query_mem_left (rio_dev,card_number);
-     send_command(rio_dev,0x42,0,0);
-     if (mem_left > 0) break;
-   }
+   /* Make sure there's enough space left, in whole blocks */
      filesize = file_size(filename);
-     if (filesize > mem_left && card_auto && card_number==0) {
+     if (!space_fits (space, rio_dev, card_number, filesize) && card_auto && card_number==0) {
         printf("\nNot enough room in internal memory\n");
 	printf("Autofill has been set\n");
 	printf("Trying external smartmedia card\n");
@@ -239,17 +236,14 @@ main(int argc, char *argv[])
 	folder_num = 0;	
 	card_number++;
 	card_changed = 1;
-	mem_left = query_mem_left(rio_dev,card_number);
      }
-   if (filesize > mem_left)
+   if (!space_fits (space, rio_dev, card_number, filesize))
    {
       printf ("Not enough space left in rio for %s.\n",filename);
       goto try_next;
       finish_communication (rio_dev);
       exit (0);
    }
-   
-   mem_left -= filesize;
 
    /* Read folder & song block */
    folders = read_folder_entries (rio_dev,card_number);
@@ -270,6 +264,12 @@ main(int argc, char *argv[])
    songs   = read_song_entries ( rio_dev, folders, folder_num,card_number); 
    /* Write the song to the Rio */
    song_location = write_song (rio_dev, filename,card_number);
+   if (song_location < 0)
+   {
+      printf ("Couldn't read %s, skipped.\n", filename);
+      goto try_next;
+   }
+   rio_space_take (space, card_number, filesize);
    
    /* Add an entry to the song block */
 #ifdef USE_ID3_TAGS
@@ -332,6 +332,7 @@ try_next:
 #ifndef WITH_USBDEVFS
    close (rio_dev);
 #endif
+   rio_space_delete (space);
    exit (0);
 }
 
@@ -683,105 +684,45 @@ write_song (struct usbdevice *rio_dev, char *filename, int card)
 #endif
 {
   int input_file;
-  int  i, j, size;
-  int  total, count, num_blocks, remainder, blocks_left;
-  BYTE *block, *p;
-  int num_chunks, song_location;
-
-  block = (char *)malloc (0x80000);
+  int size, song_location;
+  rio_reader *reader;
 
-  i = 0;
   input_file = open (filename, O_RDONLY);
   if (input_file == -1)
     return -1;
 
   size = file_size (filename);
 
-  num_blocks = size / 0x10000;
-  remainder  = size % 0x10000;
-
-  printf ("Transfering file: %s  ", filename);
-  fflush (stdout);
-
-  /* First send num_chunks, blocks at a time */
-  num_chunks = 0x10;
-  total = 0;
-  blocks_left = num_blocks - num_chunks;
- 
-  send_command (rio_dev, 0x4f, 0xffff, card);
-  while (blocks_left > 0)
+  reader = rio_reader_new (input_file, 0, size, NULL);
+  if (reader == NULL)
   {
-    send_command (rio_dev, 0x46, num_chunks, 0);
-    for (j=0;j<num_chunks / 2;j++)
-    {
-      count = read (input_file, block, 0x20000);
-      total += count;
-      if (count != 0x20000)
-        printf ("[Short read!]");
-      bulk_write (rio_dev, block, 0x20000);
-      printf (".");
-      fflush (stdout);
-    }
-    blocks_left -= num_chunks; 
-    // Send a 0x42.
-    send_command (rio_dev, 0x42, 0, 0);
-    send_command (rio_dev, 0x42, 0, 0);
-  }
-
-  /* Send remaining blocks */
-  blocks_left += num_chunks;
-  //send_command (rio_dev, 0x4f, 0xffff, card);
-  send_command (rio_dev, 0x46, blocks_left, 0);
-  while (blocks_left > 0)
-  {
-    count = read (input_file, block, 0x10000);
-    total += count;
-    if (count != 0x10000)
-      printf ("[Short read!]");
-    bulk_write (rio_dev, block, 0x10000);
-    printf (".");
-    fflush (stdout);
-    blocks_left--;
-    send_command (rio_dev, 0x42, 0, 0);
-    send_command (rio_dev, 0x42, 0, 0);
+    close (input_file);
+    return -1;
   }
 
-  /* Send last block */
-  count = read (input_file, block, remainder);
-  j = remainder;
-  total += count;
-  p = block;
-  while (j > 0)
-  {
-    if (j > 0x4000)
-    {
-      //send_command (rio_dev, 0x4f, 0xffff, card);
-      send_command (rio_dev, 0x46, 00, 0x4000);
-      bulk_write (rio_dev, p, 0x4000);
-    } else {
-      //send_command (rio_dev, 0x4f, 0xffff, card);
-      send_command (rio_dev, 0x46, 00, j);
-      bulk_write (rio_dev, p, j);
-    }
-    j -= 0x4000;
-    p += 0x4000;
-    send_command (rio_dev, 0x42, 0, 0);
-    send_command (rio_dev, 0x42, 0, 0);
-  }
+  printf ("Transfering file: %s  ", filename);
+  fflush (stdout);
 
-  send_command (rio_dev, 0x42, 0, 0);
-  send_command (rio_dev, 0x42, 0, 0);
-  song_location = send_command (rio_dev, 0x43, 0, 0);
-  printf (" (done. Transfered %d bytes.)\n", total);
+  bytes_sent = 0;
+  song_location = rio_upload_song (rio_dev, reader, size, card, show_dot);
+  printf (" (done. Transfered %d bytes.)\n", bytes_sent);
   fflush (stdout);
 
-#ifdef DEBUG
-  fprintf (stderr, "Wrote song to offset 0x%04x\n", song_location);
-#endif
+  rio_reader_delete (reader);
+  close (input_file);
 
   return song_location;
 }
 
+/* Progress callback for rio_upload_song: one dot per chunk */
+void
+show_dot (unsigned long done, unsigned long total)
+{
+  bytes_sent = done;
+  printf (".");
+  fflush (stdout);
+}
+
 char *
 strip_path (char *f)
 {
@@ -825,6 +766,21 @@ file_size (char *filename)
   return size;
 }
 
+/* Does size fit on card? The free blocks are read once per card and
+   counted down as songs go up; the Rio is only asked again when the
+   count says no, in case the table writes gave some back. */
+int
+space_fits (rio_space *space, rio_device rio_dev, int card, int size)
+{
+  if (rio_space_load (space, rio_dev, card) == 0
+      && rio_space_fits (space, card, size))
+    return TRUE;
+
+  rio_space_forget (space, card);
+  return (rio_space_load (space, rio_dev, card) == 0
+          && rio_space_fits (space, card, size));
+}
+
 #ifdef USE_ID3_TAGS
 static char const shortopts[] = "d:xaF:f:n:hv";
 #else
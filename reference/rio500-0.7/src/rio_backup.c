@@ -0,0 +1,192 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "librio500_backup.h"
+#include "getopt.h"
+
+void get_some_switches (int argc, char *argv[], int *backup_internal, int *backup_external);
+void usage (char *progname);
+
+void
+usage (char *progname)
+{
+  printf ("\nusage: %s [OPTIONS] <archive>\n", progname);
+  printf ("\n");
+  printf ("\n Saves every folder and song on the Rio into <archive>.\n");
+  printf (" Use rio_restore to put them back.\n");
+  printf ("\n");
+  return;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int backup_internal = 0;
+  int backup_external = 0;
+  int cards[2];
+  int num_cards = 0;
+  int fd, status;
+
+#ifndef WITH_USBDEVFS
+  int rio_dev;
+#else
+  struct usbdevice *rio_dev;
+#endif
+
+  get_some_switches (argc, argv, &backup_internal, &backup_external);
+
+  if (optind != argc - 1)
+  {
+    usage (argv[0]);
+    exit (-1);
+  }
+
+  /* if no switches set, save whatever is there */
+  if (!backup_internal && !backup_external)
+    backup_internal = backup_external = 1;
+
+  fd = open (argv[optind], O_RDWR | O_CREAT | O_TRUNC,
+             S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (fd == -1)
+  {
+    perror (argv[optind]);
+    exit (-1);
+  }
+
+#ifndef WITH_USBDEVFS
+  rio_dev = open (DEFAULT_DEV_PATH, O_RDWR);
+  if (rio_dev == -1)
+    {
+      printf ("\nVerify that the rio500.o module is loaded, and your Rio is \n");
+      printf ("connected and powered up.\n\n");
+      exit (-1);
+    }
+   /* Init communication with rio */
+   init_communication (rio_dev);
+#else
+   if(!(rio_dev = init_communication())) {
+     printf("init_communication() failed!\n");
+     return -1;
+   }
+#endif
+
+  send_command (rio_dev, 0x42, 0x0, 0x0);
+
+  if (backup_internal)
+    cards[num_cards++] = 0;
+  if (backup_external)
+  {
+    if (query_card_count (rio_dev) > 1)
+      cards[num_cards++] = 1;
+    else if (!backup_internal)
+      printf ("Unable to find an external memory card to back up.\n");
+  }
+
+  status = num_cards ? rio_backup_write (rio_dev, fd, cards, num_cards, stdout) : -1;
+
+  /* Close device */
+  finish_communication (rio_dev);
+#ifndef WITH_USBDEVFS
+  close (rio_dev);
+#endif
+
+  if (fsync (fd) == -1 || close (fd) == -1)
+    status = -1;
+
+  if (status == -1)
+  {
+    printf ("Backup to %s failed.\n", argv[optind]);
+    exit (-1);
+  }
+  printf ("Done!\n");
+
+  exit (0);
+}
+
+static char const shortopts[] = "hvxi";
+
+static struct option const longopts[] =
+{
+  {"external", no_argument, NULL, 'x'},
+  {"internal", no_argument, NULL, 'i'},
+  {"version", no_argument, NULL, 'v'},
+  {"help", no_argument, NULL, 'h'},
+  {NULL, no_argument, NULL, 0}
+};
+
+static char const *const option_help[] =
+{
+"Input options:",
+"",
+"  -x        --external         Back up only the external smartmedia card",
+"  -i        --internal         Back up only the internal memory",
+"",
+"Miscellaneous options:",
+"",
+"  -v  --version     Output version info.",
+"  -h  --help        Output this help.",
+"",
+"Report bugs to <rio500-devel@lists.sourceforge.net>.",
+0
+};
+
+
+/* Process switches and filenames.  */
+
+void
+get_some_switches (int argc, char *argv[], int *backup_internal, int *backup_external)
+{
+    register int optc;
+    char const * const *p;
+
+    if (optind == argc)
+        return;
+    while ((optc = getopt_long (argc, argv, shortopts, longopts, (int *) 0))
+           != -1) {
+         switch (optc) {
+            case 'v':
+                printf("\nrio_backup -- version %s\n",VERSION);
+                exit(0);
+                break;
+	    case 'i':
+		*backup_internal=1;
+		break;
+	    case 'x':
+		*backup_external=1;
+		break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                for (p=option_help;  *p ;  p++)
+                  fprintf (stderr, "%s\n", *p);
+                exit(0);
+                break;
+         }
+    }
+}
@@ -0,0 +1,295 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <fcntl.h>
+
+#include "librio500.h"
+#include "getopt.h"
+
+void get_some_switches (int argc, char *argv[], int *card, int *compact, int *automat);
+void usage (char *progname);
+#ifndef WITH_USBDEVFS
+rio_table *read_tables (int rio_dev, int card, rio_table **songs);
+#else
+rio_table *read_tables (struct usbdevice *rio_dev, int card, rio_table **songs);
+#endif
+void free_tables (rio_table *folders, rio_table **songs);
+void show_frag (rio_frag *frag);
+
+void
+usage (char *progname)
+{
+  printf ("\nusage: %s [OPTIONS]\n", progname);
+  printf ("\n");
+  printf ("\n Shows how scattered the free space of the Rio is and, with --compact,\n");
+  printf (" moves the songs together so the free space is in one piece.\n");
+  printf ("\n");
+  return;
+}
+
+int
+main(int argc, char *argv[])
+{
+  char answer[255];
+  int card = 0;
+  int compact = 0;
+  int automatic = 0;
+  int status = 0;
+  rio_table *folders;
+  rio_table *songs[RIO_CACHE_MAX_FOLDERS];
+  rio_frag  *frag;
+
+#ifndef WITH_USBDEVFS
+  int rio_dev;
+#else
+  struct usbdevice *rio_dev;
+#endif
+
+  get_some_switches (argc, argv, &card, &compact, &automatic);
+
+#ifndef WITH_USBDEVFS
+  rio_dev = open (DEFAULT_DEV_PATH, O_RDWR);
+  if (rio_dev == -1)
+    {
+      printf ("\nVerify that the rio500.o module is loaded, and your Rio is \n");
+      printf ("connected and powered up.\n\n");
+      exit (-1);
+    }
+   /* Init communication with rio */
+   init_communication (rio_dev);
+#else
+   if(!(rio_dev = init_communication())) {
+     printf("init_communication() failed!\n");
+     return -1;
+   }
+#endif
+
+  send_command (rio_dev, 0x42, 0x0, 0x0);
+  if (card == 1 && query_card_count (rio_dev) < 2)
+  {
+    printf ("Unable to find an external memory card.\n");
+    finish_communication (rio_dev);
+    exit (-1);
+  }
+
+  folders = read_tables (rio_dev, card, songs);
+  frag = rio_frag_analyze (rio_dev, folders, songs, card);
+  if (frag == NULL)
+  {
+    printf ("Could not read the memory status of card %d.\n", card);
+    free_tables (folders, songs);
+    finish_communication (rio_dev);
+    exit (-1);
+  }
+  show_frag (frag);
+
+  if (compact && frag->movable > 0)
+  {
+    if (!automatic)
+    {
+      /* Issue a warning */
+      printf ("\n\n");
+      printf ("---------------------------------------------------------\n");
+      printf ("                  W A R N I N G\n");
+      printf ("---------------------------------------------------------\n");
+      printf ("\n");
+      printf ("This command reads %d songs back into memory and writes\n", frag->movable);
+      printf ("them again. Do not interrupt it: songs that are in memory\n");
+      printf ("when it stops are lost.\n");
+      printf ("\nAnswer with yes if you want to continue? ");
+
+      scanf ("%s", answer);
+
+      if (strcmp (answer, "yes") != 0)
+        compact = 0;
+    }
+
+    if (compact)
+    {
+      status = rio_frag_compact (rio_dev, folders, songs, frag, card, stdout);
+
+      /* Show how it looks now */
+      rio_frag_delete (frag);
+      free_tables (folders, songs);
+      folders = read_tables (rio_dev, card, songs);
+      frag = rio_frag_analyze (rio_dev, folders, songs, card);
+      if (frag != NULL)
+      {
+        printf ("\n");
+        show_frag (frag);
+      }
+    }
+  }
+
+  rio_frag_delete (frag);
+  free_tables (folders, songs);
+
+  /* Close device */
+  finish_communication (rio_dev);
+#ifndef WITH_USBDEVFS
+  close (rio_dev);
+#endif
+
+  if (status == -1)
+  {
+    printf ("Compaction failed.\n");
+    exit (-1);
+  }
+
+  exit (0);
+}
+
+/* Every table of card. The Rio sometimes comes back empty handed, so
+   try a few times. */
+rio_table *
+#ifndef WITH_USBDEVFS
+read_tables (int rio_dev, int card, rio_table **songs)
+#else
+read_tables (struct usbdevice *rio_dev, int card, rio_table **songs)
+#endif
+{
+  rio_table *folders = NULL;
+  int        retries, f;
+
+  memset (songs, 0, RIO_CACHE_MAX_FOLDERS * sizeof (rio_table *));
+  for (retries = 0; folders == NULL && retries < 3; retries++)
+  {
+    send_command (rio_dev, 0x42, 0, 0);
+    folders = rio_read_folder_table (rio_dev, card);
+  }
+  if (folders == NULL)
+    folders = rio_table_new (RIO_TABLE_FOLDERS, 0);
+
+  for (f = 0; f < folders->count && f < RIO_CACHE_MAX_FOLDERS; f++)
+  {
+    for (retries = 0; songs[f] == NULL && retries < 3; retries++)
+      songs[f] = rio_read_song_table (rio_dev, rio_table_folder (folders, f), f, card);
+    if (songs[f] == NULL)
+      songs[f] = rio_table_new (RIO_TABLE_SONGS, 0);
+  }
+
+  return folders;
+}
+
+void
+free_tables (rio_table *folders, rio_table **songs)
+{
+  int f;
+
+  for (f = 0; f < RIO_CACHE_MAX_FOLDERS; f++)
+    rio_table_delete (songs[f]);
+  rio_table_delete (folders);
+}
+
+void
+show_frag (rio_frag *frag)
+{
+  DWORD used;
+
+  used = frag->num_blocks - frag->num_unused_blocks;
+  printf ("%s: %lu blocks of %luK, %lu in use, %lu free\n",
+          frag->card ? "External card" : "Internal memory",
+          (unsigned long) frag->num_blocks, (unsigned long) frag->block_size / 1024,
+          (unsigned long) used, (unsigned long) frag->num_unused_blocks);
+  printf ("  songs %lu blocks, song tables %lu, other %lu\n",
+          (unsigned long) frag->song_blocks, (unsigned long) frag->table_blocks,
+          (unsigned long) frag->other_blocks);
+  printf ("  first free block %lu, free space in %lu pieces, the largest %lu blocks\n",
+          (unsigned long) frag->first_free_block, (unsigned long) frag->free_runs,
+          (unsigned long) frag->largest_run);
+  if (frag->movable > 0)
+    printf ("  %d songs (%luK) lie past the first free block; --compact moves them\n",
+            frag->movable, frag->movable_bytes / 1024);
+  else
+    printf ("  nothing to compact\n");
+}
+
+static char const shortopts[] = "achvx";
+
+static struct option const longopts[] =
+{
+  {"automatic", no_argument, NULL, 'a'},
+  {"compact", no_argument, NULL, 'c'},
+  {"external", no_argument, NULL, 'x'},
+  {"version", no_argument, NULL, 'v'},
+  {"help", no_argument, NULL, 'h'},
+  {NULL, no_argument, NULL, 0}
+};
+
+static char const *const option_help[] =
+{
+"Input options:",
+"",
+"  -c        --compact          Move the songs together",
+"  -a        --automatic        Don't ask before compacting",
+"  -x        --external         Use the external smartmedia card",
+"",
+"Miscellaneous options:",
+"",
+"  -v  --version     Output version info.",
+"  -h  --help        Output this help.",
+"",
+"Report bugs to <rio500-devel@lists.sourceforge.net>.",
+0
+};
+
+
+/* Process switches and filenames.  */
+
+void
+get_some_switches (int argc, char *argv[], int *card, int *compact, int *automat)
+{
+    register int optc;
+    char const * const *p;
+
+    if (optind == argc)
+        return;
+    while ((optc = getopt_long (argc, argv, shortopts, longopts, (int *) 0))
+           != -1) {
+         switch (optc) {
+            case 'v':
+                printf("\nrio_defrag -- version %s\n",VERSION);
+                exit(0);
+                break;
+	    case 'a':
+		*automat=1;
+		break;
+	    case 'c':
+		*compact=1;
+		break;
+	    case 'x':
+		*card=1;
+		break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                for (p=option_help;  *p ;  p++)
+                  fprintf (stderr, "%s\n", *p);
+                exit(0);
+                break;
+         }
+    }
+}
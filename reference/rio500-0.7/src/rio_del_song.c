@@ -39,6 +39,7 @@
 #endif /* TRUE */
 
 int name_flag = 0;
+int match_mode = RIO_MATCH_EXACT;
 int whole_folder = 0;
 int folder_num_set = 0;
 int card_number = 0;
@@ -51,14 +52,6 @@ void usage (char *progname);
 int main(int argc, char *argv[]);
 void get_some_switches (int argc, char *argv[], int *folder_num, int *automat, int *card);
 
-#ifndef WITH_USBDEVFS
-int remove_folder (int rio_dev, int folder_num, int card_number);
-int remove_song (int rio_dev, int song_num, int folder_num, int card_number);
-#else
-int remove_folder (struct usbdevice *rio_dev, int folder_num, int card_number);
-int remove_song (struct usbdevice *rio_dev, int song_num, int folder_num, int card_number);
-#endif
-
 
 void
 usage (char *progname)
@@ -76,9 +69,11 @@ main(int argc, char *argv[])
 {
   int		    song_retries,folder_retries;
   int		    folder_list_length,song_list_length = 0;
-  int               match_flag,count,counter,song_num,folder_num;
-  int               num_things_to_delete;
-  char		    *song_num_string=NULL;
+  int               match_flag,count,song_num,folder_num;
+  int               num_things_to_delete, num_confirmed, deleted;
+  int               *nums;
+  rio_table         *folder_table, *song_table;
+  char		    *num_string=NULL;
   GList		    *things_to_delete = NULL;
   GList		    *indices_to_delete = NULL;
   GList		    *rio_folders = NULL;
@@ -87,6 +82,9 @@ main(int argc, char *argv[])
   folder_entry *    folder_ent;
   song_entry *	    song_ent;
   GList		    *arg_ent;
+  GList		    *matches, *match;
+  rio_name_index    *index;
+  rio_name_ref      *ref;
   GList 	    *song_lists[8];
 #ifndef WITH_USBDEVFS
   int               rio_dev;
@@ -172,6 +170,12 @@ main(int argc, char *argv[])
      }
   }
 
+  /* Index the names once; lookups below are then a hash away */
+  index = rio_name_index_new ();
+  rio_name_index_add_folders (index, card_number, rio_folders);
+  for(count=0;count<g_list_length(rio_folders);count++)
+    rio_name_index_add_songs (index, card_number, count, song_lists[count]);
+
    finish_communication (rio_dev);
 #ifndef WITH_USBDEVFS
    close (rio_dev);
@@ -181,18 +185,11 @@ main(int argc, char *argv[])
 
   if (name_flag == 1 && folder_num_set == 1)
   {
-    match_flag = 0;
-    for(count = 0;count<g_list_length(rio_folders);count++)
-    {
-	folder_ent = (folder_entry *) g_list_nth(rio_folders,count)->data;
-	if (strcmp(folder_num_string,folder_ent->name1) == 0)
-	{
-           folder_num=count;
-	   match_flag = 1;
-        }
-    }
+    ref = rio_name_index_folder (index, folder_num_string);
+    if (ref != NULL)
+      folder_num = ref->folder;
    /* If no matches of foldername<->folderindex then errormsg and exit */
-      if (match_flag == 0)
+      if (ref == NULL)
       {
         printf("\n%s did not match any folder stored on the rio500\n",folder_num_string);
         printf("Check the folder names and try again\n");
@@ -225,72 +222,45 @@ main(int argc, char *argv[])
           num_things_to_delete++;
   }
   /* do name to index lookups before sorting */
-  /* whole folder case first */
-  if (name_flag == 1 && whole_folder == 1)
+  if (name_flag == 1)
   {
-     for(count=0;count<num_things_to_delete;count++)
+     num_things_to_delete = 0;
+     for(arg_ent = things_to_delete; arg_ent; arg_ent = arg_ent->next)
      {
-	arg_ent = g_list_nth(things_to_delete,count);
+	matches = rio_name_index_match (index, (char *)arg_ent->data, match_mode, !whole_folder);
 	match_flag = 0;
-	for(counter=0;counter<g_list_length(rio_folders);counter++)
-        {
-	   folder_ent = (folder_entry *) g_list_nth(rio_folders,counter)->data;
-	   if (strcmp((char *)folder_ent->name1,(char *)arg_ent->data) == 0)
-	   {
-             /* First we need to put counter into string */
-	     match_flag = 1;
-	     folder_num_string = malloc(4); /* up to index of 999 */
-	     int_to_string(counter);
-	     folder_num_string = strcpy(folder_num_string,numstring);
-	     indices_to_delete = g_list_append(indices_to_delete,folder_num_string);
-           }
-         }
-      /* end of match loop, check that a match was found */
-      if (match_flag == 0)
-      {
-  	printf("\n%s did not match any folder stored on the rio500\n",(char*)arg_ent->data);
-	printf("Check the folder names and try again\n");
-	exit(-1);
-      }
-    }
-    things_to_delete = indices_to_delete;
-   }
-
-   if (name_flag == 1 && whole_folder == 0) /* if args are songs */
-   {
-      for(count=0;count<num_things_to_delete;count++)
-      {
-	arg_ent = g_list_nth(things_to_delete,count);
-        match_flag = 0;
-	for(counter=0;counter<g_list_length(song_lists[folder_num]);counter++)
+	for(match = matches; match; match = match->next)
 	{
-	  song_ent = (song_entry *) g_list_nth(song_lists[folder_num],counter)->data;
-          if (strcmp((char *)song_ent->name1,(char *)arg_ent->data) == 0)
-	  {
-             /* First we need to put counter into string */
-	     match_flag = 1;
-             song_num_string = malloc(4); /* up to index of 999 */
-             int_to_string(counter);
-	     song_num_string = strcpy(song_num_string,numstring);
-             indices_to_delete = g_list_append(indices_to_delete,song_num_string);
-          }
+	  ref = (rio_name_ref *) match->data;
+	  if (whole_folder == 0 && ref->folder != folder_num)
+	    continue;
+	  /* First we need to put the index into a string */
+	  match_flag = 1;
+	  num_string = malloc(4); /* up to index of 999 */
+	  int_to_string(whole_folder ? ref->folder : ref->song);
+	  num_string = strcpy(num_string,numstring);
+	  indices_to_delete = g_list_append(indices_to_delete,num_string);
+	  num_things_to_delete++;
 	}
+	g_list_free (matches);
       /* end of match loop, check that a match was found */
       if (match_flag == 0)
       {
-        printf("\n%s did not match any song stored on the rio500\n",(char*)arg_ent->data);
-        printf("Check the folder names and try again\n");
-        exit(-1);
-
+	printf("\n%s did not match any %s stored on the rio500\n",(char*)arg_ent->data,
+	       whole_folder ? "folder" : "song");
+	printf("Check the %s names and try again\n", whole_folder ? "folder" : "song");
+	exit(-1);
       }
      }
      things_to_delete = indices_to_delete;
-    }	  
+  }
 
   /* sort the glist */
   things_to_delete = g_list_sort(things_to_delete,g_alpha_sort);
 
-  /* loop through list of args and delete */
+  /* Check and confirm them all first */
+  nums = calloc (num_things_to_delete, sizeof (int));
+  num_confirmed = 0;
   for(count = 0; count < num_things_to_delete; count++)
   {
 	if (whole_folder == 0) /* grab nth index and get it ready */
@@ -315,29 +285,7 @@ main(int argc, char *argv[])
 	  printf("\nCheck the song index number and try again\n");
 	  exit(-1);
         }
-/* Open connection to rio */
-#ifndef WITH_USBDEVFS
-  rio_dev = open (DEFAULT_DEV_PATH, O_RDWR);
-  if (rio_dev < 0)
-    {
-      printf ("\nVerify that the rio500.o module is loaded, and your Rio is \n");
-      printf ("connected and powered up.\n\n");
-      exit (-1);
-    }
-
-   /* Init communication with rio */
-   init_communication (rio_dev);
-#else
-
-   if(!(rio_dev = init_communication())) {
-     printf("init_communication() failed!\n");
-     free(rio_dev);
-     return -1;
-   }
-
-#endif
 
-   /* Remove song */ 
    if ( whole_folder == 1)
    {
      if (!automatic)
@@ -346,15 +294,9 @@ main(int argc, char *argv[])
 	printf ("Are you sure you want to remove folder <%s>? Type <yes> to confirm. ",(char *)folder_ent->name1);
 	 scanf ( "%s", answer );
 	 if ( strcmp (answer, "yes") != 0 )
-	   {
-	     finish_communication (rio_dev);
-#ifndef WITH_USBDEVFS
-	     close (rio_dev);
-#endif
-	     exit (0);
-	   }
+	   break;
        }
-     remove_folder (rio_dev, folder_num, card_number);
+     nums[num_confirmed++] = folder_num;
    }
    else 
    {
@@ -364,152 +306,92 @@ main(int argc, char *argv[])
 	printf ("Are you sure you want to remove song <%s>? Type <yes> to confirm. ",(char *)song_ent->name1);
          scanf ( "%s", answer );
          if ( strcmp (answer, "yes") != 0 )
-           {
-             finish_communication (rio_dev);
-#ifndef WITH_USBDEVFS
-             close (rio_dev);
-#endif
-             exit (0);
-           }
+           break;
        }
-     remove_song (rio_dev, song_num, folder_num, card_number);
+     nums[num_confirmed++] = song_num;
     }
+  }
 
-   /* Close device */
-   finish_communication (rio_dev);
-#ifndef WITH_USBDEVFS
-   close (rio_dev);
-#endif
- } /* end of loop */
+  if (num_confirmed == 0)
+  {
 #ifdef WITH_USBDEVFS
-   free (rio_dev);
+    free (rio_dev);
 #endif
-   exit (0);
-}
+    exit (0);
+  }
 
-int
+/* Open connection to rio */
 #ifndef WITH_USBDEVFS
-remove_folder (int rio_dev, int folder_num, int card_number)
-#else
-remove_folder (struct usbdevice *rio_dev, int folder_num, int card_number)
-#endif
-{
-  folder_entry     *folder;
-  int               song_num, folder_block_offset;
-  GList            *folders, *songs;
-
-  /* Read folder & song block */
-  folders = read_folder_entries (rio_dev,card_number);
-  if ( folder_num > g_list_length (folders)-1 )
-    return -1;
-  else
-    songs   = read_song_entries (rio_dev, folders, folder_num, card_number); 
-
-
-  folder  = (folder_entry *)g_list_nth_data (g_list_first(folders), folder_num);
-  if (folder == NULL)
-     return 0;
-  printf ("Removing folder <%s>...\n", folder->name1);
-
-  for (song_num = g_list_length (songs) - 1; song_num >= 0; song_num--)
-    remove_song (rio_dev, song_num, folder_num, card_number);
-
-  folders = g_list_remove (folders, (gpointer) folder);
-
-  send_command (rio_dev, 0x4c, ((folder_num << 8) | 0xff), card_number);
-  write_folder_entries (rio_dev, folders,card_number);
-  send_command (rio_dev, 0x42, 0, 0);
-  send_command (rio_dev, 0x42, 0, 0);
-  folder_block_offset = send_command (rio_dev, 0x43, 0x0, 0x0);
-
-#ifdef DEBUG
-  fprintf (stderr, "Folder block written to 0x%04x\n", folder_block_offset);
-#endif
-
-  /* Tell Rio where the root folder block is. */
-  send_folder_location (rio_dev, folder_block_offset, 0, card_number);
-
-  /* Not really sure what this does */
-  send_command (rio_dev, 0x58, 0x0, card_number);
-
-  return 0;
-}
+  rio_dev = open (DEFAULT_DEV_PATH, O_RDWR);
+  if (rio_dev < 0)
+    {
+      printf ("\nVerify that the rio500.o module is loaded, and your Rio is \n");
+      printf ("connected and powered up.\n\n");
+      exit (-1);
+    }
 
-#ifndef WITH_USBDEVFS
-int remove_song (int rio_dev, int song_num, int folder_num,int card_number)
+   /* Init communication with rio */
+   init_communication (rio_dev);
 #else
-int remove_song (struct usbdevice *rio_dev, int song_num, int folder_num, int card_number)
-#endif
-{
-  song_entry       *song;
-  folder_entry     *f_entry;
-  int               folder_block_offset, song_block_offset;
-  GList            *folders, *songs;
-
-   /* Read folder & song block */
-   folders = read_folder_entries (rio_dev, card_number);
-   if ( folder_num > g_list_length (folders)-1 )
-   {
-     songs   = read_song_entries (rio_dev, folders, 0, card_number); /* use folder 0 by default */
-     folder_num = 0;
-   } else
-     songs   = read_song_entries (rio_dev, folders, folder_num, card_number); 
 
-   /* Remove the song entry from the list */
-   if ( song_num > g_list_length (songs) -1)
+   if(!(rio_dev = init_communication())) {
+     printf("init_communication() failed!\n");
+     free(rio_dev);
      return -1;
+   }
 
-   song = (song_entry *) g_list_nth_data (songs, song_num);
-   if (song == NULL)
-     return 0;
-   printf ("Removing file <%s>...\n", song->name1);
-
-   songs = g_list_remove (songs, (gpointer)song);
-
-   /* Send remove command to the rio */
-   send_command (rio_dev, 0x4c, ((folder_num << 8) | song_num), card_number);
+#endif
 
-   /* Write song block to the correct folder */
-   write_song_entries (rio_dev, folder_num, songs,card_number );
-   send_command (rio_dev, 0x42, 0, 0);
+   /* Delete them all in one go: the tables are written once */
    send_command (rio_dev, 0x42, 0, 0);
+   folder_table = rio_read_folder_table (rio_dev, card_number);
+   if ( whole_folder == 1)
+   {
+     for (count = 0; folder_table && count < num_confirmed; count++)
+       printf ("Removing folder <%s>...\n",
+               rio_table_folder (folder_table, nums[count])->name1);
+     deleted = rio_delete_folders (rio_dev, folder_table, nums, num_confirmed, card_number);
+   }
+   else 
+   {
+     song_table = NULL;
+     if (folder_table && folder_num < folder_table->count)
+       song_table = rio_read_song_table (rio_dev, rio_table_folder (folder_table, folder_num),
+                                         folder_num, card_number);
+     for (count = 0; song_table && count < num_confirmed; count++)
+       if (nums[count] < song_table->count)
+         printf ("Removing file <%s>...\n",
+                 rio_table_song (song_table, nums[count])->name1);
+     deleted = rio_delete_songs (rio_dev, folder_table, song_table, folder_num,
+                                 nums, num_confirmed, card_number);
+     rio_table_delete (song_table);
+   }
+   rio_table_delete (folder_table);
+   free (nums);
 
-   song_block_offset = send_command (rio_dev, 0x43, 0x0, 0x0);
+   if (deleted == -1)
+     printf ("\nReading the tables from the Rio500 failed; nothing was deleted\n");
 
-#ifdef DEBUG
-   fprintf (stderr, "Song block written to 0x%04x\n", song_block_offset);
+   /* Close device */
+   finish_communication (rio_dev);
+#ifndef WITH_USBDEVFS
+   close (rio_dev);
 #endif
-
-   /* Now write the folder block again */
-   f_entry = (folder_entry *) ((GList *) g_list_nth (folders, folder_num))->data; 
-   f_entry->offset = song_block_offset;
-   f_entry->fst_free_entry_off -= 0x800;
-
-   write_folder_entries ( rio_dev, folders,card_number );
-   send_command (rio_dev, 0x42, 0, 0);
-   send_command (rio_dev, 0x42, 0, 0);
-   folder_block_offset = send_command (rio_dev, 0x43, 0x0, 0x0);
-
-#ifdef DEBUG
-   fprintf (stderr, "Folder block written to 0x%04x\n", folder_block_offset);
+#ifdef WITH_USBDEVFS
+   free (rio_dev);
 #endif
-
-   /* Tell Rio where the root folder block is. */
-   send_folder_location (rio_dev, folder_block_offset, folder_num,card_number);
-
-   /* Not really sure what this does */
-   send_command (rio_dev, 0x58, 0x0, card_number);
-
-   return 0;
+   exit (deleted == -1 ? -1 : 0);
 }
 
-static char const shortopts[] = "F:xabwhv";
+static char const shortopts[] = "F:xabgEwhv";
 static struct option const longopts[] =
 {
   {"folder", required_argument, NULL, 'F'},
   {"external", no_argument, NULL, 'x'},
   {"automatic", no_argument, NULL, 'a'},
   {"byname",no_argument, NULL, 'b'},
+  {"glob", no_argument, NULL, 'g'},
+  {"regex", no_argument, NULL, 'E'},
   {"wholefolder", no_argument, NULL, 'w'},
   {"version", no_argument, NULL, 'v'},
   {"help", no_argument, NULL, 'h'},
@@ -528,6 +410,8 @@ static char const *const option_help[] =
 "  -b        --byname           Use folder/song names instead of indicies",
 "                               Names should be names as shown on the",
 "				Rio500", 
+"  -g        --glob             Names are shell patterns (implies -b)",
+"  -E        --regex            Names are regular expressions (implies -b)",
 "",
 "Miscellaneous options:",
 "",
@@ -568,6 +452,14 @@ get_some_switches (int argc, char *argv[], int *folder_num, int *automat, int *c
 	    case 'b':
 		name_flag = 1;
 		break;
+	    case 'g':
+		name_flag = 1;
+		match_mode = RIO_MATCH_GLOB;
+		break;
+	    case 'E':
+		name_flag = 1;
+		match_mode = RIO_MATCH_REGEX;
+		break;
 	    case 'w':
 		whole_folder = 1;
 		break;
@@ -0,0 +1,182 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "librio500.h"
+#include "getopt.h"
+
+void get_some_switches (int argc, char *argv[], int *font_number, int *c_source);
+void usage (char *progname);
+int  write_c_source (FILE *fp, char *infile, BYTE *pack, int size);
+
+void
+usage (char *progname)
+{
+  printf ("\nusage: %s [OPTIONS] font glyphpack\n", progname);
+  printf ("\n");
+  printf ("\n Converts a .fon or .psf font to a glyph pack, which is loaded\n");
+  printf (" without parsing anything.\n");
+  printf ("\n");
+  return;
+}
+
+/* The pack as a C table, for compiling the default font in */
+int
+write_c_source (FILE *fp, char *infile, BYTE *pack, int size)
+{
+  char *name;
+  int   i;
+
+  name = strrchr (infile, '/');
+  name = name ? name + 1 : infile;
+
+  fprintf (fp, "/* Generated by rio_font_pack -c from %s; do not edit. */\n\n", name);
+  fprintf (fp, "#include \"librio500.h\"\n\n");
+  fprintf (fp, "const char rio_default_font_name[] = \"%s\";\n\n", name);
+  fprintf (fp, "const int  rio_default_font_pack_size = %d;\n\n", size);
+  fprintf (fp, "const BYTE rio_default_font_pack[] =\n{");
+  for (i = 0; i < size; i++)
+    fprintf (fp, "%s0x%02x%s", (i % 12) ? " " : "\n  ", pack[i], (i + 1 < size) ? "," : "");
+  fprintf (fp, "\n};\n");
+
+  return ferror (fp) ? -1 : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  char     *infile, *outfile;
+  int       font_number = 0;
+  int       c_source = 0;
+  int       size, status;
+  rio_font *font;
+  BYTE     *pack;
+  FILE     *fp;
+
+  get_some_switches (argc, argv, &font_number, &c_source);
+  if (argc - optind != 2)
+  {
+    usage (argv[0]);
+    exit (-1);
+  }
+  infile  = argv[optind];
+  outfile = argv[optind + 1];
+
+  font = rio_font_get (infile, font_number);
+  if (font == NULL)
+  {
+    printf ("Could not load font %d of %s.\n", font_number, infile);
+    exit (-1);
+  }
+
+  size = rio_font_pack (font, &pack);
+  rio_font_put (font);
+  if (size == -1)
+  {
+    printf ("Out of memory.\n");
+    exit (-1);
+  }
+
+  fp = fopen (outfile, c_source ? "w" : "wb");
+  if (fp == NULL)
+  {
+    printf ("Could not open %s for writing.\n", outfile);
+    exit (-1);
+  }
+  if (c_source)
+    status = write_c_source (fp, infile, pack, size);
+  else
+    status = (fwrite (pack, 1, size, fp) == size) ? 0 : -1;
+  if (fclose (fp) != 0 || status == -1)
+  {
+    printf ("Could not write %s.\n", outfile);
+    remove (outfile);
+    exit (-1);
+  }
+
+  free (pack);
+  exit (0);
+}
+
+static char const shortopts[] = "chn:v";
+
+static struct option const longopts[] =
+{
+  {"c-source", no_argument, NULL, 'c'},
+  {"fontnumber", required_argument, NULL, 'n'},
+  {"version", no_argument, NULL, 'v'},
+  {"help", no_argument, NULL, 'h'},
+  {NULL, no_argument, NULL, 0}
+};
+
+static char const *const option_help[] =
+{
+"Input options:",
+"",
+"  -n x      --fontnumber x     Convert font x of a .fon file (default 0)",
+"  -c        --c-source         Write the pack as a C table instead",
+"",
+"Miscellaneous options:",
+"",
+"  -v  --version     Output version info.",
+"  -h  --help        Output this help.",
+"",
+"Report bugs to <rio500-devel@lists.sourceforge.net>.",
+0
+};
+
+
+/* Process switches and filenames.  */
+
+void
+get_some_switches (int argc, char *argv[], int *font_number, int *c_source)
+{
+    register int optc;
+    char const * const *p;
+
+    if (optind == argc)
+        return;
+    while ((optc = getopt_long (argc, argv, shortopts, longopts, (int *) 0))
+           != -1) {
+         switch (optc) {
+            case 'v':
+                printf("\nrio_font_pack -- version %s\n",VERSION);
+                exit(0);
+                break;
+	    case 'c':
+		*c_source=1;
+		break;
+	    case 'n':
+		*font_number = atoi(optarg);
+		break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                for (p=option_help;  *p ;  p++)
+                  fprintf (stderr, "%s\n", *p);
+                exit(0);
+                break;
+         }
+    }
+}
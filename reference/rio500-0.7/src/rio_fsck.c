@@ -0,0 +1,196 @@
+/*  ----------------------------------------------------------------------
+
+    Copyright (C) 2001  The rio500 developers (rio500-devel@lists.sourceforge.net)
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+    ---------------------------------------------------------------------- */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <fcntl.h>
+
+#include "librio500.h"
+#include "getopt.h"
+
+void get_some_switches (int argc, char *argv[], int *card, int *repair, int *automat);
+void usage (char *progname);
+
+void
+usage (char *progname)
+{
+  printf ("\nusage: %s [OPTIONS]\n", progname);
+  printf ("\n");
+  printf ("\n Checks the folder and song tables of the Rio and, with --repair,\n");
+  printf (" drops the entries that are broken.\n");
+  printf ("\n");
+  return;
+}
+
+int
+main(int argc, char *argv[])
+{
+  char answer[255];
+  int card = 0;
+  int repair = 0;
+  int automatic = 0;
+  int status;
+  rio_fsck_report report;
+
+#ifndef WITH_USBDEVFS
+  int rio_dev;
+#else
+  struct usbdevice *rio_dev;
+#endif
+
+  get_some_switches (argc, argv, &card, &repair, &automatic);
+
+  if (repair && !automatic)
+    {
+      /* Issue a warning */
+      printf ("\n\n");
+      printf ("---------------------------------------------------------\n");
+      printf ("                  W A R N I N G\n");
+      printf ("---------------------------------------------------------\n");
+      printf ("\n");
+      printf ("This command removes the folder and song entries it finds\n");
+      printf ("broken. Songs whose audio was overwritten are lost anyway;\n");
+      printf ("their names will disappear from the Rio.\n");
+      printf ("\nAnswer with yes if you want to continue? ");
+
+      scanf ("%s", answer);
+
+      if (strcmp (answer, "yes") != 0)
+	repair = 0;
+    }
+
+#ifndef WITH_USBDEVFS
+  rio_dev = open (DEFAULT_DEV_PATH, O_RDWR);
+  if (rio_dev == -1)
+    {
+      printf ("\nVerify that the rio500.o module is loaded, and your Rio is \n");
+      printf ("connected and powered up.\n\n");
+      exit (-1);
+    }
+   /* Init communication with rio */
+   init_communication (rio_dev);
+#else
+   if(!(rio_dev = init_communication())) {
+     printf("init_communication() failed!\n");
+     return -1;
+   }
+#endif
+
+  send_command (rio_dev, 0x42, 0x0, 0x0);
+  if (card == 1 && query_card_count (rio_dev) < 2)
+  {
+    printf ("Unable to find an external memory card.\n");
+    finish_communication (rio_dev);
+    exit (-1);
+  }
+
+  status = rio_fsck (rio_dev, card, repair, &report, stdout);
+
+  /* Close device */
+  finish_communication (rio_dev);
+#ifndef WITH_USBDEVFS
+  close (rio_dev);
+#endif
+
+  if (status == -1)
+  {
+    printf ("Could not read the tables of the %s.\n",
+            card ? "external card" : "internal memory");
+    exit (-1);
+  }
+
+  printf ("%d folders, %d songs, %d problems", report.folders, report.songs, report.problems);
+  if (repair)
+    printf (", %d folders repaired", report.repaired);
+  printf ("\n");
+
+  exit (report.problems && !repair ? 1 : 0);
+}
+
+static char const shortopts[] = "ahrvx";
+
+static struct option const longopts[] =
+{
+  {"automatic", no_argument, NULL, 'a'},
+  {"repair", no_argument, NULL, 'r'},
+  {"external", no_argument, NULL, 'x'},
+  {"version", no_argument, NULL, 'v'},
+  {"help", no_argument, NULL, 'h'},
+  {NULL, no_argument, NULL, 0}
+};
+
+static char const *const option_help[] =
+{
+"Input options:",
+"",
+"  -r        --repair           Drop the broken entries",
+"  -a        --automatic        Don't ask before repairing",
+"  -x        --external         Check the external smartmedia card",
+"",
+"Miscellaneous options:",
+"",
+"  -v  --version     Output version info.",
+"  -h  --help        Output this help.",
+"",
+"Report bugs to <rio500-devel@lists.sourceforge.net>.",
+0
+};
+
+
+/* Process switches and filenames.  */
+
+void
+get_some_switches (int argc, char *argv[], int *card, int *repair, int *automat)
+{
+    register int optc;
+    char const * const *p;
+
+    if (optind == argc)
+        return;
+    while ((optc = getopt_long (argc, argv, shortopts, longopts, (int *) 0))
+           != -1) {
+         switch (optc) {
+            case 'v':
+                printf("\nrio_fsck -- version %s\n",VERSION);
+                exit(0);
+                break;
+	    case 'a':
+		*automat=1;
+		break;
+	    case 'r':
+		*repair=1;
+		break;
+	    case 'x':
+		*card=1;
+		break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                for (p=option_help;  *p ;  p++)
+                  fprintf (stderr, "%s\n", *p);
+                exit(0);
+                break;
+         }
+    }
+}
@@ -22,11 +22,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
+#include "getopt.h"
 
 #include "librio500.h"
 
@@ -42,37 +44,55 @@
 
 #endif /* TRUE */
 
+int name_flag = 0;
+int folder_num_set = 0;
+int switches_used = 0;
+int card_number = 0;
+int sync_policy = RIO_SYNC_NONE;
+int dots_shown = 0;
+unsigned long range_offset = 0;
+unsigned long range_length = 0;
+int to_stdout = 0;
+int match_mode = RIO_MATCH_EXACT;
+FILE *msg;                      /* where our messages go */
+char *folder_num_string = NULL;
+
 void usage (char *progname);
 void signal_handler (int signal);
-#ifndef WITH_USBDEVFS
-void read_file (int rio_dev, unsigned long size, char *filename, int card);
-#else
-void read_file (struct usbdevice *rio_dev, unsigned long size, char *filename, int card);
-#endif
+void get_some_switches (int argc, char *argv[], int *folder_num);
+GList *add_songs (GList *selected, char *arg, GList *songs, rio_name_index *index, int folder_num);
+void show_progress (unsigned long done, unsigned long total);
 
 
 void
 usage (char *progname)
 {
-  printf ("\nusage: %s <song_num> <folder_num> <card_num>\n", progname);
-  printf ("\n <file> is the name of the file whose content");
-  printf ("\n we want to upload.");
-  printf ("\n <folder_num> is the index to the folder where it will be put.\n");
-  printf (" <card_num> is the index of the memory card to use\n");
-  printf (" card_num=0=internal memory, card_num=1=external memory card\n");
+  printf ("\nusage: %s [OPTIONS] <song1> . . . <songN>\n", progname);
+  printf ("       %s <song_num> <folder_num> <card_num>\n", progname);
+  printf ("\n [OPTIONS] Try --help for more information");
+  printf ("\n <songN> is the index (or name with --byname) of a song to");
+  printf ("\n download. A range of indices like 3-7 (or 3- for all the");
+  printf ("\n songs from 3 on) is also accepted.");
+  printf ("\n Without options the old form is used: <folder_num> is the");
+  printf ("\n index to the folder the song is in and <card_num> is the");
+  printf ("\n memory card to use (0=internal memory, 1=external card).\n\n");
   return;
 }
 
+int
 main(int argc, char *argv[])
 {
-  int               old_offset, i, length;
-  int               folder_block_offset, song_block_offset;
-  int               folder_num, song_num, font_number;
-  GList            *folders, *songs;
-  folder_entry     *folder;
+  int               count, folder_retries, song_retries;
+  int               folder_num, num_folders, total, all_folders;
+  unsigned long     size;
+  GList            *folders, **songs;
+  GList            *selected = NULL;
+  GList            *item;
   song_entry       *song;
-  folder_entry     *f_entry;
-  int		   card;
+  rio_name_index   *index;
+  rio_name_ref     *ref;
+  rio_download     *dl;
+  rio_sink         *sink;
 
 #ifndef WITH_USBDEVFS
   int               rio_dev;
@@ -82,14 +102,18 @@ main(int argc, char *argv[])
   rio_dev = malloc(sizeof(struct usbdevice));
 #endif
 
+  msg = stdout;
+
   /* Setup signal handler */
   signal (SIGINT , signal_handler);
   signal (SIGQUIT, signal_handler);
   signal (SIGHUP , signal_handler);
   signal (SIGSEGV, signal_handler);
   signal (SIGTERM, signal_handler);
+  /* A reader that goes away must not kill us in the middle of a transfer */
+  signal (SIGPIPE, SIG_IGN);
 
-  if (argc < 2 || argc > 4)
+  if (argc < 2)
   {
     usage (argv[0]);
     exit (-1);
@@ -97,17 +121,31 @@ main(int argc, char *argv[])
 
   /* set defaults */
   folder_num = 0;
-  card = 0;
-  song_num = atoi (argv[1]);
 
-  if (argc == 3)
-    folder_num = atoi (argv[2]);
+  get_some_switches (argc, argv, &folder_num);
+
+  if (optind == argc)
+  {
+    fprintf (msg, "\nNeed to specify the song(s) to download\n");
+    usage (argv[0]);
+    exit (-1);
+  }
 
-  if (argc == 4)
+  /* Old style: rio_get_song <song_num> [<folder_num> [<card_num>]] */
+  if (!switches_used)
   {
-    folder_num = atoi (argv[2]);
-    card = atoi (argv[3]);
+    if (argc > 4)
+    {
+      usage (argv[0]);
+      exit (-1);
+    }
+    if (argc >= 3)
+      folder_num = atoi (argv[2]);
+    if (argc == 4)
+      card_number = atoi (argv[3]);
+    argc = 2;
   }
+
   /* Open connection to rio */
 #ifndef WITH_USBDEVFS
   rio_dev = open (DEFAULT_DEV_PATH, O_RDWR);
@@ -133,58 +171,120 @@ main(int argc, char *argv[])
    /* send_command (rio_dev, 0x51, 1, 0); */
    /* mem = get_mem_status (rio_dev); */
 
-   /* Read folder & song block */
-   folders = read_folder_entries (rio_dev,card);
-   if ( folder_num > g_list_length (folders)-1 )
-     folder_num = 0;
-   songs   = read_song_entries ( rio_dev, folders, folder_num,card ); 
-
-   if (song_num > g_list_length (songs)-1)
+   /* Read folder & song block. Sometimes this fails, try 3 times */
+   folders = NULL;
+   num_folders = folder_retries = 0;
+   while (num_folders == 0 && folder_retries++ < 3)
    {
-     printf ("Incorrect song_num parameter!\n");
-     goto end;
+     send_command (rio_dev, 0x42, 0, 0);
+     folders = read_folder_entries (rio_dev, card_number);
+     num_folders = g_list_length (folders);
    }
 
-   /* Trick the rio into reading song data */
-   f_entry = (folder_entry *) g_list_nth_data (folders, 0);
-   song    = (song_entry *) g_list_nth_data (songs, song_num);
- 
-   if (f_entry == NULL || song == NULL)
+   if (num_folders == 0)
    {
-     printf ("Incorrect song_num or folder_num parameter!\n");
+     fprintf (msg, "Reading the folder list from the Rio500 failed\n");
      goto end;
    }
 
+   index = rio_name_index_new ();
+   rio_name_index_add_folders (index, card_number, folders);
+
+   /* Folder given by name */
+   if (name_flag && folder_num_set)
+   {
+     ref = rio_name_index_folder (index, folder_num_string);
+     if (ref == NULL)
+     {
+       fprintf (msg, "\n%s did not match any folder stored on the rio500\n", folder_num_string);
+       goto end;
+     }
+     folder_num = ref->folder;
+   }
 
-   old_offset      = f_entry->offset;
-   f_entry->offset = song->offset;
+   if (folder_num < 0 || folder_num > num_folders - 1)
+   {
+     if (switches_used)
+     {
+       fprintf (msg, "Non-existent folder\n");
+       goto end;
+     }
+     folder_num = 0;
+   }
 
-   write_folder_entries ( rio_dev, folders,card );
-   send_command (rio_dev, 0x42, 0, 0);
-   send_command (rio_dev, 0x42, 0, 0);
-   folder_block_offset = send_command (rio_dev, 0x43, 0x0, 0x0);
+   /* Names without --folder are looked for in every folder */
+   all_folders = (name_flag && !folder_num_set);
 
-   /* Tell Rio where the root folder block is. */
-   send_folder_location (rio_dev, folder_block_offset, folder_num,card);
+   songs = calloc (num_folders, sizeof (GList *));
+   for (count = 0; count < num_folders; count++)
+   {
+     if (!all_folders && count != folder_num)
+       continue;
+     song_retries = 0;
+     while (songs[count] == NULL && song_retries++ < 3)
+       songs[count] = read_song_entries (rio_dev, folders, count, card_number);
+     rio_name_index_add_songs (index, card_number, count, songs[count]);
+   }
 
-   /* Not really sure what this does */
-   send_command (rio_dev, 0x58, 0x0, card);
+   /* Work out what to download */
+   for (count = optind; count < argc; count++)
+     selected = add_songs (selected, argv[count], songs[folder_num], index,
+                           all_folders ? -1 : folder_num);
 
-   /* Now read the song */
-   read_file (rio_dev, song->length, song->name1,card);
+   if (selected == NULL)
+   {
+     fprintf (msg, "Incorrect song_num parameter!\n");
+     goto end;
+   }
 
-   /* Restore folder */
-   f_entry->offset = old_offset;
-   write_folder_entries ( rio_dev, folders,card );
-   send_command (rio_dev, 0x42, 0, 0);
-   send_command (rio_dev, 0x42, 0, 0);
-   folder_block_offset = send_command (rio_dev, 0x43, 0x0, 0x0);
+   /* One session for all the songs: folder 0 is pointed at each song in
+      turn and the folder block is restored once at the end. */
+   dl = rio_download_begin (rio_dev, folders, folder_num, card_number);
+   if (dl == NULL)
+   {
+     fprintf (msg, "Incorrect song_num or folder_num parameter!\n");
+     goto end;
+   }
+   dl->progress = show_progress;
 
-   /* Tell Rio where the root folder block is. */
-   send_folder_location (rio_dev, folder_block_offset, folder_num,card);
+   for (item = g_list_first (selected); item != NULL; item = item->next)
+   {
+     song = (song_entry *) item->data;
+
+     /* Only part of the song with --offset/--length */
+     size = song->length;
+     if (range_offset >= size)
+       size = 0;
+     else
+       size -= range_offset;
+     if (range_length > 0 && range_length < size)
+       size = range_length;
+
+     if (to_stdout)
+       sink = rio_sink_open_stream (1, sync_policy, NULL);
+     else
+       sink = rio_sink_open ((char *) song->name1, size, sync_policy, NULL);
+     if (sink == NULL)
+     {
+       fprintf (msg, "Cannot create %s: %s\n", song->name1, strerror (errno));
+       continue;
+     }
+
+     fprintf (msg, "Reading file: %s  ", song->name1);
+     fflush (msg);
+     dots_shown = 0;
+
+     rio_download_select (dl, song);
+     total = rio_download_read_range (dl, range_offset, size, sink);
+
+     if (rio_sink_close (sink) == -1)
+       fprintf (msg, " [Error writing %s: %s]", song->name1, strerror (errno));
+     fprintf (msg, " (done. Transfered %d bytes.)\n", total);
+     fflush (msg);
+   }
 
-   /* Not really sure what this does */
-   send_command (rio_dev, 0x58, 0x0, card);
+   /* Restore folder */
+   rio_download_end (dl);
 
 end:
 
@@ -197,105 +297,76 @@ end:
    exit (0);
 }
 
-void
-#ifndef WITH_USBDEVFS
-read_file (int rio_dev, unsigned long size, char *filename, int card)
-#else
-read_file (struct usbdevice *rio_dev, unsigned long size, char *filename, int card)
-#endif
-{
-  int output_file;
-  struct stat file_stat;
-  int  i, j, this_read, block_length;
-  int  total, count, num_blocks, remainder, blocks_left;
-  BYTE *block, *p, address[2];
-  unsigned short offset;
-  int num_chunks, song_location;
-
-  block = (char *)malloc (0x80000);
-
-  i = 0;
-  output_file = open (filename, O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
-  if (output_file == -1)
-    return;
-
-  printf ("Reading file: %s  ", filename);
-  fflush (stdout);
-
-  /* Read 0x4000 bytes first */
-  this_read = (size > 0x4000) ? 0x4000 : size;
-  send_command (rio_dev, 0x4e, 0xff, card);
-  send_command (rio_dev, 0x45, 0x0, this_read);
-
-  count = bulk_read (rio_dev, block, this_read);
-  if (count > 0)
-    write (output_file, block, count);
-
-  size -= this_read;
+/* Turn one command line argument (an index, a range like 2-5 or 2-, or
+   a song name or pattern with --byname) into the song entries it stands
+   for, appended to selected. Names are looked up in folder folder_num,
+   or in every indexed folder if it is -1. */
 
-  if (size == 0)
-    return;
-
-  num_blocks = size / 0x10000;
-  remainder  = size % 0x10000;
+GList *
+add_songs (GList *selected, char *arg, GList *songs, rio_name_index *index,
+           int folder_num)
+{
+  int           first, last, count, num_songs, found;
+  char         *dash, *end;
+  GList        *matches, *item;
+  rio_name_ref *ref;
 
-  /* First read num_chunks, blocks at a time */
-  num_chunks = 0x10;
-  total = this_read;
-  blocks_left = num_blocks - num_chunks;
- 
-  while (blocks_left > 0)
+  if (name_flag)
   {
-    send_command (rio_dev, 0x45, num_chunks, 0x0);
-    for (j = 0; j < num_chunks / 2; j++)
+    found = 0;
+    matches = rio_name_index_match (index, arg, match_mode, TRUE);
+    for (item = matches; item; item = item->next)
     {
-      count = bulk_read (rio_dev, block, 0x20000);
-      total += count;
-      if (count != 0x20000)
-        printf ("[Short read!]");
-      write (output_file, block, count);
-      printf (".");
-      fflush (stdout);
+      ref = (rio_name_ref *) item->data;
+      if (folder_num != -1 && ref->folder != folder_num)
+        continue;
+      selected = g_list_append (selected, ref->entry);
+      found++;
     }
-    blocks_left -= num_chunks; 
-    // Send a 0x42.
-    send_command (rio_dev, 0x42, 0, 0);
-    send_command (rio_dev, 0x42, 0, 0);
+    g_list_free (matches);
+    if (found == 0)
+      fprintf (msg, "%s did not match any song stored on the rio500\n", arg);
+    return selected;
   }
 
-  /* Send remaining blocks */
-  blocks_left += num_chunks;
-  send_command (rio_dev, 0x45, blocks_left, 0x0);
-  while (blocks_left > 0)
-  {
-    count = bulk_read (rio_dev, block, 0x10000);
-    total += count;
-    if (count != 0x10000)
-      printf ("[Short read!]");
-    write (output_file, block, count);
-    printf (".");
-    fflush (stdout);
-    blocks_left--;
-    send_command (rio_dev, 0x42, 0, 0);
-    send_command (rio_dev, 0x42, 0, 0);
-  }
+  num_songs = g_list_length (songs);
 
-  /* Read last block */
-  while (remainder > 0)
+  first = strtol (arg, &end, 10);
+  last  = first;
+  dash  = strchr (arg, '-');
+  if (dash != NULL && dash == end)
+    last = (dash[1] == '\0') ? num_songs - 1 : atoi (dash + 1);
+
+  if (end == arg || first < 0 || first > num_songs - 1 || last < first)
   {
-    this_read = (remainder > 0x4000) ? 0x4000 : remainder;
-    send_command (rio_dev, 0x45, 0x0, this_read);
-    count = bulk_read (rio_dev, block, this_read);
-    if (count > 0)
-      write (output_file, block, count);
-    total += count;
-    remainder -= this_read;
+    fprintf (msg, "Incorrect song_num parameter: %s\n", arg);
+    return selected;
   }
+  if (last > num_songs - 1)
+    last = num_songs - 1;
 
-  printf (" (done. Transfered %d bytes.)\n", total);
-  fflush (stdout);
+  for (count = first, item = g_list_nth (songs, first); item && count <= last;
+       count++, item = item->next)
+    selected = g_list_append (selected, item->data);
 
-  return;
+  return selected;
+}
+
+/* One dot for every tenth of the song */
+void
+show_progress (unsigned long done, unsigned long total)
+{
+  int dots;
+
+  dots = (total > 0) ? (int) ((10.0 * done) / total) : 10;
+  if (dots <= dots_shown)
+    return;
+  while (dots_shown < dots)
+  {
+    fprintf (msg, ".");
+    dots_shown++;
+  }
+  fflush (msg);
 }
 
 void signal_handler (int signal)
@@ -304,9 +375,133 @@ void signal_handler (int signal)
   {
     case 1:
     case 2:
-      printf ("Cannot interrupt transfer! Please wait for transfer to complete ...\n");
+      fprintf (msg, "Cannot interrupt transfer! Please wait for transfer to complete ...\n");
       break;
     default:
-      printf ("Signal [%d] trapped! Ignoring ... \n", signal);
+      fprintf (msg, "Signal [%d] trapped! Ignoring ... \n", signal);
   }
 }
+
+static char const shortopts[] = "F:xbgEs:o:l:chv";
+static struct option const longopts[] =
+{
+  {"folder", required_argument, NULL, 'F'},
+  {"external", no_argument, NULL, 'x'},
+  {"byname",no_argument, NULL, 'b'},
+  {"glob", no_argument, NULL, 'g'},
+  {"regex", no_argument, NULL, 'E'},
+  {"sync", required_argument, NULL, 's'},
+  {"offset", required_argument, NULL, 'o'},
+  {"length", required_argument, NULL, 'l'},
+  {"stdout", no_argument, NULL, 'c'},
+  {"version", no_argument, NULL, 'v'},
+  {"help", no_argument, NULL, 'h'},
+  {NULL, no_argument, NULL, 0}
+};
+
+static char const *const option_help[] =
+{
+"Input options:",
+"",
+"  -F x      --folder x         Download song(s) from folder of index x",
+"  -x        --external         Download from external memory card",
+"  -b        --byname           Use folder/song names instead of indicies",
+"                               Names should be names as shown on the",
+"                               Rio500. Without --folder the songs",
+"                               are looked for in every folder",
+"  -g        --glob             Names are shell patterns (implies -b)",
+"  -E        --regex            Names are regular expressions (implies -b)",
+"  -s x      --sync x           When to flush downloaded files to disk:",
+"                               none (default), close or always",
+"  -o x      --offset x         Start x bytes into the song",
+"  -l x      --length x         Download only x bytes of the song",
+"  -c        --stdout           Write the song(s) to standard output",
+"                               instead of files; messages go to stderr",
+"",
+"  All the songs given are downloaded in one session.",
+"",
+"Miscellaneous options:",
+"",
+"  -v        --version          Output version info.",
+"  -h        --help             Output this help.",
+"",
+"Report bugs to <rio500-devel@lists.sourceforge.net>.",
+0
+};
+
+
+/* Process switches and filenames.  */
+
+void
+get_some_switches (int argc, char *argv[], int *folder_num)
+{
+    register int optc;
+    char const * const *p;
+
+    if (optind == argc)
+        return;
+    while ((optc = getopt_long (argc, argv, shortopts, longopts, (int *) 0))
+           != -1) {
+         switches_used = 1;
+         switch (optc) {
+	    case 'x':
+		card_number=1;
+		break;
+            case 'F':
+                folder_num_set = 1;
+		folder_num_string = strdup (optarg);
+                break;
+	    case 'b':
+		name_flag = 1;
+		break;
+	    case 'g':
+		name_flag = 1;
+		match_mode = RIO_MATCH_GLOB;
+		break;
+	    case 'E':
+		name_flag = 1;
+		match_mode = RIO_MATCH_REGEX;
+		break;
+	    case 's':
+		if (strcmp (optarg, "none") == 0)
+		  sync_policy = RIO_SYNC_NONE;
+		else if (strcmp (optarg, "close") == 0)
+		  sync_policy = RIO_SYNC_CLOSE;
+		else if (strcmp (optarg, "always") == 0)
+		  sync_policy = RIO_SYNC_ALWAYS;
+		else
+		  usage (argv[0]);
+		break;
+	    case 'o':
+		range_offset = strtoul (optarg, NULL, 0);
+		break;
+	    case 'l':
+		range_length = strtoul (optarg, NULL, 0);
+		break;
+	    case 'c':
+		to_stdout = 1;
+		msg = stderr;
+		break;
+            case 'v':
+                printf("\nrio_get_song -- version %s\n",VERSION);
+                exit(0);
+                break;
+            case 'h':
+                usage(argv[0]);
+                for (p=option_help;  *p ;  p++)
+                  fprintf (stderr, "%s\n", *p);
+                exit(0);
+                break;
+            default:    
+		usage (argv[0]);
+        }
+    }
+
+  /* if --byname not set then folder_num_string is an index */
+
+  if (name_flag == 0 && folder_num_set == 1)
+  {
+ 	*folder_num = atoi(folder_num_string);
+  } 
+
+}
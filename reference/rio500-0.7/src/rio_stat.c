@@ -51,9 +51,9 @@ return;
 
 int terse = 0;
 #ifndef WITH_USBDEVFS
-void show_songs (int rio_dev, GList *folders, int num_folder, int card);
+void show_songs (int rio_dev, rio_view *folders, int num_folder, int card);
 #else
-void show_songs (struct usbdevice *rio_dev, GList *folders, int num_folder, int card);
+void show_songs (struct usbdevice *rio_dev, rio_view *folders, int num_folder, int card);
 #endif
 
 int
@@ -61,9 +61,9 @@ main (int argc, char *argv[])
 {
   int         folder_num=0;
   unsigned long memfree, memtotal,revision;
-  GList      *folders, *item;
+  rio_view   *folders;
   mem_status *mem;
-  folder_entry *entry;
+  const folder_entry *entry;
   int card,card_count;
 #ifndef WITH_USBDEVFS
   int rio_dev;
@@ -151,28 +151,25 @@ main (int argc, char *argv[])
        printf ( "  N   offset  num songs       Folder Name\n");
        printf ( "-------------------------------------------------------------\n");
      }
-   folder_num = 0;
-   folders = read_folder_entries (rio_dev, card);
-   for (item = folders; item; item = item->next)
+   folders = rio_read_folder_view (rio_dev, card);
+   for (folder_num = 0; folders && folder_num < folders->count; folder_num++)
    {
-     entry = (folder_entry *)item->data;
-     if (entry)
-     {
-       if (terse)
-	 printf ( "\nFolder: # Songs Name\n%02d %02d %s\n", 
-		  folder_num,
-		  (entry->fst_free_entry_off / 0x800),
-		  entry->name1 );
-       else
-	 printf ( "(%2d)  0x%04x  (%2d items)      %s\n", 
-		  folder_num,
-		  entry->offset, 
-		  (entry->fst_free_entry_off / 0x800),
-		  entry->name1 );
-
-       show_songs (rio_dev, folders, folder_num++, card);
-     }
+     entry = rio_view_folder (folders, folder_num);
+     if (terse)
+       printf ( "\nFolder: # Songs Name\n%02d %02d %s\n", 
+		folder_num,
+		rio_folder_num_songs (entry),
+		entry->name1 );
+     else
+       printf ( "(%2d)  0x%04x  (%2d items)      %s\n", 
+		folder_num,
+		rio_folder_offset (entry), 
+		rio_folder_num_songs (entry),
+		entry->name1 );
+
+     show_songs (rio_dev, folders, folder_num, card);
    }
+   rio_view_delete (folders);
 
    finish_communication (rio_dev);
 
@@ -186,14 +183,15 @@ main (int argc, char *argv[])
 
 void
 #ifndef WITH_USBDEVFS
-show_songs (int rio_dev, GList *folders, int num_folder, int card)
+show_songs (int rio_dev, rio_view *folders, int num_folder, int card)
 #else
-show_songs (struct usbdevice *rio_dev, GList *folders, int num_folder, int card)
+show_songs (struct usbdevice *rio_dev, rio_view *folders, int num_folder, int card)
 #endif
 {   
-  int         song_num;
-  GList      *songs, *item;
-  song_entry *entry;
+  int            song_num;
+  rio_names     *names;
+  rio_song_list *songs;
+  rio_song_info *entry;
 
 
   if (terse)
@@ -204,26 +202,25 @@ show_songs (struct usbdevice *rio_dev, GList *folders, int num_folder, int card)
       printf ( "   (num) offset      size         song name\n");
     }
 
-   songs = read_song_entries (rio_dev, folders, num_folder, card);
-   song_num = 0;
-   for (item = songs; item; item = item->next)
+   names = rio_names_new ();
+   songs = (names != NULL) ? rio_read_song_list (rio_dev, folders, num_folder, card, names) : NULL;
+   for (song_num = 0; songs && song_num < songs->count; song_num++)
    {
-     entry = (song_entry *)item->data;
-     if (entry)
-     {
-       if (terse)
-	 printf ( "%02d %8ld %s\n", 
-		  song_num++, 
-		  entry->length,
-		  entry->name1 );
-       else
-	 printf ( "    (%2d) 0x%04x  (%8ld bytes) %s\n", 
-		  song_num++, 
-		  entry->offset, 
-		  entry->length,
-		  entry->name1 );
-     }
+     entry = &songs->songs[song_num];
+     if (terse)
+       printf ( "%02d %8lu %s\n", 
+		song_num, 
+		(unsigned long) entry->length,
+		entry->name );
+     else
+       printf ( "    (%2d) 0x%04x  (%8lu bytes) %s\n", 
+		song_num, 
+		entry->offset, 
+		(unsigned long) entry->length,
+		entry->name );
    }
+   rio_song_list_delete (songs);
+   rio_names_delete (names);
    printf ("\n\n");
 
 }